@@ -2,10 +2,53 @@
 #include <unordered_map.h>
 #include <sstream>
 #include <ostream>
+#include <string_view>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <vector>
 
 #define DO_UNORDERED_MAP_TESTS 1
 #if DO_UNORDERED_MAP_TESTS
 
+// A (terrible) hash function for tests that need collisions: keys below 1000 all get a hash code whose home
+// slot is the first slot, and the rest all get one whose home slot is the last slot (for any capacity)
+struct CollidingHash
+{
+	size_t operator()(int key) const
+	{
+		// 0xe217c1e66c88cc3 * (the fibonacci multiplier) is 0xFFFFFFFFFFFFFFFF (mod 2^64)
+		return key < 1000 ? 0 : 0xe217c1e66c88cc3ull;
+	}
+};
+
+// A hash function that puts key i (for 0 <= i < 64) in slot i of a 64-slot table
+struct SlotHash
+{
+	size_t operator()(int key) const
+	{
+		// 0xf1de83e19937733d is the inverse of the fibonacci multiplier (mod 2^64)
+		return ((unsigned long long)key << 58) * 0xf1de83e19937733dull;
+	}
+};
+
+// A value type that counts how many times it is constructed (in any way) and destroyed
+struct CountedValue
+{
+	static int msConstructed;
+	static int msDestroyed;
+	int mValue;
+
+	CountedValue(int value) : mValue(value) { msConstructed++; }
+	CountedValue(const CountedValue& other) : mValue(other.mValue) { msConstructed++; }
+	CountedValue(CountedValue&& other) noexcept : mValue(other.mValue) { msConstructed++; }
+	CountedValue& operator=(const CountedValue& other) = default;
+	CountedValue& operator=(CountedValue&& other) = default;
+	~CountedValue() { msDestroyed++; }
+};
+
+int CountedValue::msConstructed = 0;
+int CountedValue::msDestroyed = 0;
 
 TEST(UnorderedTest, basic_construction)
 {
@@ -18,7 +61,7 @@ TEST(UnorderedTest, basic_construction)
 	map["Bob"] = 9;
 
 	EXPECT_EQ(map.size(), 3);
-	EXPECT_EQ(map.capacity(), 10);
+	EXPECT_EQ(map.capacity(), 16);
 
 	EXPECT_TRUE(map.remove("Bob"));
 	EXPECT_EQ(map.size(), 2);
@@ -52,7 +95,562 @@ TEST(UnorderedTest, ostream)
 	map["Sue"] = 1;
 	map["Jose"] = 4;
 
-	std::cout << map;
+	// Every item once, in slot order, joined with ", "
+	std::string expected = "{";
+	for (ssuds::UnorderedMap<std::string, int>::unorderMapIterator it = map.begin(); it != map.end(); ++it)
+	{
+		if (expected.size() > 1)
+			expected += ", ";
+		expected += (*it).first + ":" + std::to_string((*it).second);
+	}
+	expected += "}";
+	std::stringstream ss;
+	ss << map;
+	EXPECT_EQ(ss.str(), expected);
+	EXPECT_EQ(ss.str().size(), std::string("{Bob:7, Sue:1, Jose:4}").size());
+	EXPECT_NE(ss.str().find("Sue:1"), std::string::npos);
+	EXPECT_NE(ss.str().find("Jose:4"), std::string::npos);
+
+	std::stringstream empty;
+	empty << ssuds::UnorderedMap<std::string, int>();
+	EXPECT_EQ(empty.str(), "{}");
+}
+
+TEST(UnorderedTest, grow_on_load_factor)
+{
+	ssuds::UnorderedMap<int, int> map;
+	EXPECT_EQ(map.capacity(), 8);
+	EXPECT_FLOAT_EQ(map.max_load_factor(), 0.75f);
+
+	for (int i = 0; i < 1000; i++)
+	{
+		map[i * 7] = i;
+		EXPECT_LE(map.load_factor(), map.max_load_factor());
+	}
+	EXPECT_EQ(map.size(), 1000);
+	EXPECT_EQ(map.capacity(), 2048);
+
+	for (int i = 0; i < 1000; i++)
+	{
+		ASSERT_TRUE(map.find(i * 7) != map.end());
+		EXPECT_EQ(map[i * 7], i);
+	}
+	EXPECT_TRUE(map.find(3) == map.end());
+	EXPECT_EQ(map.size(), 1000);
+
+	for (int i = 0; i < 1000; i += 2)
+		EXPECT_TRUE(map.remove(i * 7));
+	EXPECT_FALSE(map.remove(0));
+	EXPECT_EQ(map.size(), 500);
+	for (int i = 1; i < 1000; i += 2)
+		EXPECT_EQ(map[i * 7], i);
+}
+
+TEST(UnorderedTest, reserve_and_rehash)
+{
+	ssuds::UnorderedMap<int, int> map;
+	map.reserve(100);
+	unsigned int cap = map.capacity();
+	EXPECT_GE(cap * map.max_load_factor(), 100);
+	for (int i = 0; i < 100; i++)
+		map[i] = i;
+	EXPECT_EQ(map.capacity(), cap);
+
+	map.rehash(1000);
+	EXPECT_EQ(map.capacity(), 1024);
+	map.rehash(0);
+	EXPECT_EQ(map.capacity(), 256);
+	for (int i = 0; i < 100; i++)
+		EXPECT_EQ(map[i], i);
+
+	EXPECT_THROW(map.max_load_factor(1.0f), std::invalid_argument);
+	map.max_load_factor(0.25f);
+	EXPECT_LE(map.load_factor(), 0.25f);
+	EXPECT_EQ(map.size(), 100);
+}
+
+TEST(UnorderedTest, remove_keeps_probe_chains)
+{
+	// The first 20 keys all share the last slot as their home, so they form one long cluster that wraps
+	// around the end of the table into the second 20 keys (whose home is the first slot)
+	ssuds::UnorderedMap<int, int, CollidingHash> map(64);
+	for (int i = 0; i < 20; i++)
+		map[1063 + i * 64] = i;
+	for (int i = 0; i < 20; i++)
+		map[i] = -i;
+	ASSERT_EQ(map.capacity(), 64);
+
+	for (int i = 0; i < 20; i += 3)
+		EXPECT_TRUE(map.remove(1063 + i * 64));
+	EXPECT_FALSE(map.remove(1063));
+	EXPECT_TRUE(map.remove(5));
+	EXPECT_EQ(map.size(), 32);
+	EXPECT_EQ(map.capacity(), 64);
+
+	for (int i = 0; i < 20; i++)
+	{
+		if (i % 3 == 0)
+			EXPECT_TRUE(map.find(1063 + i * 64) == map.end());
+		else
+			EXPECT_EQ(map[1063 + i * 64], i);
+		if (i == 5)
+			EXPECT_TRUE(map.find(i) == map.end());
+		else
+			EXPECT_EQ(map[i], -i);
+	}
+	EXPECT_EQ(map.size(), 32);
+}
+
+TEST(UnorderedTest, many_string_keys)
+{
+	// Enough keys that probes have to cross control-byte group boundaries and wrap around the table
+	ssuds::UnorderedMap<std::string, int> map;
+	for (int i = 0; i < 5000; i++)
+		map["key" + std::to_string(i)] = i;
+	EXPECT_EQ(map.size(), 5000);
+
+	for (int i = 0; i < 5000; i++)
+		EXPECT_EQ(map["key" + std::to_string(i)], i);
+	for (int i = 5000; i < 10000; i++)
+		EXPECT_TRUE(map.find("key" + std::to_string(i)) == map.end());
+
+	for (int i = 0; i < 5000; i += 2)
+		EXPECT_TRUE(map.remove("key" + std::to_string(i)));
+	for (int i = 0; i < 5000; i++)
+		EXPECT_EQ(map.find("key" + std::to_string(i)) == map.end(), i % 2 == 0);
+	EXPECT_EQ(map.size(), 2500);
+}
+
+TEST(UnorderedTest, robin_hood)
+{
+	ssuds::UnorderedMap<int, int, ssuds::FastHash<int>, ssuds::RobinHoodProbing> map;
+	EXPECT_EQ(map.max_probe_distance(), 0);
+	EXPECT_EQ(map.mean_probe_distance(), 0.0);
+
+	for (int i = 0; i < 2000; i++)
+		map[i * 16] = i;
+	EXPECT_EQ(map.size(), 2000);
+	for (int i = 0; i < 2000; i++)
+		EXPECT_EQ(map[i * 16], i);
+	EXPECT_TRUE(map.find(8) == map.end());
+
+	for (int i = 0; i < 2000; i += 3)
+		EXPECT_TRUE(map.remove(i * 16));
+	EXPECT_FALSE(map.remove(0));
+	for (int i = 0; i < 2000; i++)
+		EXPECT_EQ(map.find(i * 16) == map.end(), i % 3 == 0);
+	EXPECT_EQ(map.size(), 1333);
+	EXPECT_GE((double)map.max_probe_distance(), map.mean_probe_distance());
+}
+
+TEST(UnorderedTest, probe_distance_stats)
+{
+	ssuds::UnorderedMap<std::string, int> linear;
+	ssuds::UnorderedMap<std::string, int, ssuds::FastHash<std::string>, ssuds::RobinHoodProbing> robin_hood;
+	for (int i = 0; i < 3000; i++)
+	{
+		linear["key" + std::to_string(i)] = i;
+		robin_hood["key" + std::to_string(i)] = i;
+	}
+	for (int i = 0; i < 3000; i++)
+		EXPECT_EQ(robin_hood["key" + std::to_string(i)], i);
+
+	// Robin Hood just reorders each cluster, so the average distance barely changes but the worst case shrinks
+	EXPECT_NEAR(robin_hood.mean_probe_distance(), linear.mean_probe_distance(), 0.5);
+	EXPECT_LE(robin_hood.max_probe_distance(), linear.max_probe_distance());
+
+	ssuds::UnorderedMap<int, int, SlotHash> ints(64);
+	for (int i = 0; i < 40; i++)
+		ints[i] = i;
+	EXPECT_EQ(ints.max_probe_distance(), 0);
+}
+
+TEST(UnorderedTest, transparent_string_lookup)
+{
+	ssuds::UnorderedMap<std::string, int> map;
+	map["Bob"] = 7;
+	map[std::string("Sue")] = 1;
+	map[std::string_view("Jose")] = 4;
+	EXPECT_EQ(map.size(), 3);
+
+	// A long key (past the small-string limit) looked up through a view of a bigger buffer
+	std::string buffer = "prefix:a-key-that-is-too-long-for-the-small-string-optimization:suffix";
+	std::string_view long_key = std::string_view(buffer).substr(7, 56);
+	map[long_key] = 10;
+	EXPECT_EQ(map[std::string(long_key)], 10);
+	EXPECT_TRUE(map.find(long_key) != map.end());
+
+	std::string_view sue = "Sue";
+	EXPECT_EQ(map[sue], 1);
+	EXPECT_TRUE(map.find(sue) != map.end());
+	EXPECT_TRUE(map.find("Jose") != map.end());
+	EXPECT_TRUE(map.find(std::string_view("Jos")) == map.end());
+	const char* bob = "Bob";
+	EXPECT_EQ(map[bob], 7);
+
+	EXPECT_TRUE(map.remove(sue));
+	EXPECT_FALSE(map.remove("Sue"));
+	EXPECT_TRUE(map.remove(std::string_view("Bob")));
+	EXPECT_EQ(map.size(), 2);
+	EXPECT_EQ(map["Jose"], 4);
+}
+
+// Runs the same inserts / lookups / removes on a map and checks the results (used to try each policy)
+template <class M>
+void check_string_map_policy(M& map)
+{
+	for (int i = 0; i < 3000; i++)
+		map["a-fairly-long-string-key-" + std::to_string(i)] = i;
+	EXPECT_EQ(map.size(), 3000);
+	for (int i = 0; i < 3000; i += 2)
+		EXPECT_TRUE(map.remove("a-fairly-long-string-key-" + std::to_string(i)));
+	map.rehash(map.capacity() * 2);
+	for (int i = 0; i < 3000; i++)
+	{
+		if (i % 2 == 0)
+			EXPECT_TRUE(map.find("a-fairly-long-string-key-" + std::to_string(i)) == map.end());
+		else
+			EXPECT_EQ(map["a-fairly-long-string-key-" + std::to_string(i)], i);
+	}
+	EXPECT_EQ(map.size(), 1500);
+}
+
+TEST(UnorderedTest, stored_hash)
+{
+	ssuds::UnorderedMap<std::string, int, ssuds::FastHash<std::string>, ssuds::LinearProbing, ssuds::StoredHash32> map32;
+	check_string_map_policy(map32);
+	ssuds::UnorderedMap<std::string, int, ssuds::FastHash<std::string>, ssuds::LinearProbing, ssuds::StoredHash64> map64;
+	check_string_map_policy(map64);
+	ssuds::UnorderedMap<std::string, int, ssuds::FastHash<std::string>, ssuds::RobinHoodProbing, ssuds::StoredHash32> robin_hood32;
+	check_string_map_policy(robin_hood32);
+	ssuds::UnorderedMap<std::string, int, ssuds::FastHash<std::string>, ssuds::RobinHoodProbing> robin_hood;
+	check_string_map_policy(robin_hood);
+
+	ssuds::UnorderedMap<int, int, ssuds::FastHash<int>, ssuds::LinearProbing, ssuds::StoredHash32> ints;
+	for (int i = 0; i < 1000; i++)
+		ints[i * 64] = i;
+	for (int i = 0; i < 1000; i += 2)
+		EXPECT_TRUE(ints.remove(i * 64));
+	for (int i = 0; i < 1000; i++)
+		EXPECT_EQ(ints.find(i * 64) == ints.end(), i % 2 == 0);
+}
+
+TEST(UnorderedTest, hash_functions)
+{
+	// Equal strings and string views hash the same, and the hash depends on every byte
+	ssuds::FastHash<std::string> string_hash;
+	std::string long_string(100, 'x');
+	EXPECT_EQ(string_hash(long_string), ssuds::FastHash<std::string_view>()(std::string_view(long_string)));
+	for (size_t len = 0; len < long_string.size(); len++)
+		EXPECT_NE(string_hash(long_string.substr(0, len)), string_hash(long_string.substr(0, len + 1)));
+	std::string changed = long_string;
+	changed[50] = 'y';
+	EXPECT_NE(string_hash(long_string), string_hash(changed));
+
+	// Sequential ints end up spread over the table (no long clusters)
+	ssuds::UnorderedMap<unsigned int, int> map;
+	for (unsigned int i = 0; i < 10000; i++)
+		map[i << 16] = i;
+	EXPECT_LT(map.max_probe_distance(), 64);
+	for (unsigned int i = 0; i < 10000; i++)
+		EXPECT_EQ(map[i << 16], i);
+
+	// A user-supplied hash function (std::hash isn't transparent, so lookups must use std::string)
+	ssuds::UnorderedMap<std::string, int, std::hash<std::string>> std_hash_map;
+	std_hash_map["Bob"] = 1;
+	std_hash_map[std::string("Sue")] = 2;
+	EXPECT_TRUE(std_hash_map.find(std::string("Bob")) != std_hash_map.end());
+	EXPECT_TRUE(std_hash_map.remove("Sue"));
+	EXPECT_EQ(std_hash_map.size(), 1);
+}
+
+TEST(UnorderedTest, emplace)
+{
+	CountedValue::msConstructed = CountedValue::msDestroyed = 0;
+	{
+		// An empty table holds no values (CountedValue has no default constructor, so none could be made)
+		ssuds::UnorderedMap<std::string, CountedValue> map(1000);
+		EXPECT_EQ(CountedValue::msConstructed, 0);
+
+		// Each new value is constructed once, in place
+		auto result = map.try_emplace("Bob", 7);
+		EXPECT_TRUE(result.second);
+		EXPECT_EQ(CountedValue::msConstructed, 1);
+		EXPECT_TRUE(map.emplace(std::string("Sue"), 1).second);
+		EXPECT_TRUE(map.emplace(std::string_view("Jose"), 4).second);
+		EXPECT_EQ(CountedValue::msConstructed, 3);
+
+		// An existing key leaves the value (and args) alone
+		EXPECT_FALSE(map.try_emplace(std::string("Bob"), 8).second);
+		EXPECT_FALSE(map.emplace("Sue", 2).second);
+		EXPECT_EQ(CountedValue::msConstructed, 3);
+		EXPECT_EQ(map.size(), 3);
+
+		EXPECT_FALSE(map.insert_or_assign("Bob", CountedValue(9)).second);
+		EXPECT_TRUE(map.insert_or_assign(std::string("Ann"), 5).second);
+		EXPECT_EQ((*map.find("Bob")).second.mValue, 9);
+		EXPECT_EQ((*map.find("Ann")).second.mValue, 5);
+		EXPECT_EQ(map.size(), 4);
+
+		EXPECT_TRUE(map.remove("Sue"));
+	}
+	// Everything made was destroyed exactly once (when removed or with the map)
+	EXPECT_EQ(CountedValue::msConstructed, CountedValue::msDestroyed);
+
+	// Growing and robin hood displacement move the pairs around, but still never leak or double-destroy them
+	CountedValue::msConstructed = CountedValue::msDestroyed = 0;
+	{
+		ssuds::UnorderedMap<int, CountedValue, ssuds::FastHash<int>, ssuds::RobinHoodProbing> map;
+		for (int i = 0; i < 1000; i++)
+			EXPECT_TRUE(map.try_emplace(i * 16, i).second);
+		for (int i = 0; i < 1000; i += 2)
+			EXPECT_TRUE(map.remove(i * 16));
+		for (int i = 1; i < 1000; i += 2)
+			EXPECT_EQ((*map.find(i * 16)).second.mValue, i);
+	}
+	EXPECT_EQ(CountedValue::msConstructed, CountedValue::msDestroyed);
+}
+
+TEST(UnorderedTest, copy_and_move)
+{
+	ssuds::UnorderedMap<std::string, int> map;
+	for (int i = 0; i < 100; i++)
+		map["key" + std::to_string(i)] = i;
+
+	// Copies are deep
+	ssuds::UnorderedMap<std::string, int> copy(map);
+	copy["key0"] = -1;
+	EXPECT_TRUE(copy.remove("key1"));
+	EXPECT_EQ(map["key0"], 0);
+	EXPECT_TRUE(map.find("key1") != map.end());
+	EXPECT_EQ(copy.size(), 99);
+	copy = map;
+	copy = copy;
+	EXPECT_EQ(copy.size(), 100);
+	EXPECT_EQ(copy["key0"], 0);
+
+	// Moving takes the table itself and leaves an empty (but usable) map behind
+	unsigned int cap = map.capacity();
+	ssuds::UnorderedMap<std::string, int> moved(std::move(map));
+	EXPECT_EQ(moved.size(), 100);
+	EXPECT_EQ(moved.capacity(), cap);
+	EXPECT_EQ(map.size(), 0);
+	EXPECT_TRUE(map.find("key5") == map.end());
+	EXPECT_FALSE(map.remove("key5"));
+	EXPECT_TRUE(map.begin() == map.end());
+	map["new"] = 1;
+	EXPECT_EQ(map.size(), 1);
+	map = std::move(moved);
+	EXPECT_EQ(map.size(), 100);
+	EXPECT_EQ(map["key99"], 99);
+
+	ssuds::UnorderedMap<std::string, int> other;
+	other["other"] = 7;
+	swap(map, other);
+	EXPECT_EQ(map.size(), 1);
+	EXPECT_EQ(map["other"], 7);
+	EXPECT_EQ(other.size(), 100);
+
+	// Trivially copyable items (copied with one memcpy), with robin hood distances and stored hashes
+	ssuds::UnorderedMap<int, int, ssuds::FastHash<int>, ssuds::RobinHoodProbing, ssuds::StoredHash32> ints;
+	for (int i = 0; i < 1000; i++)
+		ints[i * 16] = i;
+	ssuds::UnorderedMap<int, int, ssuds::FastHash<int>, ssuds::RobinHoodProbing, ssuds::StoredHash32> ints_copy = ints;
+	EXPECT_EQ(ints_copy.max_probe_distance(), ints.max_probe_distance());
+	for (int i = 0; i < 1000; i += 2)
+		EXPECT_TRUE(ints_copy.remove(i * 16));
+	for (int i = 0; i < 1000; i++)
+	{
+		EXPECT_EQ(ints[i * 16], i);
+		EXPECT_EQ(ints_copy.find(i * 16) == ints_copy.end(), i % 2 == 0);
+	}
+	static_assert(std::is_nothrow_move_constructible<ssuds::UnorderedMap<std::string, int>>::value, "move should be noexcept");
+}
+
+TEST(UnorderedTest, iterate_sparse)
+{
+	// A big table with only a few (scattered) items, including the first and last slots
+	ssuds::UnorderedMap<int, int, SlotHash> map(64);
+	for (int i : {0, 5, 17, 40, 63})
+		map[i] = i;
+	ASSERT_EQ(map.capacity(), 64);
+
+	std::vector<int> keys;
+	for (ssuds::UnorderedMap<int, int, SlotHash>::unorderMapIterator it = map.begin(); it != map.end(); ++it)
+		keys.push_back(it->first);
+	EXPECT_EQ(keys, std::vector<int>({ 0, 5, 17, 40, 63 }));
+
+	// Values can be changed through the iterator
+	ssuds::UnorderedMap<int, int> big(100000);
+	for (int i = 0; i < 100; i++)
+		big[i * 1000] = i;
+	int count = 0;
+	for (ssuds::UnorderedMap<int, int>::unorderMapIterator it = big.begin(); it != big.end(); ++it)
+	{
+		(*it).second *= 2;
+		count++;
+	}
+	EXPECT_EQ(count, 100);
+	for (int i = 0; i < 100; i++)
+		EXPECT_EQ(big[i * 1000], i * 2);
+
+	ssuds::UnorderedMap<int, int> empty;
+	EXPECT_TRUE(empty.begin() == empty.end());
+}
+
+TEST(UnorderedTest, find_batch)
+{
+	ssuds::UnorderedMap<int, int> map;
+	int keys[100];
+	int* values[100];
+	bool results[100];
+	for (int i = 0; i < 100; i++)
+		keys[i] = i * 3;
+
+	// An empty map finds nothing
+	map.find_batch(keys, 100, values);
+	EXPECT_EQ(map.contains_batch(keys, 100, results), 0);
+	for (int i = 0; i < 100; i++)
+		EXPECT_TRUE(values[i] == nullptr && !results[i]);
+
+	// Only multiples of 6 are in the map (the batches don't line up with the key count)
+	for (int i = 0; i < 1000; i += 6)
+		map[i] = i * 10;
+	map.find_batch(keys, 100, values);
+	EXPECT_EQ(map.contains_batch(keys, 100, results), 50);
+	for (int i = 0; i < 100; i++)
+	{
+		EXPECT_EQ(results[i], i % 2 == 0);
+		if (i % 2 == 0)
+		{
+			ASSERT_TRUE(values[i] != nullptr);
+			EXPECT_EQ(*values[i], keys[i] * 10);
+			*values[i] = -1;
+		}
+		else
+			EXPECT_TRUE(values[i] == nullptr);
+	}
+	EXPECT_EQ(map[0], -1);
+
+	// Transparent lookup keys work too
+	ssuds::UnorderedMap<std::string, int, ssuds::FastHash<std::string>, ssuds::RobinHoodProbing> strings;
+	strings["Bob"] = 1;
+	strings["Sue"] = 2;
+	std::string_view names[3] = { "Sue", "Joe", "Bob" };
+	EXPECT_EQ(strings.contains_batch(names, 3, results), 2);
+	EXPECT_TRUE(results[0] && !results[1] && results[2]);
+}
+
+TEST(UnorderedTest, snapshot)
+{
+	std::string path = (std::filesystem::temp_directory_path() / "ssuds_unordered_map_snapshot_test.bin").string();
+	typedef ssuds::UnorderedMap<int, double, ssuds::FastHash<int>, ssuds::RobinHoodProbing, ssuds::StoredHash32> map_type;
+	{
+		map_type map;
+		for (int i = 0; i < 10000; i++)
+			map[i * 7] = i * 0.5;
+		for (int i = 0; i < 10000; i += 3)
+			map.remove(i * 7);
+		map.save(path);
+
+		// The mapped map is the same, slot for slot
+		map_type mapped = map_type::open_mapped(path);
+		EXPECT_EQ(mapped.size(), map.size());
+		EXPECT_EQ(mapped.capacity(), map.capacity());
+		EXPECT_EQ(mapped.max_probe_distance(), map.max_probe_distance());
+		for (int i = 0; i < 10000; i++)
+		{
+			if (i % 3 == 0)
+				EXPECT_TRUE(mapped.find(i * 7) == mapped.end());
+			else
+				EXPECT_EQ(mapped[i * 7], i * 0.5);
+		}
+
+		// It can be changed (without changing the file) and grown off of the file
+		mapped[1] = 1.0;
+		EXPECT_TRUE(mapped.remove(7));
+		mapped.rehash(mapped.capacity() * 2);
+		EXPECT_EQ(mapped[1], 1.0);
+		EXPECT_TRUE(mapped.find(7) == mapped.end());
+		EXPECT_EQ(mapped[14], 1.0);
+		map_type reopened = map_type::open_mapped(path, true);
+		EXPECT_TRUE(reopened.find(1) == reopened.end());
+		EXPECT_EQ(reopened[7], 0.5);
+	}
+
+	// The wrong kind of map, a different hash function, or a damaged file are all caught
+	EXPECT_THROW((ssuds::UnorderedMap<int, float>::open_mapped(path)), std::runtime_error);
+	EXPECT_THROW((ssuds::UnorderedMap<int, double, SlotHash, ssuds::RobinHoodProbing, ssuds::StoredHash32>::open_mapped(path)), std::runtime_error);
+	{
+		std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+		file.seekp(5000);
+		file.put('x');
+	}
+	EXPECT_NO_THROW(map_type::open_mapped(path));
+	EXPECT_THROW(map_type::open_mapped(path, true), std::runtime_error);
+	{
+		std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+		file.seekp(20);
+		file.put('x');
+	}
+	EXPECT_THROW(map_type::open_mapped(path), std::runtime_error);
+	std::remove(path.c_str());
+	EXPECT_THROW(map_type::open_mapped(path), std::runtime_error);
+
+	// An empty map
+	{
+		ssuds::UnorderedMap<int, int> empty;
+		empty.save(path);
+		ssuds::UnorderedMap<int, int> mapped_empty = ssuds::UnorderedMap<int, int>::open_mapped(path);
+		EXPECT_EQ(mapped_empty.size(), 0);
+		mapped_empty[5] = 5;
+		EXPECT_EQ(mapped_empty[5], 5);
+	}
+	std::remove(path.c_str());
+}
+
+TEST(UnorderedTest, stats)
+{
+	// Keys 0 - 4 all want the first slot and 2000 wants the last one, making one cluster of 6 that wraps around
+	ssuds::UnorderedMap<int, int, CollidingHash> map(16);
+	for (int i = 0; i < 5; i++)
+		map[i] = i;
+	map[2000] = 0;
+	ssuds::UnorderedMapStats before = map.stats();
+	EXPECT_EQ(before.mSize, 6);
+	EXPECT_EQ(before.mCapacity, 16);
+	EXPECT_FLOAT_EQ(before.mLoadFactor, 6.0f / 16);
+	EXPECT_EQ(before.mMaxClusterLength, 6);
+	EXPECT_EQ(before.mDisplacement[0], 2);
+	for (int i = 1; i <= 4; i++)
+		EXPECT_EQ(before.mDisplacement[i], 1);
+
+	map.find(3);
+	map.find(7);
+	map.remove(0);
+	map.rehash(64);
+	ssuds::UnorderedMapStats after = map.stats();
+	EXPECT_EQ(after.mMaxClusterLength, 5);
+	std::stringstream ss;
+	ss << after;
+	EXPECT_NE(ss.str().find("longest cluster 5"), std::string::npos);
+
+#if SSUDS_UNORDERED_MAP_STATS
+	EXPECT_TRUE(after.mCountersEnabled);
+	EXPECT_EQ(before.mLookups, 6);
+	EXPECT_EQ(before.mMisses, 6);
+	// find(3) stops 3 slots from home, find(7) (a miss) at the unused slot 5 past home, remove(0) at home
+	EXPECT_EQ(after.mLookups - before.mLookups, 3);
+	EXPECT_EQ(after.mHits - before.mHits, 2);
+	EXPECT_EQ(after.mProbeLengths[3] - before.mProbeLengths[3], 1);
+	EXPECT_EQ(after.mProbeLengths[5] - before.mProbeLengths[5], 1);
+	EXPECT_EQ(after.mRehashes - before.mRehashes, 1);
+	EXPECT_GE(after.mRehashSeconds, 0.0);
+#else
+	EXPECT_FALSE(after.mCountersEnabled);
+	EXPECT_EQ(after.mLookups, 0);
+	EXPECT_NE(ss.str().find("SSUDS_UNORDERED_MAP_STATS"), std::string::npos);
+#endif
 }
 
 #endif
\ No newline at end of file
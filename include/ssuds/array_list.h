@@ -1,5 +1,30 @@
 #pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <memory_resource>
 #include <string>
+#include <type_traits>
+#include <utility>
+#include <simd_search.h>
+#if __has_include(<version>)
+#include <version>
+#endif
+#if defined(__cpp_lib_span)
+#include <span>
+#endif
+
+// Define SSUDS_CHECKED_ACCESS as 1 or 0 (for the whole build, or before including array_list.h) to turn on or off
+// the index check in ArrayList::at_unchecked and ArrayListIterator's operator* (which then throw std::out_of_range
+// like operator[] does).  By default it is on in debug builds (no NDEBUG) and off otherwise.
+#ifndef SSUDS_CHECKED_ACCESS
+#ifdef NDEBUG
+#define SSUDS_CHECKED_ACCESS 0
+#else
+#define SSUDS_CHECKED_ACCESS 1
+#endif
+#endif
 
 // Note: in C++, a general tempate (like this one) must be defined inline
 // entirely in the .h file (no .cpp files).  So, in this lab, array_list.cpp
@@ -12,10 +37,52 @@ namespace ssuds
 	// @@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@
 	enum class ArrayListIteratorType { forward, backwards };
 
-	/// An ArrayList is an array-based data structure. 
-	template <class T>
+
+	// @@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@
+	// @ GROWTH POLICIES                        @
+	// @@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@
+	/// The default growth policy for ArrayList: a full array doubles in size
+	struct DoublingGrowth
+	{
+		/// The capacity to grow a full array of capacity slots (each item_size bytes) to
+		static unsigned int next_capacity(unsigned int capacity, std::size_t /*item_size*/)
+		{
+			return capacity * 2;
+		}
+	};
+
+	/// A growth policy for ArrayList that grows a full array by half again (1.5x).  It wastes less memory than
+	/// doubling, at the cost of about twice as many reallocations
+	struct HalfAgainGrowth
+	{
+		static unsigned int next_capacity(unsigned int capacity, std::size_t /*item_size*/)
+		{
+			return capacity + capacity / 2;
+		}
+	};
+
+	/// A growth policy for ArrayList that doubles, then rounds the array up to fill a whole number of PageSize
+	/// pages (big arrays come straight from the OS in pages, so the rest of the last page would be wasted anyway)
+	template <std::size_t PageSize = 4096>
+	struct PageGrowth
+	{
+		static unsigned int next_capacity(unsigned int capacity, std::size_t item_size)
+		{
+			std::size_t bytes = (std::size_t)capacity * 2 * item_size;
+			return (unsigned int)((bytes + PageSize - 1) / PageSize * PageSize / item_size);
+		}
+	};
+
+
+	/// An ArrayList is an array-based data structure.  Its array comes from an Allocator (std::allocator by default;
+	/// see ssuds::pmr::ArrayList for one that takes a std::pmr::memory_resource), and grows as GrowthPolicy says
+	/// (see DoublingGrowth).  It shrinks (to half) when it falls below a quarter full, so a list whose size goes
+	/// back and forth across a boundary doesn't reallocate every time it crosses
+	template <class T, class Allocator = std::allocator<T>, class GrowthPolicy = DoublingGrowth>
 	class ArrayList
 	{
+		static_assert(std::is_same<typename std::allocator_traits<Allocator>::value_type, T>::value, "Allocator::value_type must be T");
+
 	// @@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@
 	// @ NESTED CLASSES                         @
 	// @@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@
@@ -91,7 +158,7 @@ namespace ssuds
 			/// <returns>A reference to the value at the current spot</returns>
 			T& operator*()
 			{
-				return (*mArrayList)[mPosition];
+				return mArrayList->at_unchecked(mPosition);
 			}
 		};
 
@@ -108,9 +175,18 @@ namespace ssuds
 		/// How many slots are we USING?  This will always be less than or equal to mCapacity
 		unsigned int mSize;
 
-		/// The array of data we're currently holding
+		/// The capacity asked for by the last reserve (the array is never automatically shrunk below this)
+		unsigned int mReserved;
+
+		/// The array of data we're currently holding.  Only the first mSize slots hold items; the rest are
+		/// uninitialized storage (an item is only constructed in a slot when it is added)
 		T* mData;
 
+		/// Where mData comes from
+		Allocator mAllocator;
+
+		typedef std::allocator_traits<Allocator> alloc_traits;
+
 
 	// @@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@
 	// @ OPERATOR OVERLOADS                      @
@@ -123,7 +199,7 @@ namespace ssuds
 	/// <param name="os">an ostream object (ofstream, stringstream, cout, etc.) </param>
 	/// <param name="alist">the ArrayList</param>
 	/// <returns>the (possibly modified) os that was given to us</returns>
-	friend std::ostream& operator <<(std::ostream& os, const ArrayList<T>& alist)
+	friend std::ostream& operator <<(std::ostream& os, const ArrayList& alist)
 	{
 		os << "[";
 		for (unsigned int i = 0; i < alist.size(); i++)
@@ -150,14 +226,77 @@ namespace ssuds
 	}
 
 
-	ArrayList<T>& operator= (const ArrayList<T>& other)
+#if defined(__cpp_lib_span)
+	/// A view of the items (good until the list is next changed)
+	operator std::span<T>()
+	{
+		return std::span<T>(mData, mSize);
+	}
+
+	/// A read-only view of the items (good until the list is next changed)
+	operator std::span<const T>() const
+	{
+		return std::span<const T>(mData, mSize);
+	}
+#endif
+
+
+	/// Makes us a copy of other (we keep our own allocator).  The copy is made before our items are freed, so if
+	/// copying an item throws we are left as we were
+	ArrayList& operator= (const ArrayList& other)
 	{
-		clear();
-		mData = new T[other.mCapacity];
-		for (unsigned int i = 0; i < other.mSize; i++)
-			mData[i] = other[i];
-		mCapacity = other.mCapacity;
-		mSize = other.mSize;
+		if (&other != this)
+		{
+			T* new_array = copy_array(other.mData, other.mSize, other.mCapacity);
+			clear();
+			mData = new_array;
+			mCapacity = other.mCapacity;
+			mSize = other.mSize;
+			mReserved = other.mReserved;
+		}
+		return *this;
+	}
+
+
+	/// Takes other's items, leaving it empty.  other's array is stolen if our allocators can free each other's
+	/// memory; otherwise its items are moved one at a time into an array from our allocator
+	ArrayList& operator= (ArrayList&& other)
+	{
+		if (&other != this)
+		{
+			if (alloc_traits::is_always_equal::value || mAllocator == other.mAllocator)
+			{
+				clear();
+				mData = other.mData;
+				mCapacity = other.mCapacity;
+				mSize = other.mSize;
+				mReserved = other.mReserved;
+				other.mData = nullptr;
+				other.mCapacity = 0;
+				other.mSize = 0;
+				other.mReserved = 0;
+			}
+			else
+			{
+				T* new_array = allocate_array(other.mCapacity);
+				try
+				{
+					relocate(new_array, other.mData, other.mSize);
+				}
+				catch (...)
+				{
+					deallocate_array(new_array, other.mCapacity);
+					throw;
+				}
+				clear();
+				mData = new_array;
+				mCapacity = other.mCapacity;
+				mSize = other.mSize;
+				mReserved = other.mReserved;
+				other.mSize = 0;
+				other.clear();
+			}
+		}
 		return *this;
 	}
 
@@ -167,41 +306,45 @@ namespace ssuds
 	// @@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@
 	public:
 		/// Default constructor
-		ArrayList() : mSize(0), mCapacity(0), mData(nullptr)
+		ArrayList() : mCapacity(0), mSize(0), mReserved(0), mData(nullptr), mAllocator()
 		{
 			// intentionally empty
 		};
 
-		/// Copy-constructor
-		ArrayList(const ArrayList& other) : mCapacity(other.mCapacity), mSize(other.mSize)
+		/// Constructor that makes an empty list which gets its memory from alloc
+		explicit ArrayList(const Allocator& alloc) : mCapacity(0), mSize(0), mReserved(0), mData(nullptr), mAllocator(alloc)
 		{
-			mData = new T[mCapacity];
-			for (unsigned int i = 0; i < other.size(); i++)
-				mData[i] = other[i];
+			// intentionally empty
+		}
+
+		/// Copy-constructor (the allocator is copied as the allocator says to -- a pmr list uses the default resource)
+		ArrayList(const ArrayList& other) : mCapacity(other.mCapacity), mSize(other.mSize), mReserved(other.mReserved),
+			mAllocator(alloc_traits::select_on_container_copy_construction(other.mAllocator))
+		{
+			mData = copy_array(other.mData, other.mSize, other.mCapacity);
 		}
 
 		/// Move-constructor: "steals" the data (shallow copy) from a soon-to-be-destroyed other ArrayList
-		ArrayList(ArrayList&& other) : mCapacity(other.mCapacity), mSize(other.mSize), mData(other.mData)
+		ArrayList(ArrayList&& other) noexcept : mCapacity(other.mCapacity), mSize(other.mSize), mReserved(other.mReserved), mData(other.mData),
+			mAllocator(other.mAllocator)
 		{
 			other.mData = NULL;
 			other.mCapacity = 0;
 			other.mSize = 0;
+			other.mReserved = 0;
 		}
 
 		/// Initializer-list constructor
-		ArrayList(std::initializer_list<T> ilist) : mCapacity((int)ilist.size()), mSize((int)ilist.size())
+		ArrayList(std::initializer_list<T> ilist, const Allocator& alloc = Allocator()) : mCapacity((int)ilist.size()), mSize((int)ilist.size()),
+			mReserved(0), mAllocator(alloc)
 		{
-			mData = new T[mCapacity];
-			int i = 0;
-			for (T val : ilist)
-				mData[i++] = val;
+			mData = copy_array(ilist.begin(), mSize, mCapacity);
 		}
 
 		/// Destructor
 		~ArrayList() 
 		{
-			if (mData)
-				delete[] mData;
+			clear();
 		}
 
 
@@ -210,17 +353,51 @@ namespace ssuds
 	// @@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@
 	public:
 		/// <summary>
-		///  Inserts a new element at the end of the array
+		///  Inserts a copy of a new element at the end of the array
 		/// </summary>
 		/// <param name="val">the new value to add</param>
-		void append(const T val)
+		void append(const T& val)
 		{
-			// check to see if we need to increase our capacity
-			grow();
+			emplace_back(val);
+		}
 
-			// Stick our new element in the last slot and (sneakily) increase our size in the process
-			mData[mSize] = val;
-			mSize++;
+
+		/// <summary>
+		///  Inserts a new element at the end of the array, moving it in
+		/// </summary>
+		/// <param name="val">the new value to add</param>
+		void append(T&& val)
+		{
+			emplace_back(std::move(val));
+		}
+
+
+		/// <summary>
+		/// Appends copies of every item in items (any container or range that works with a range-based for loop,
+		/// including this list itself), reallocating at most once
+		/// </summary>
+		/// <param name="items">the items to add</param>
+		template <class Range>
+		void append_range(const Range& items)
+		{
+			insert_range(mSize, items);
+		}
+
+
+		/// <summary>
+		/// Gets the data item at the given index without the check operator[] does (so a loop using it can be
+		/// vectorized).  index must be < size.  When SSUDS_CHECKED_ACCESS is on (by default, in debug builds) it is
+		/// checked anyway, and a bad index throws a std::out_of_range exception
+		/// </summary>
+		/// <param name="index">the index of the thing to return</param>
+		/// <returns>a reference to the value at the given index</returns>
+		T& at_unchecked(unsigned int index) const
+		{
+#if SSUDS_CHECKED_ACCESS
+			if (index >= mSize)
+				throw std::out_of_range("Invalid index: " + std::to_string(index));
+#endif
+			return mData[index];
 		}
 
 
@@ -248,13 +425,109 @@ namespace ssuds
 		/// </summary>
 		void clear()
 		{
-			if (mData)
-				delete[] mData;
+			destroy_items(mData, mSize);
+			deallocate_array(mData, mCapacity);
 			mData = nullptr;
 			mSize = 0;
 			mCapacity = 0;
+			mReserved = 0;
+		}
+
+
+		/// <summary>
+		/// Returns a plain pointer to the first item.  The items are contiguous, so [contiguous_begin(),
+		/// contiguous_end()) can be handed to anything that takes random-access iterators (std::sort, etc.).  Both are
+		/// good until the list is next changed
+		/// </summary>
+		T* contiguous_begin()
+		{
+			return mData;
+		}
+
+		const T* contiguous_begin() const
+		{
+			return mData;
+		}
+
+
+		/// <summary>
+		/// Returns a plain pointer just past the last item (see contiguous_begin)
+		/// </summary>
+		T* contiguous_end()
+		{
+			return mData + mSize;
+		}
+
+		const T* contiguous_end() const
+		{
+			return mData + mSize;
+		}
+
+
+		/// <summary>
+		/// Counts the occurrences of the given value (a vector register's worth of items at a time for arithmetic
+		/// types, like find)
+		/// </summary>
+		/// <param name="val">the value to count</param>
+		/// <returns>how many items == val</returns>
+		unsigned int count(const T& val) const
+		{
+			return search_count<T>(mData, mSize, val);
+		}
+
+
+		/// <summary>
+		/// Returns a pointer to the array of items (the first size() of which are in use), or nullptr if there is no
+		/// array.  It is good until the list is next changed
+		/// </summary>
+		T* data()
+		{
+			return mData;
+		}
+
+		const T* data() const
+		{
+			return mData;
+		}
+
+		/// <summary>
+		/// Constructs a new element at the end of the array from args (no copy or move of the element is made).  If
+		/// the array has to grow, the new element is made in the new array before the old ones move there, so args
+		/// may refer to an element of this list
+		/// </summary>
+		/// <param name="args">the arguments to T's constructor</param>
+		/// <returns>a reference to the new element</returns>
+		template <class... Args>
+		T& emplace_back(Args&&... args)
+		{
+			if (mSize == mCapacity)
+			{
+				unsigned int new_capacity = grown_capacity();
+				T* new_array = allocate_array(new_capacity);
+				bool made = false;
+				try
+				{
+					alloc_traits::construct(mAllocator, new_array + mSize, std::forward<Args>(args)...);
+					made = true;
+					relocate(new_array, mData, mSize);
+				}
+				catch (...)
+				{
+					if (made)
+						alloc_traits::destroy(mAllocator, new_array + mSize);
+					deallocate_array(new_array, new_capacity);
+					throw;
+				}
+				deallocate_array(mData, mCapacity);
+				mData = new_array;
+				mCapacity = new_capacity;
+			}
+			else
+				alloc_traits::construct(mAllocator, mData + mSize, std::forward<Args>(args)...);
+			return mData[mSize++];
 		}
 
+
 		/// <summary>
 		/// Returns a special iterator value indicating we've reached the end of iteration
 		/// </summary>
@@ -264,29 +537,98 @@ namespace ssuds
 			return ArrayListIterator(this, ArrayListIteratorType::forward, mSize);
 		}
 
+
+		/// <summary>
+		/// Removes every item for which pred(item) is true, in one pass: each kept item is moved down at most once.
+		/// (If pred throws, the list is still valid but some items may have been moved from.)
+		/// </summary>
+		/// <param name="pred">the test for whether to remove an item</param>
+		/// <param name="resize_if_necessary">if true, the array will be resized if it is now below a quarter of capacity</param>
+		/// <returns>the number of items removed</returns>
+		template <class Pred>
+		unsigned int erase_if(Pred pred, bool resize_if_necessary = true)
+		{
+			unsigned int kept = 0;
+			for (unsigned int i = 0; i < mSize; i++)
+			{
+				if (!pred(mData[i]))
+				{
+					if (kept != i)
+						mData[kept] = std::move(mData[i]);
+					kept++;
+				}
+			}
+
+			unsigned int num_removed = mSize - kept;
+			destroy_items(mData + kept, num_removed);
+			mSize = kept;
+			if (resize_if_necessary)
+				shrink();
+			return num_removed;
+		}
+
+
+		/// <summary>
+		/// Removes the items from index first up to (but not including) index last, moving the items after them
+		/// down in one pass.  Throws a std::out_of_range exception unless first <= last <= size
+		/// </summary>
+		/// <param name="first">the index of the first item to remove</param>
+		/// <param name="last">the index just past the last item to remove</param>
+		/// <param name="resize_if_necessary">if true, the array will be resized if it is now below a quarter of capacity</param>
+		void erase_range(unsigned int first, unsigned int last, bool resize_if_necessary = true)
+		{
+			if (first > last || last > mSize)
+				throw std::out_of_range("Invalid range: " + std::to_string(first) + " to " + std::to_string(last));
+			if (first == last)
+				return;
+
+			std::move(mData + last, mData + mSize, mData + first);
+			destroy_items(mData + mSize - (last - first), last - first);
+			mSize -= last - first;
+			if (resize_if_necessary)
+				shrink();
+		}
+
 		/// <summary>
-		/// Finds the index of the first occurrence of the given value
+		/// Finds the index of the first occurrence of the given value.  For arithmetic types, a vector register's
+		/// worth of items is compared at a time (see simd_search.h)
 		/// </summary>
 		/// <param name="val">the value to search for</param>
 		/// <param name="start_index">the index to start searching at</param>
-		/// <returns></returns>
+		/// <returns>the index, or -1 if val isn't in the list (at or after start_index)</returns>
 		int find(const T val, unsigned int start_index = 0) const
 		{
 			if (start_index >= mSize)
 				throw std::out_of_range("Invalid index: " + std::to_string(start_index));
 
-			for (unsigned int i = start_index; i < mSize; i++)
-			{
-				if (mData[i] == val)
-					return i;
-			}
+			unsigned int index = start_index + search_first<T>(mData + start_index, mSize - start_index, val);
+			return index < mSize ? (int)index : -1;
+		}
+
 
-			// We didn't find it
-			return -1;
+		/// <summary>
+		/// Finds the index of the last occurrence of the given value (searching backwards, a vector register's worth
+		/// of items at a time for arithmetic types, like find)
+		/// </summary>
+		/// <param name="val">the value to search for</param>
+		/// <returns>the index, or -1 if val isn't in the list</returns>
+		int find_last(const T& val) const
+		{
+			unsigned int index = search_last<T>(mData, mSize, val);
+			return index < mSize ? (int)index : -1;
 		}
 
 	
 
+		/// <summary>
+		/// Returns a copy of the allocator our array comes from
+		/// </summary>
+		Allocator get_allocator() const
+		{
+			return mAllocator;
+		}
+
+
 		/// <summary>
 		/// Inserts a new data item at a given index
 		/// </summary>
@@ -300,16 +642,113 @@ namespace ssuds
 			// check to see if we need to increase capacity first
 			grow();
 
-			// Move all the elements that come *after* index up one spot
-			for (unsigned int i = mSize; i > index; i--)
-				mData[i] = mData[i - 1];
-
-			// Put our new elements in spot index and increase our size
-			mData[index] = val;
+			if (index == mSize)
+				alloc_traits::construct(mAllocator, mData + mSize, std::move(val));
+			else
+			{
+				// Move all the elements that come *after* index up one spot.  The last one moves into the
+				// (uninitialized) slot past the end, the rest are moved by assignment
+				alloc_traits::construct(mAllocator, mData + mSize, std::move(mData[mSize - 1]));
+				for (unsigned int i = mSize - 1; i > index; i--)
+					mData[i] = std::move(mData[i - 1]);
+
+				// Put our new elements in spot index
+				mData[index] = std::move(val);
+			}
 			mSize++;
 		}
 
 
+		/// <summary>
+		/// Inserts copies of every item in items (any container or range that works with a range-based for loop,
+		/// including this list itself) starting at index.  The items after index move up once, and the array is
+		/// reallocated at most once
+		/// </summary>
+		/// <param name="index">the index at which to insert (must be >= 0 and <= size)</param>
+		/// <param name="items">the items to insert</param>
+		template <class Range>
+		void insert_range(unsigned int index, const Range& items)
+		{
+			if (index > mSize)
+				throw std::out_of_range("Invalid index: " + std::to_string(index));
+
+			unsigned int num = range_size(items);
+			if (num == 0)
+				return;
+
+			if (mSize + num > mCapacity)
+			{
+				// The new items are copied into the new array first (items may be our own array), then our items
+				// are moved in around them
+				unsigned int new_capacity = grown_capacity();
+				if (new_capacity < mSize + num)
+					new_capacity = mSize + num;
+				T* new_array = allocate_array(new_capacity);
+				unsigned int made = 0;
+				bool front_done = false;
+				try
+				{
+					for (auto it = std::begin(items); made < num; ++it, ++made)
+						alloc_traits::construct(mAllocator, new_array + index + made, *it);
+					transfer(new_array, mData, index);
+					front_done = true;
+					transfer(new_array + index + num, mData + index, mSize - index);
+				}
+				catch (...)
+				{
+					destroy_items(new_array + index, made);
+					if (front_done)
+						destroy_items(new_array, index);
+					deallocate_array(new_array, new_capacity);
+					throw;
+				}
+				destroy_items(mData, mSize);
+				deallocate_array(mData, mCapacity);
+				mData = new_array;
+				mCapacity = new_capacity;
+				mSize += num;
+			}
+			else
+			{
+				// The new items are added at the end (nothing moves, so items may be our own array), then rotated
+				// into place
+				unsigned int old_size = mSize;
+				try
+				{
+					for (auto it = std::begin(items); mSize < old_size + num; ++it, ++mSize)
+						alloc_traits::construct(mAllocator, mData + mSize, *it);
+				}
+				catch (...)
+				{
+					destroy_items(mData + old_size, mSize - old_size);
+					mSize = old_size;
+					throw;
+				}
+				std::rotate(mData + index, mData + old_size, mData + mSize);
+			}
+		}
+
+
+		/// <summary>
+		/// Same as append (for code written against std::vector)
+		/// </summary>
+		/// <param name="val">the new value to add</param>
+		void push_back(const T& val)
+		{
+			emplace_back(val);
+		}
+
+
+		/// <summary>
+		/// Same as append (for code written against std::vector)
+		/// </summary>
+		/// <param name="val">the new value to add</param>
+		void push_back(T&& val)
+		{
+			emplace_back(std::move(val));
+		}
+
+
 		/// <summary>
 		/// Create and return a reverse iterator 
 		/// </summary>
@@ -334,7 +773,7 @@ namespace ssuds
 		/// Removes a data item at the given index
 		/// </summary>
 		/// <param name="index">the index of the thing to remove (will return a std::out_of_bounds exception if invalid (<0 or >= size)</param>
-		/// <param name="resize_if_necessary">if true, the array will be resized if it is now below half capacity</param>
+		/// <param name="resize_if_necessary">if true, the array will be resized if it is now below a quarter of capacity</param>
 		/// <returns>the data item that was just removed</returns>
 		T remove(unsigned int index, bool resize_if_necessary = true)
 		{
@@ -342,13 +781,14 @@ namespace ssuds
 				throw std::out_of_range("Invalid index: " + std::to_string(index));
 
 			// Get the value we'll return at the end (the element removed)
-			T result = mData[index];
+			T result = std::move(mData[index]);
 
 			// Move all elements that come after index down one spot
 			for (unsigned int i = index; i < mSize - 1; i++)
-				mData[i] = mData[i + 1];
+				mData[i] = std::move(mData[i + 1]);
 
-			// Decrement our size
+			// Destroy the (moved-from) last element and decrement our size
+			alloc_traits::destroy(mAllocator, mData + mSize - 1);
 			mSize--;
 
 			// Shrink, if applicable and requested
@@ -360,33 +800,42 @@ namespace ssuds
 		}
 
 		/// <summary>
-		/// Removes all occurrences of a given value.  Uses find and remove internally to do the removal
+		/// Removes all occurrences of a given value, in one pass (see erase_if)
 		/// </summary>
 		/// <param name="val">the value to remove</param>
-		/// <param name="resize_if_necessary">if true, the array will be resized if it is now below half capacity</param>
+		/// <param name="resize_if_necessary">if true, the array will be resized if it is now below a quarter of capacity</param>
 		/// <returns>the number of occurrences of that data item that were removed</returns>
 		int remove_all(const T val, bool resize_if_necessary=true)
 		{
-			int cur_index = 0;
-			int num_removed = 0;
-			while (cur_index >= 0 && cur_index < (int)mSize)
-			{
-				// Find the next occurrence of val, starting at the current position
-				cur_index = find(val, cur_index);
-				if (cur_index >= 0)
-				{
-					// We found one!
-					remove(cur_index, false);
-					num_removed++;
-				}
-			}
+			return (int)erase_if([&val](const T& item) { return item == val; }, resize_if_necessary);
+		}
 
-			if (resize_if_necessary)
-				shrink();
+		/// <summary>
+		/// Makes sure the array has room for at least num_items, so that adding up to that many causes no
+		/// reallocation.  The array is also never automatically shrunk below num_items (until clear or
+		/// shrink_to_fit)
+		/// </summary>
+		/// <param name="num_items">how many items to make room for</param>
+		void reserve(unsigned int num_items)
+		{
+			mReserved = num_items;
+			if (num_items > mCapacity)
+				reallocate(num_items);
+		}
 
-			return num_removed;
+
+		/// <summary>
+		/// Reduces the capacity to the current size (freeing the array entirely if we're empty), and forgets any
+		/// reserve
+		/// </summary>
+		void shrink_to_fit()
+		{
+			mReserved = 0;
+			if (mCapacity > mSize)
+				reallocate(mSize);
 		}
 
+
 		/// <summary>
 		/// Returns the size of the internal array (i.e.) how many things are being stored in the ArrayList
 		/// </summary>
@@ -399,65 +848,169 @@ namespace ssuds
 
 	protected:
 		/// <summary>
-		/// An internal method to resize the array if we are currently at capacity (if we are not, nothing is done)
+		/// An internal method to get an array of n (uninitialized) slots from our allocator (nullptr if n is 0)
 		/// </summary>
-		void grow()
+		T* allocate_array(unsigned int n)
 		{
-			if (mSize == mCapacity)
-			{
-				// Allocate what will become the new array
-				T* new_array = nullptr;
-				if (mCapacity == 0)
-					new_array = new T[msMinCapacity];
-				else
-					new_array = new T[mCapacity * 2];
+			return n > 0 ? alloc_traits::allocate(mAllocator, n) : nullptr;
+		}
 
-				// Copy over data from the old array (if any)
-				if (mData != nullptr)
-				{
-					for (unsigned int i = 0; i < mSize; i++)
-						new_array[i] = mData[i];
 
-					// Destroy the old array
-					delete[] mData;
-				}
+		/// <summary>
+		/// An internal method to give an array from allocate_array back to our allocator (its items must already
+		/// be destroyed)
+		/// </summary>
+		void deallocate_array(T* arr, unsigned int n)
+		{
+			if (arr)
+				alloc_traits::deallocate(mAllocator, arr, n);
+		}
 
-				// Make the new array *the* array
-				mData = new_array;
 
-				// Note that our capacity is now double what it used to be
-				if (mCapacity == 0)
-					mCapacity = msMinCapacity;
-				else
-					mCapacity *= 2;
+		/// <summary>
+		/// An internal method to destroy the first n items of an array
+		/// </summary>
+		void destroy_items(T* arr, unsigned int n)
+		{
+			for (unsigned int i = 0; i < n; i++)
+				alloc_traits::destroy(mAllocator, arr + i);
+		}
+
+
+		/// <summary>
+		/// An internal method to make a new array of capacity slots holding copies of the n items at src.  If a copy
+		/// throws, everything made so far is freed
+		/// </summary>
+		T* copy_array(const T* src, unsigned int n, unsigned int capacity)
+		{
+			T* result = allocate_array(capacity);
+			unsigned int i = 0;
+			try
+			{
+				for (; i < n; i++)
+					alloc_traits::construct(mAllocator, result + i, src[i]);
 			}
+			catch (...)
+			{
+				destroy_items(result, i);
+				deallocate_array(result, capacity);
+				throw;
+			}
+			return result;
 		}
 
 
 		/// <summary>
-		/// An internal method to see if the array can be shrunk (capacity reduced by half, down to msMinCapacity)
+		/// An internal method to move the n items at src into the uninitialized slots at dest (the originals are left
+		/// for the caller to destroy).  Trivially copyable items are copied all at once with memcpy.  Others are
+		/// moved if their move constructor can't throw and copied if it can (std::move_if_noexcept), so that if a
+		/// copy throws the new items can be destroyed and src is left as it was
 		/// </summary>
-		void shrink()
+		void transfer(T* dest, T* src, unsigned int n)
 		{
-			if (mSize < mCapacity / 2 && mCapacity >= msMinCapacity * 2)
+			if (std::is_trivially_copyable<T>::value)
+			{
+				if (n > 0)
+					std::memcpy((void*)dest, (const void*)src, sizeof(T) * n);
+				return;
+			}
+			unsigned int i = 0;
+			try
+			{
+				for (; i < n; i++)
+					alloc_traits::construct(mAllocator, dest + i, std::move_if_noexcept(src[i]));
+			}
+			catch (...)
 			{
-				// Allocate what will become the new array
-				T* new_array = new T[mCapacity / 2];
+				destroy_items(dest, i);
+				throw;
+			}
+		}
 
-				// Copy over data from the old array (if any)
-				for (unsigned int i = 0; i < mSize; i++)
-					new_array[i] = mData[i];
-			
 
-				// Destroy the old array
-				delete[] mData;
+		/// <summary>
+		/// An internal method to transfer the n items at src to dest and then destroy the originals
+		/// </summary>
+		void relocate(T* dest, T* src, unsigned int n)
+		{
+			transfer(dest, src, n);
+			destroy_items(src, n);
+		}
+
+
+		/// <summary>
+		/// An internal method to count the items in a range (by walking it -- not every range has a size)
+		/// </summary>
+		template <class Range>
+		static unsigned int range_size(const Range& items)
+		{
+			unsigned int n = 0;
+			for (auto it = std::begin(items); it != std::end(items); ++it)
+				n++;
+			return n;
+		}
 
-				// Make the new array *the* array
-				mData = new_array;
 
-				// Note that our capacity is now double what it used to be
-				mCapacity /= 2;
+		/// <summary>
+		/// An internal method to move our items into a new array of new_capacity (>= mSize) slots
+		/// </summary>
+		void reallocate(unsigned int new_capacity)
+		{
+			T* new_array = allocate_array(new_capacity);
+			try
+			{
+				relocate(new_array, mData, mSize);
 			}
+			catch (...)
+			{
+				deallocate_array(new_array, new_capacity);
+				throw;
+			}
+			deallocate_array(mData, mCapacity);
+			mData = new_array;
+			mCapacity = new_capacity;
+		}
+
+
+		/// <summary>
+		/// The capacity we grow to when we're full (as GrowthPolicy says, but at least one more slot and at least
+		/// msMinCapacity)
+		/// </summary>
+		unsigned int grown_capacity() const
+		{
+			unsigned int result = GrowthPolicy::next_capacity(mCapacity, sizeof(T));
+			if (result <= mCapacity)
+				result = mCapacity + 1;
+			return result < (unsigned int)msMinCapacity ? msMinCapacity : result;
+		}
+
+
+		/// <summary>
+		/// An internal method to resize the array if we are currently at capacity (if we are not, nothing is done)
+		/// </summary>
+		void grow()
+		{
+			if (mSize == mCapacity)
+				reallocate(grown_capacity());
+		}
+
+
+		/// <summary>
+		/// An internal method to see if the array can be shrunk: once it is under a quarter full, its capacity is
+		/// halved (down to msMinCapacity, and never below what was reserved).  Waiting until a quarter, rather than
+		/// half, means it takes at least capacity / 4 appends after a shrink before we have to grow again
+		/// </summary>
+		void shrink()
+		{
+			if (mSize < mCapacity / 4 && mCapacity >= msMinCapacity * 2 && mCapacity / 2 >= mReserved)
+				reallocate(mCapacity / 2);
 		}
 	};
+
+	namespace pmr
+	{
+		/// An ArrayList whose array comes from a std::pmr::memory_resource (e.g. an ssuds::MonotonicArena)
+		template <class T, class GrowthPolicy = DoublingGrowth>
+		using ArrayList = ssuds::ArrayList<T, std::pmr::polymorphic_allocator<T>, GrowthPolicy>;
+	}
 }
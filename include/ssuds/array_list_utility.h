@@ -20,16 +20,19 @@ namespace ssuds
 	/// <param name="left">The left-most index to consider</param>
 	/// <param name="right">The right-most index to consider (inclusive)</param>
 	/// <param name="op_count">Used to track the number of swaps</param>
-	template <class T>
-	int _quicksort_pivot(ArrayList<T>& aList, SortOrder type, int left, int right, unsigned long& op_count)
+	template <class T, class Allocator, class GrowthPolicy>
+	int _quicksort_pivot(ArrayList<T, Allocator, GrowthPolicy>& aList, SortOrder type, int left, int right, unsigned long& op_count)
 	{
+		// The items are used through data() (left and right are always in range), so nothing is bounds-checked
+		T* items = aList.data();
+
 		// Pick a value to pivot around.  Some authors choose the first element, but I don't
 		// think that will perform well for an already-sorted list.  I generally pick the middle 
 		// element.  Put this value in the last spot so we leave it alone for a bit
 		int mid_index = (left + right) / 2;
-		T pivot_val = aList[mid_index];
-		aList[mid_index] = aList[right];
-		aList[right] = pivot_val;
+		T pivot_val = items[mid_index];
+		items[mid_index] = items[right];
+		items[right] = pivot_val;
 
 		// Scan indicies from left...right.  If we see a value less than the pivot value, swap
 		// it with the swap_index (and add one to swap_index).  Once we reach the end, the swap index
@@ -38,12 +41,12 @@ namespace ssuds
 		int swap_index = left;
 		for (int i = left; i <= right; i++)
 		{
-			if (pivot_val == aList[i] || _out_of_order(type, pivot_val, aList[i]))
+			if (pivot_val == items[i] || _out_of_order(type, pivot_val, items[i]))
 			{
 				++op_count;
-				T temp = aList[i];
-				aList[i] = aList[swap_index];
-				aList[swap_index++] = temp;
+				T temp = items[i];
+				items[i] = items[swap_index];
+				items[swap_index++] = temp;
 			}
 		}
 
@@ -61,8 +64,8 @@ namespace ssuds
 	/// <param name="left">The left-most index of the portion of alist we're modifying</param>
 	/// <param name="right">The right-most index of the portion of alist we're modifying</param>
 	/// <param name="op_count">used to track the total number of operations performed by quicksort</param>
-	template <class T>
-	void _quicksort_recursive(ArrayList<T>& aList, SortOrder type, int left, int right, unsigned long& op_count)
+	template <class T, class Allocator, class GrowthPolicy>
+	void _quicksort_recursive(ArrayList<T, Allocator, GrowthPolicy>& aList, SortOrder type, int left, int right, unsigned long& op_count)
 	{
 		if (left >= right)
 			return;
@@ -100,9 +103,10 @@ namespace ssuds
 	/// <param name="search_value">The value to search for</param>
 	/// <param name="num_ops">If not nullptr, the number of comparisons performed is written here</param>
 	/// <returns>The index of an occurrence of search_value (or -1 if none are present in alist)</returns>
-	template <class T>
-	int find_binary_search(const ArrayList<T>& alist, SortOrder sort_order, const T& search_value, unsigned long* num_ops = nullptr)
+	template <class T, class Allocator, class GrowthPolicy>
+	int find_binary_search(const ArrayList<T, Allocator, GrowthPolicy>& alist, SortOrder sort_order, const T& search_value, unsigned long* num_ops = nullptr)
 	{
+		const T* items = alist.data();
 		long comparisons = 0;
 		int left = 0;
 		int right = alist.size() - 1;
@@ -110,13 +114,13 @@ namespace ssuds
 		{
 			int mid = (left + right) >> 1;			// divide by 2 (the average)
 			comparisons++;
-			if (alist[mid] == search_value)
+			if (items[mid] == search_value)
 			{
 				if (num_ops != nullptr)
 					*num_ops = comparisons;
 				return mid;
 			}
-			else if (_out_of_order(sort_order, search_value, alist[mid]))
+			else if (_out_of_order(sort_order, search_value, items[mid]))
 				left = mid + 1;
 			else
 				right = mid - 1;
@@ -134,8 +138,8 @@ namespace ssuds
 	/// <param name="alist">the ArrayList we wish to sort</param>
 	/// <param name="type">The type of sort to perform</param>
 	/// <returns>The number of swaps performed while sorting</returns>
-	template <class T>
-	unsigned long quicksort(ArrayList<T>& alist, SortOrder type)
+	template <class T, class Allocator, class GrowthPolicy>
+	unsigned long quicksort(ArrayList<T, Allocator, GrowthPolicy>& alist, SortOrder type)
 	{
 		// Reference: https://en.wikipedia.org/wiki/Quicksort
 		unsigned long op_count = 0;
@@ -151,19 +155,20 @@ namespace ssuds
 	/// <param name="alist">the ArrayList we wish to sort</param>
 	/// <param name="type">The type of sort to perform</param>
 	/// <returns>The number of swaps performed during bubble-sort</returns>
-	template <class T>
-	long bubblesort(ArrayList<T>& alist, SortOrder type)
+	template <class T, class Allocator, class GrowthPolicy>
+	long bubblesort(ArrayList<T, Allocator, GrowthPolicy>& alist, SortOrder type)
 	{
+		T* items = alist.data();
 		long swaps = 0;
 		for (unsigned int z = 0; z < alist.size(); z++)
 		{
 			bool sorted = true;
 			for (unsigned int i = 0; i < alist.size() - 1 - z; i++)
 			{
-				if (_out_of_order(type, alist[i], alist[i + 1]))
+				if (_out_of_order(type, items[i], items[i + 1]))
 				{
 					sorted = false;
-					std::swap(alist[i], alist[i + 1]);
+					std::swap(items[i], items[i + 1]);
 					swaps++;
 				}
 			}
@@ -179,18 +184,19 @@ namespace ssuds
 	/// </summary>
 	/// <typeparam name="T">The type of ArrayList we're working on</typeparam>
 	/// <param name="alist">the ArrayList we wish to sort</param>
-	template <class T>
-	void shuffle(ArrayList<T>& alist)
+	template <class T, class Allocator, class GrowthPolicy>
+	void shuffle(ArrayList<T, Allocator, GrowthPolicy>& alist)
 	{
 		// Reference: https://www.cplusplus.com/reference/random/
 		// Reference: https://en.wikipedia.org/wiki/Fisher%E2%80%93Yates_shuffle
 		std::default_random_engine generator;
+		T* items = alist.data();
 		for (int i = alist.size() - 1; i > 0; i--)
 		{
 			std::uniform_int_distribution<int> distribution(0, i);
 			int j = distribution(generator);  // generates number in the range 0...i
 			
-			std::swap(alist[i], alist[j]);
+			std::swap(items[i], items[j]);
 		}
 	}
 }
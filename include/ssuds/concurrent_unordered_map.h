@@ -0,0 +1,291 @@
+#pragma once
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <hash.h>
+#include <unordered_map.h>
+
+namespace ssuds
+{
+	/// <summary>
+	/// A thread-safe map built out of N independent UnorderedMap "shards", each with its own reader-writer lock.
+	/// A key always lives in the same shard (picked from its hash code), so threads working on keys in different
+	/// shards never wait for each other, and lookups in the same shard only wait for writers.  Each shard grows
+	/// (rehashes) on its own, so growth only ever blocks one shard's worth of keys.
+	/// There is no operator[] or iterator: a reference into a shard would outlive the lock protecting it.  Use
+	/// find (which copies the value out), update (which runs a function on the value under the lock) or for_each.
+	/// </summary>
+	/// <typeparam name="K">The key type</typeparam>
+	/// <typeparam name="V">The value type</typeparam>
+	/// <typeparam name="Hash">The hash function (see UnorderedMap)</typeparam>
+	/// <typeparam name="Probing">The probing policy of each shard (see UnorderedMap)</typeparam>
+	/// <typeparam name="HashStorage">The hash-storage policy of each shard (see UnorderedMap)</typeparam>
+	/// <typeparam name="Allocator">Where each shard's table (and, rebound, the array of shards) comes from (see UnorderedMap)</typeparam>
+	template <class K, class V, class Hash = FastHash<K>, class Probing = LinearProbing, class HashStorage = NoStoredHash,
+		class Allocator = std::allocator<std::pair<K, V>>>
+	class ConcurrentUnorderedMap
+	{
+	public:
+		/// The type of map each shard holds
+		typedef UnorderedMap<K, V, Hash, Probing, HashStorage, Allocator> shard_map_type;
+
+	protected:
+		/// <summary>
+		/// One lock and the part of the map it protects.  Each shard gets its own cache line(s) so that locking
+		/// one shard doesn't slow down threads using its neighbors (false sharing)
+		/// </summary>
+		struct alignas(64) Shard
+		{
+			mutable std::shared_mutex mLock;
+			shard_map_type mMap;
+
+			explicit Shard(const Allocator& alloc) : mMap(alloc)
+			{
+				// intentionally empty
+			}
+		};
+
+		typedef typename std::allocator_traits<Allocator>::template rebind_alloc<Shard> shard_allocator_type;
+
+		/// An array of mNumShards shards
+		Shard* mShards;
+
+		/// The number of shards (always a power of two)
+		unsigned int mNumShards;
+
+		/// The shard for a hash code is its top log2(mNumShards) bits (after mixing), i.e. mix >> mShardShift
+		unsigned int mShardShift;
+
+		/// Used to pick a key's shard
+		Hash mHashGenerator;
+
+		/// Where the shards come from (and what each shard's map is given)
+		Allocator mAllocator;
+
+		/// The default number of shards -- enough that a few dozen threads rarely pick the same one
+		static const unsigned int msDefaultShards = 64;
+
+		/// <summary>
+		/// Picks the shard for a key.  Each shard's UnorderedMap picks a slot from the top bits of the key's
+		/// (fibonacci-hashed) hash code, so the shard is picked from differently mixed bits -- otherwise every key in
+		/// a shard would share its top bits and pile up in one part of that shard's table
+		/// </summary>
+		template <class Q>
+		Shard& shard_for(const Q& key) const
+		{
+			unsigned long long mixed = mix_integer((unsigned long long)mHashGenerator(key));
+			return mShards[mNumShards == 1 ? 0 : (unsigned int)(mixed >> mShardShift)];
+		}
+
+		/// The lookup methods below accept K or anything the shards' find accepts (see _is_transparent_key)
+		template <class Q>
+		using enable_if_lookup_key = typename std::enable_if<std::is_same<Q, K>::value || _is_transparent_key<Hash, K, Q>::value, int>::type;
+
+	public:
+		/// <summary>
+		/// Constructor
+		/// </summary>
+		/// <param name="num_shards">how many shards (locks) to split the map into.  Rounded up to a power of two</param>
+		/// <param name="hash_function">the Hash object to use (only needed if Hash has some state)</param>
+		/// <param name="alloc">the allocator for the shards and their tables</param>
+		ConcurrentUnorderedMap(unsigned int num_shards = msDefaultShards, const Hash& hash_function = Hash(), const Allocator& alloc = Allocator()) :
+			mHashGenerator(hash_function), mAllocator(alloc)
+		{
+			if (num_shards == 0)
+				throw std::invalid_argument("Invalid number of shards: 0");
+			mNumShards = 1;
+			mShardShift = 64;
+			while (mNumShards < num_shards)
+			{
+				mNumShards *= 2;
+				mShardShift--;
+			}
+			shard_allocator_type shard_alloc(mAllocator);
+			mShards = std::allocator_traits<shard_allocator_type>::allocate(shard_alloc, mNumShards);
+			unsigned int built = 0;
+			try
+			{
+				for (; built < mNumShards; built++)
+					::new ((void*)(mShards + built)) Shard(mAllocator);
+			}
+			catch (...)
+			{
+				while (built > 0)
+					mShards[--built].~Shard();
+				std::allocator_traits<shard_allocator_type>::deallocate(shard_alloc, mShards, mNumShards);
+				throw;
+			}
+		}
+
+		/// Makes an empty map with the default number of shards, whose memory comes from alloc (for a pmr map this can
+		/// be given a std::pmr::memory_resource*)
+		explicit ConcurrentUnorderedMap(const Allocator& alloc) : ConcurrentUnorderedMap(msDefaultShards, Hash(), alloc)
+		{
+			// intentionally empty
+		}
+
+		/// The shards (and their locks) can't be shared or handed over, so neither can the map
+		ConcurrentUnorderedMap(const ConcurrentUnorderedMap& other) = delete;
+		ConcurrentUnorderedMap& operator=(const ConcurrentUnorderedMap& other) = delete;
+
+		/// Destructor.  No other thread may be using the map
+		~ConcurrentUnorderedMap()
+		{
+			for (unsigned int i = 0; i < mNumShards; i++)
+				mShards[i].~Shard();
+			shard_allocator_type shard_alloc(mAllocator);
+			std::allocator_traits<shard_allocator_type>::deallocate(shard_alloc, mShards, mNumShards);
+		}
+
+		/// Returns a copy of the allocator the shards come from
+		Allocator get_allocator() const
+		{
+			return mAllocator;
+		}
+
+		/// <summary>
+		/// Returns the number of shards the map is split into
+		/// </summary>
+		unsigned int num_shards() const
+		{
+			return mNumShards;
+		}
+
+		/// <summary>
+		/// Adds key with a value constructed from args, if key isn't already in the map
+		/// </summary>
+		/// <returns>true if the key was added</returns>
+		template <class... Args>
+		bool try_emplace(const K& key, Args&&... args)
+		{
+			Shard& shard = shard_for(key);
+			std::unique_lock<std::shared_mutex> lock(shard.mLock);
+			return shard.mMap.try_emplace(key, std::forward<Args>(args)...).second;
+		}
+
+		/// <summary>
+		/// Sets the value for key, adding the key if it isn't already in the map
+		/// </summary>
+		/// <returns>true if the key was added, false if an existing value was replaced</returns>
+		template <class M>
+		bool insert_or_assign(const K& key, M&& value)
+		{
+			Shard& shard = shard_for(key);
+			std::unique_lock<std::shared_mutex> lock(shard.mLock);
+			return shard.mMap.insert_or_assign(key, std::forward<M>(value)).second;
+		}
+
+		/// <summary>
+		/// Runs func(V&) on the value for key while holding its shard's lock, first adding the key (with a value
+		/// constructed from args) if it isn't in the map.  This is how to do a read-modify-write (e.g. a counter)
+		/// without another thread getting in between.  func must not use this map
+		/// </summary>
+		/// <returns>true if the key was added</returns>
+		template <class F, class... Args>
+		bool update(const K& key, F&& func, Args&&... args)
+		{
+			Shard& shard = shard_for(key);
+			std::unique_lock<std::shared_mutex> lock(shard.mLock);
+			std::pair<typename shard_map_type::unorderMapIterator, bool> result = shard.mMap.try_emplace(key, std::forward<Args>(args)...);
+			func(result.first->second);
+			return result.second;
+		}
+
+		/// <summary>
+		/// Looks up key, copying its value into value if it is found
+		/// </summary>
+		/// <returns>true if the key was found</returns>
+		template <class Q, enable_if_lookup_key<Q> = 0>
+		bool find(const Q& key, V& value) const
+		{
+			Shard& shard = shard_for(key);
+			std::shared_lock<std::shared_mutex> lock(shard.mLock);
+			typename shard_map_type::unorderMapIterator it = shard.mMap.find(key);
+			if (it == shard.mMap.end())
+				return false;
+			value = it->second;
+			return true;
+		}
+
+		/// <summary>
+		/// Returns true if key is in the map
+		/// </summary>
+		template <class Q, enable_if_lookup_key<Q> = 0>
+		bool contains(const Q& key) const
+		{
+			Shard& shard = shard_for(key);
+			std::shared_lock<std::shared_mutex> lock(shard.mLock);
+			return shard.mMap.find(key) != shard.mMap.end();
+		}
+
+		/// <summary>
+		/// Removes key from the map
+		/// </summary>
+		/// <returns>false if the key was not in the map</returns>
+		template <class Q, enable_if_lookup_key<Q> = 0>
+		bool remove(const Q& key)
+		{
+			Shard& shard = shard_for(key);
+			std::unique_lock<std::shared_mutex> lock(shard.mLock);
+			return shard.mMap.remove(key);
+		}
+
+		/// <summary>
+		/// Returns the number of items in the map.  Each shard is counted under its own lock, so if other threads
+		/// are adding or removing this is only a snapshot
+		/// </summary>
+		unsigned int size() const
+		{
+			unsigned int result = 0;
+			for (unsigned int i = 0; i < mNumShards; i++)
+			{
+				std::shared_lock<std::shared_mutex> lock(mShards[i].mLock);
+				result += mShards[i].mMap.size();
+			}
+			return result;
+		}
+
+		/// <summary>
+		/// Makes room for about num_items in total (spread evenly over the shards), so a bulk load of a known size
+		/// doesn't have to grow the shards as it goes
+		/// </summary>
+		void reserve(unsigned int num_items)
+		{
+			// A bit of slack, since keys never spread perfectly evenly
+			unsigned int per_shard = num_items / mNumShards + num_items / mNumShards / 8 + 1;
+			for (unsigned int i = 0; i < mNumShards; i++)
+			{
+				std::unique_lock<std::shared_mutex> lock(mShards[i].mLock);
+				mShards[i].mMap.reserve(per_shard);
+			}
+		}
+
+		/// <summary>
+		/// Calls func(const std::pair<K, V>&) for every item, one shard at a time while holding that shard's (shared)
+		/// lock.  func must not use this map
+		/// </summary>
+		template <class F>
+		void for_each(F&& func) const
+		{
+			for (unsigned int i = 0; i < mNumShards; i++)
+			{
+				std::shared_lock<std::shared_mutex> lock(mShards[i].mLock);
+				for (typename shard_map_type::unorderMapIterator it = mShards[i].mMap.begin(); it != mShards[i].mMap.end(); ++it)
+					func((const std::pair<K, V>&)*it);
+			}
+		}
+	};
+
+	namespace pmr
+	{
+		/// A ConcurrentUnorderedMap whose shards come from a std::pmr::memory_resource (e.g. an ssuds::MonotonicArena)
+		template <class K, class V, class Hash = FastHash<K>, class Probing = LinearProbing, class HashStorage = NoStoredHash>
+		using ConcurrentUnorderedMap = ssuds::ConcurrentUnorderedMap<K, V, Hash, Probing, HashStorage, std::pmr::polymorphic_allocator<std::pair<K, V>>>;
+	}
+}
@@ -0,0 +1,175 @@
+#pragma once
+#include <cstddef>
+
+// The hashed containers keep one "control byte" per slot.  An empty slot holds msEmpty (high bit set) and
+// a used slot holds a 7-bit fragment of its item's hash.  A ControlGroup looks at msWidth consecutive control
+// bytes at once so a probe can rule out a whole run of slots without touching the slots themselves.
+// Define SSUDS_DISABLE_SIMD to force the portable (one byte at a time) version.
+#if !defined(SSUDS_DISABLE_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define SSUDS_HAVE_SSE2 1
+#include <emmintrin.h>
+#if defined(__AVX2__)
+#define SSUDS_HAVE_AVX2 1
+#include <immintrin.h>
+#endif
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace ssuds
+{
+	/// <summary>
+	/// Returns the index of the lowest set bit of mask (which must not be 0)
+	/// </summary>
+	/// <param name="mask">a non-zero bit mask</param>
+	/// <returns>the number of trailing zero bits</returns>
+	inline unsigned int count_trailing_zeros(unsigned int mask)
+	{
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanForward(&index, mask);
+		return (unsigned int)index;
+#else
+		return (unsigned int)__builtin_ctz(mask);
+#endif
+	}
+
+
+	/// <summary>
+	/// Returns the index of the highest set bit of mask (which must not be 0)
+	/// </summary>
+	/// <param name="mask">a non-zero bit mask</param>
+	/// <returns>31 minus the number of leading zero bits</returns>
+	inline unsigned int highest_set_bit(unsigned int mask)
+	{
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanReverse(&index, mask);
+		return (unsigned int)index;
+#else
+		return 31u - (unsigned int)__builtin_clz(mask);
+#endif
+	}
+
+
+	/// <summary>
+	/// Asks the CPU to start loading the cache line holding p (for reading) without waiting for it.  Only a hint:
+	/// p doesn't have to be valid, and this does nothing on compilers we don't know how to ask
+	/// </summary>
+	inline void prefetch(const void* p)
+	{
+#if defined(SSUDS_HAVE_SSE2)
+		_mm_prefetch((const char*)p, _MM_HINT_T0);
+#elif defined(__GNUC__)
+		__builtin_prefetch(p);
+#else
+		(void)p;
+#endif
+	}
+
+
+	/// <summary>
+	/// A read-only window of ControlGroup::msWidth control bytes.  Each match method returns a bit mask where
+	/// bit i is set if the i-th control byte in the window satisfies the test.
+	/// </summary>
+	class ControlGroup
+	{
+	public:
+		/// The control byte value used to mark an empty slot
+		static const unsigned char msEmpty = 0x80;
+
+		/// The number of control bytes looked at by one group
+#if defined(SSUDS_HAVE_AVX2)
+		static const unsigned int msWidth = 32;
+#else
+		static const unsigned int msWidth = 16;
+#endif
+
+		/// <summary>
+		/// Returns true if the given control byte is for a used slot
+		/// </summary>
+		static bool is_full(unsigned char control)
+		{
+			return (control & msEmpty) == 0;
+		}
+
+		/// <summary>
+		/// Gets the 7-bit fragment of a hash code that is stored in a used slot's control byte.  We use the
+		/// bottom bits since the top bits pick the home slot.
+		/// </summary>
+		static unsigned char fragment(unsigned long long hash)
+		{
+			return (unsigned char)(hash & 0x7F);
+		}
+
+		/// <summary>
+		/// Constructor -- the caller must make sure msWidth bytes are readable starting at control
+		/// </summary>
+		/// <param name="control">a pointer to the first control byte of the window</param>
+		explicit ControlGroup(const unsigned char* control) : mControl(control)
+		{
+			// intentionally empty
+		}
+
+		/// <summary>
+		/// Finds the used slots whose hash fragment equals frag
+		/// </summary>
+		/// <param name="frag">the 7-bit fragment (see fragment())</param>
+		/// <returns>a bit mask of matching slots</returns>
+		unsigned int match(unsigned char frag) const
+		{
+#if defined(SSUDS_HAVE_AVX2)
+			__m256i ctrl = _mm256_loadu_si256((const __m256i*)mControl);
+			return (unsigned int)_mm256_movemask_epi8(_mm256_cmpeq_epi8(ctrl, _mm256_set1_epi8((char)frag)));
+#elif defined(SSUDS_HAVE_SSE2)
+			__m128i ctrl = _mm_loadu_si128((const __m128i*)mControl);
+			return (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)frag)));
+#else
+			unsigned int result = 0;
+			for (unsigned int i = 0; i < msWidth; i++)
+			{
+				if (mControl[i] == frag)
+					result |= 1u << i;
+			}
+			return result;
+#endif
+		}
+
+		/// <summary>
+		/// Finds the empty slots in this window
+		/// </summary>
+		/// <returns>a bit mask of empty slots</returns>
+		unsigned int match_empty() const
+		{
+			// msEmpty is the only control value with the high bit set, so the sign bits are exactly the empties
+#if defined(SSUDS_HAVE_AVX2)
+			return (unsigned int)_mm256_movemask_epi8(_mm256_loadu_si256((const __m256i*)mControl));
+#elif defined(SSUDS_HAVE_SSE2)
+			return (unsigned int)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)mControl));
+#else
+			unsigned int result = 0;
+			for (unsigned int i = 0; i < msWidth; i++)
+			{
+				if (!is_full(mControl[i]))
+					result |= 1u << i;
+			}
+			return result;
+#endif
+		}
+
+		/// <summary>
+		/// Finds the used slots in this window (an occupancy bitmap of the window)
+		/// </summary>
+		/// <returns>a bit mask of used slots</returns>
+		unsigned int match_full() const
+		{
+			return ~match_empty() & (unsigned int)((1ull << msWidth) - 1);
+		}
+
+	protected:
+		/// The first control byte of the window
+		const unsigned char* mControl;
+	};
+}
@@ -0,0 +1,710 @@
+#pragma once
+#include <cstring>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <control_group.h>
+#include <hash.h>
+
+namespace ssuds
+{
+	/// <summary>
+	/// A hash map from strings to V's, laid out like UnorderedMap (control bytes probed a ControlGroup at a time,
+	/// fibonacci hashing, backward-shift deletion), but without a std::string per key.  Every key's characters are
+	/// appended to one big "arena" of chars, and a slot only holds a 12-byte KeyRef: where the key is in the
+	/// arena, its length and the top 32 bits of its hash code.  That means no heap allocation per key, far less
+	/// memory per entry, and a key comparison only happens when the control byte and the stored hash both match
+	/// (and is then one memcmp into a mostly-sequential buffer).  Removing a key leaves its characters in the
+	/// arena as garbage, which is squeezed out (compacted) the next time the table is rebuilt or the arena fills
+	/// up, once it's over half of the arena.  Keys are limited to 4GB of characters in total.
+	/// </summary>
+	/// <typeparam name="V">The value type</typeparam>
+	/// <typeparam name="Hash">A hash function taking a std::string_view (see UnorderedMap)</typeparam>
+	/// <typeparam name="Allocator">Where the values come from, and (rebound) the control bytes, KeyRefs and arena.  As
+	/// with UnorderedMap, it goes with the table when a map is moved or swapped</typeparam>
+	template <class V, class Hash = FastHash<std::string_view>, class Allocator = std::allocator<V>>
+	class FlatStringMap
+	{
+		static_assert(std::is_same<typename std::allocator_traits<Allocator>::value_type, V>::value, "Allocator::value_type must be V");
+
+	protected:
+		/// <summary>
+		/// What a used slot holds about its key
+		/// </summary>
+		struct KeyRef
+		{
+			/// Where the key's characters start in mArena
+			unsigned int mOffset;
+
+			/// The number of characters in the key
+			unsigned int mLength;
+
+			/// The top 32 bits of the key's hash code (enough to find its home slot in any table we can have)
+			unsigned int mHash;
+		};
+
+		// the keys' characters, back to back (with no terminators).  mArenaSize chars are in use (including
+		// mDeadChars from removed keys) out of mArenaCapacity
+		char* mArena;
+		unsigned int mArenaSize;
+		unsigned int mArenaCapacity;
+		unsigned int mDeadChars;
+
+		// the control bytes (see UnorderedMap::mControl), and for each slot a KeyRef and a value.  mValues is
+		// uninitialized storage: a V only exists in a used slot
+		unsigned char* mControl;
+		KeyRef* mKeys;
+		V* mValues;
+
+		unsigned int mSize;
+		unsigned int mCapacity;
+
+		// the home slot is hash >> mShift
+		unsigned int mShift;
+
+		float mMaxLoadFactor;
+		Hash mHashGenerator;
+
+		// where the table's arrays and the arena come from
+		Allocator mAllocator;
+
+		// a std::string whose characters come from our allocator
+		typedef std::basic_string<char, std::char_traits<char>, typename std::allocator_traits<Allocator>::template rebind_alloc<char>> arena_string;
+
+		static const unsigned int msMinCapacity = 8;
+		static const unsigned int msMinArenaCapacity = 64;
+		static constexpr float msDefaultMaxLoadFactor = 0.75f;
+
+		// see UnorderedMap::msFibonacciMultiplier
+		static const unsigned long long msFibonacciMultiplier = 11400714819323198485ull;
+
+	public:
+		/// <summary>
+		/// Steps through the used slots (skipping unused ones a ControlGroup at a time, like UnorderedMap's
+		/// iterator).  Dereferencing gives a (key, value reference) pair -- the key is a view into the map's
+		/// arena, which is good until the map is next changed.  IsConst makes the value reference const (the
+		/// const_iterator a const map hands out)
+		/// </summary>
+		template <bool IsConst>
+		class basic_iterator
+		{
+		public:
+			typedef typename std::conditional<IsConst, const V&, V&>::type reference_type;
+
+		protected:
+			const FlatStringMap* mMap;
+			unsigned int mPosition;
+
+			basic_iterator(const FlatStringMap* map, unsigned int start_index) : mMap(map), mPosition(start_index)
+			{
+				skip_unused();
+			}
+
+			void skip_unused()
+			{
+				while (mPosition < mMap->mCapacity)
+				{
+					unsigned int full = ControlGroup(mMap->mControl + mPosition).match_full();
+					if (full != 0)
+					{
+						mPosition += count_trailing_zeros(full);
+						if (mPosition > mMap->mCapacity)
+							mPosition = mMap->mCapacity;
+						return;
+					}
+					mPosition += ControlGroup::msWidth;
+				}
+				mPosition = mMap->mCapacity;
+			}
+		public:
+			friend class FlatStringMap;
+			template <bool> friend class basic_iterator;
+
+			/// An iterator converts to a const_iterator (not the other way around)
+			template <bool WasConst, typename std::enable_if<IsConst && !WasConst, int>::type = 0>
+			basic_iterator(const basic_iterator<WasConst>& other) : mMap(other.mMap), mPosition(other.mPosition)
+			{
+				// intentionally empty
+			}
+
+			bool operator==(const basic_iterator& other) const
+			{
+				return mMap == other.mMap && mPosition == other.mPosition;
+			}
+
+			bool operator!=(const basic_iterator& other) const
+			{
+				return !(*this == other);
+			}
+
+			basic_iterator& operator++()
+			{
+				++mPosition;
+				skip_unused();
+				return *this;
+			}
+
+			std::pair<std::string_view, reference_type> operator*() const
+			{
+				return std::pair<std::string_view, reference_type>(mMap->key_at(mPosition), mMap->mValues[mPosition]);
+			}
+		};
+
+		typedef basic_iterator<false> iterator;
+		typedef basic_iterator<true> const_iterator;
+
+	protected:
+		/// The hash code for a key (the hash function's result, fibonacci hashed)
+		unsigned long long hashGen(std::string_view key) const
+		{
+			return (unsigned long long)mHashGenerator(key) * msFibonacciMultiplier;
+		}
+
+		/// The key in a used slot
+		std::string_view key_at(unsigned int ind) const
+		{
+			return std::string_view(mArena + mKeys[ind].mOffset, mKeys[ind].mLength);
+		}
+
+		/// Rebuilds a full hash code's top bits (all that matter for finding a home slot) from a KeyRef
+		static unsigned long long stored_hash(const KeyRef& ref)
+		{
+			return (unsigned long long)ref.mHash << 32;
+		}
+
+		/// Sets the control byte of a slot, along with its mirror(s) past the end of the table
+		void set_control(unsigned int ind, unsigned char control)
+		{
+			mControl[ind] = control;
+			for (unsigned int i = ind + mCapacity; i < mCapacity + ControlGroup::msWidth - 1; i += mCapacity)
+				mControl[i] = control;
+		}
+
+		/// Gets an (uninitialized) array of n T's from our allocator, rebound to T
+		template <class T>
+		T* allocate_array(std::size_t n)
+		{
+			typename std::allocator_traits<Allocator>::template rebind_alloc<T> alloc(mAllocator);
+			return std::allocator_traits<decltype(alloc)>::allocate(alloc, n);
+		}
+
+		/// Gives an array from allocate_array back (nothing is done for nullptr)
+		template <class T>
+		void deallocate_array(T* arr, std::size_t n)
+		{
+			typename std::allocator_traits<Allocator>::template rebind_alloc<T> alloc(mAllocator);
+			if (arr)
+				std::allocator_traits<decltype(alloc)>::deallocate(alloc, arr, n);
+		}
+
+		/// Exchanges two maps' allocators (see UnorderedMap::swap_allocators)
+		void swap_allocators(FlatStringMap& other) noexcept
+		{
+			Allocator temp(mAllocator);
+			mAllocator.~Allocator();
+			::new ((void*)&mAllocator) Allocator(other.mAllocator);
+			other.mAllocator.~Allocator();
+			::new ((void*)&other.mAllocator) Allocator(temp);
+		}
+
+		/// Allocates a table of the given (power of two) capacity with every slot empty
+		void allocate_table(unsigned int cap)
+		{
+			mCapacity = cap;
+			mShift = 64;
+			for (unsigned int i = cap; i > 1; i /= 2)
+				mShift--;
+			mControl = allocate_array<unsigned char>(cap + ControlGroup::msWidth - 1);
+			std::memset(mControl, ControlGroup::msEmpty, cap + ControlGroup::msWidth - 1);
+			mKeys = allocate_array<KeyRef>(cap);
+			mValues = allocate_array<V>(cap);
+		}
+
+		/// Frees a table's arrays (which must hold no values)
+		void deallocate_table(unsigned char* control, KeyRef* keys, V* values, unsigned int cap)
+		{
+			deallocate_array(control, cap + ControlGroup::msWidth - 1);
+			deallocate_array(keys, cap);
+			deallocate_array(values, cap);
+		}
+
+		/// Destroys every value and frees the table's arrays, not the arena (they're nullptr for a moved-from map)
+		void free_table()
+		{
+			for (unsigned int i = 0; i < mCapacity; i++)
+			{
+				if (ControlGroup::is_full(mControl[i]))
+					mValues[i].~V();
+			}
+			deallocate_table(mControl, mKeys, mValues, mCapacity);
+		}
+
+		/// Returns the smallest power of two that is >= n (and at least msMinCapacity)
+		static unsigned int round_up_capacity(unsigned long long n)
+		{
+			unsigned int result = msMinCapacity;
+			while (result < n)
+				result *= 2;
+			return result;
+		}
+
+		/// Walks the probe chain for key (a ControlGroup at a time), stopping at the slot holding it (found is set to
+		/// true) or the first unused slot
+		unsigned int probe(std::string_view key, unsigned long long hash, bool& found) const
+		{
+			unsigned int mask = mCapacity - 1;
+			unsigned char frag = ControlGroup::fragment(hash);
+			unsigned int top = (unsigned int)(hash >> 32);
+			unsigned int ind = (unsigned int)(hash >> mShift);
+			while (true)
+			{
+				ControlGroup group(mControl + ind);
+				unsigned int empties = group.match_empty();
+				unsigned int candidates = group.match(frag);
+				if (empties != 0)
+					candidates &= (empties & (~empties + 1)) - 1;
+
+				while (candidates != 0)
+				{
+					unsigned int slot = (ind + count_trailing_zeros(candidates)) & mask;
+					const KeyRef& ref = mKeys[slot];
+					if (ref.mHash == top && ref.mLength == key.size() && std::memcmp(mArena + ref.mOffset, key.data(), key.size()) == 0)
+					{
+						found = true;
+						return slot;
+					}
+					candidates &= candidates - 1;
+				}
+
+				if (empties != 0)
+				{
+					found = false;
+					return (ind + count_trailing_zeros(empties)) & mask;
+				}
+				ind = (ind + ControlGroup::msWidth) & mask;
+			}
+		}
+
+		/// The slot holding key, or mCapacity if it isn't in the map
+		unsigned int find_slot(std::string_view key) const
+		{
+			if (mSize == 0)
+				return mCapacity;
+
+			bool found;
+			unsigned int ind = probe(key, hashGen(key), found);
+			return found ? ind : mCapacity;
+		}
+
+		/// Puts a KeyRef (and its control byte) in the first unused slot of its probe chain, returning the slot
+		unsigned int insert_unique(const KeyRef& ref, unsigned char control)
+		{
+			unsigned int mask = mCapacity - 1;
+			unsigned int ind = (unsigned int)(stored_hash(ref) >> mShift);
+			unsigned int empties;
+			while ((empties = ControlGroup(mControl + ind).match_empty()) == 0)
+				ind = (ind + ControlGroup::msWidth) & mask;
+			ind = (ind + count_trailing_zeros(empties)) & mask;
+			mKeys[ind] = ref;
+			set_control(ind, control);
+			return ind;
+		}
+
+		/// <summary>
+		/// Makes room for at least extra more characters in the arena.  If it's full and over half of it is removed
+		/// keys' characters, it's compacted first; if it still has to grow, it's (at least) doubled
+		/// </summary>
+		void reserve_arena(unsigned long long extra)
+		{
+			unsigned long long needed = (unsigned long long)mArenaSize + extra;
+			if (needed <= mArenaCapacity)
+				return;
+			if (mDeadChars > mArenaSize / 2)
+			{
+				compact();
+				needed = (unsigned long long)mArenaSize + extra;
+				if (needed <= mArenaCapacity)
+					return;
+			}
+			if (needed > 0xFFFFFFFFull)
+				throw std::length_error("FlatStringMap keys can't take more than 4GB");
+			unsigned long long cap = mArenaCapacity < msMinArenaCapacity ? msMinArenaCapacity : mArenaCapacity;
+			while (cap < needed)
+				cap *= 2;
+			if (cap > 0xFFFFFFFFull)
+				cap = 0xFFFFFFFFull;
+			char* arena = allocate_array<char>((std::size_t)cap);
+			if (mArenaSize > 0)
+				std::memcpy(arena, mArena, mArenaSize);
+			deallocate_array(mArena, mArenaCapacity);
+			mArena = arena;
+			mArenaCapacity = (unsigned int)cap;
+		}
+
+		/// Copies the live keys into a new, tightly-sized arena (in slot order), dropping removed keys' characters
+		void compact()
+		{
+			unsigned long long live = (unsigned long long)mArenaSize - mDeadChars;
+			unsigned int cap = live < msMinArenaCapacity ? msMinArenaCapacity : (unsigned int)live;
+			char* arena = allocate_array<char>(cap);
+			unsigned int size = 0;
+			for (unsigned int i = 0; i < mCapacity; i++)
+			{
+				if (ControlGroup::is_full(mControl[i]))
+				{
+					std::memcpy(arena + size, mArena + mKeys[i].mOffset, mKeys[i].mLength);
+					mKeys[i].mOffset = size;
+					size += mKeys[i].mLength;
+				}
+			}
+			deallocate_array(mArena, mArenaCapacity);
+			mArena = arena;
+			mArenaSize = size;
+			mArenaCapacity = cap;
+			mDeadChars = 0;
+		}
+
+		/// <summary>
+		/// Looks up key and, if it isn't there, copies it into the arena and constructs its value in place from
+		/// value_args (growing the table first if needed).  Returns the slot holding key and whether it was added
+		/// </summary>
+		template <class... Args>
+		std::pair<unsigned int, bool> emplace_unique(std::string_view key, Args&&... value_args)
+		{
+			// A moved-from map has no table at all
+			if (mCapacity == 0)
+				allocate_table(msMinCapacity);
+
+			unsigned long long hash = hashGen(key);
+			bool found;
+			unsigned int ind = probe(key, hash, found);
+			if (found)
+				return std::pair<unsigned int, bool>(ind, false);
+
+			// key may be a view into our own arena (e.g. from an iterator), which rehash and reserve_arena can move
+			// or compact (reordering the live keys and dropping the dead ones), so then it's copied out first
+			arena_string arena_key(mAllocator);
+			if (mArena != nullptr && key.data() >= mArena && key.data() < mArena + mArenaSize)
+			{
+				arena_key.assign(key.data(), key.size());
+				key = arena_key;
+			}
+
+			if (mSize + 1 > mCapacity * mMaxLoadFactor)
+			{
+				rehash(mCapacity * 2);
+				ind = probe(key, hash, found);
+			}
+			reserve_arena(key.size());
+
+			::new ((void*)(mValues + ind)) V(std::forward<Args>(value_args)...);
+			if (!key.empty())
+				std::memcpy(mArena + mArenaSize, key.data(), key.size());
+			mKeys[ind].mOffset = mArenaSize;
+			mKeys[ind].mLength = (unsigned int)key.size();
+			mKeys[ind].mHash = (unsigned int)(hash >> 32);
+			mArenaSize += (unsigned int)key.size();
+			set_control(ind, ControlGroup::fragment(hash));
+			mSize++;
+			return std::pair<unsigned int, bool>(ind, true);
+		}
+
+	public:
+		/// <summary>
+		/// Constructor
+		/// </summary>
+		/// <param name="capacity">the starting number of slots (rounded up to a power of two)</param>
+		/// <param name="hash_function">the Hash object to use (only needed if Hash has some state)</param>
+		/// <param name="alloc">the allocator for the table and arena</param>
+		FlatStringMap(unsigned int capacity = msMinCapacity, const Hash& hash_function = Hash(), const Allocator& alloc = Allocator()) :
+			mArena(nullptr), mArenaSize(0), mArenaCapacity(0), mDeadChars(0), mSize(0), mMaxLoadFactor(msDefaultMaxLoadFactor),
+			mHashGenerator(hash_function), mAllocator(alloc)
+		{
+			allocate_table(round_up_capacity(capacity));
+		}
+
+		/// Makes an empty map whose table and arena come from alloc (for a pmr map this can be given a
+		/// std::pmr::memory_resource*)
+		explicit FlatStringMap(const Allocator& alloc) : FlatStringMap(msMinCapacity, Hash(), alloc)
+		{
+			// intentionally empty
+		}
+
+		/// Copy constructor (the copy's arena only holds the live keys).  The allocator is copied as the allocator
+		/// says to (see UnorderedMap)
+		FlatStringMap(const FlatStringMap& other) : FlatStringMap(other,
+			std::allocator_traits<Allocator>::select_on_container_copy_construction(other.mAllocator))
+		{
+			// intentionally empty
+		}
+
+		/// Copy constructor that gives the copy a different allocator
+		FlatStringMap(const FlatStringMap& other, const Allocator& alloc) : FlatStringMap(msMinCapacity, other.mHashGenerator, alloc)
+		{
+			mMaxLoadFactor = other.mMaxLoadFactor;
+			reserve(other.mSize);
+			reserve_arena((unsigned long long)other.mArenaSize - other.mDeadChars);
+			for (const_iterator it = other.begin(); it != other.end(); ++it)
+				try_emplace((*it).first, (*it).second);
+		}
+
+		/// Move constructor: "steals" other's table and arena in O(1).  other is left empty, with no table or arena
+		/// (like a moved-from UnorderedMap, it makes a new table the first time something is added to it)
+		FlatStringMap(FlatStringMap&& other) noexcept : mArena(other.mArena), mArenaSize(other.mArenaSize),
+			mArenaCapacity(other.mArenaCapacity), mDeadChars(other.mDeadChars), mControl(other.mControl), mKeys(other.mKeys),
+			mValues(other.mValues), mSize(other.mSize), mCapacity(other.mCapacity), mShift(other.mShift),
+			mMaxLoadFactor(other.mMaxLoadFactor), mHashGenerator(std::move(other.mHashGenerator)), mAllocator(other.mAllocator)
+		{
+			other.mArena = nullptr;
+			other.mArenaSize = 0;
+			other.mArenaCapacity = 0;
+			other.mDeadChars = 0;
+			other.mControl = nullptr;
+			other.mKeys = nullptr;
+			other.mValues = nullptr;
+			other.mSize = 0;
+			other.mCapacity = 0;
+		}
+
+		/// Destructor
+		~FlatStringMap()
+		{
+			free_table();
+			deallocate_array(mArena, mArenaCapacity);
+		}
+
+		/// Replaces this map with a copy of other (copy-and-swap, keeping this map's allocator)
+		FlatStringMap& operator=(const FlatStringMap& other)
+		{
+			if (&other != this)
+			{
+				FlatStringMap temp(other, mAllocator);
+				swap(temp);
+			}
+			return *this;
+		}
+
+		/// Frees this map's table and arena and "steals" other's in O(1), leaving other empty (as the move
+		/// constructor does)
+		FlatStringMap& operator=(FlatStringMap&& other) noexcept
+		{
+			if (&other != this)
+			{
+				FlatStringMap temp(std::move(other));
+				swap(temp);
+			}
+			return *this;
+		}
+
+		/// Exchanges the contents (and allocators) of two maps in O(1)
+		void swap(FlatStringMap& other) noexcept
+		{
+			std::swap(mArena, other.mArena);
+			std::swap(mArenaSize, other.mArenaSize);
+			std::swap(mArenaCapacity, other.mArenaCapacity);
+			std::swap(mDeadChars, other.mDeadChars);
+			std::swap(mControl, other.mControl);
+			std::swap(mKeys, other.mKeys);
+			std::swap(mValues, other.mValues);
+			std::swap(mSize, other.mSize);
+			std::swap(mCapacity, other.mCapacity);
+			std::swap(mShift, other.mShift);
+			std::swap(mMaxLoadFactor, other.mMaxLoadFactor);
+			std::swap(mHashGenerator, other.mHashGenerator);
+			swap_allocators(other);
+		}
+
+		/// Returns a copy of the allocator the table and arena come from
+		Allocator get_allocator() const
+		{
+			return mAllocator;
+		}
+
+		iterator begin()
+		{
+			return iterator(this, 0);
+		}
+
+		const_iterator begin() const
+		{
+			return const_iterator(this, 0);
+		}
+
+		iterator end()
+		{
+			return iterator(this, mCapacity);
+		}
+
+		const_iterator end() const
+		{
+			return const_iterator(this, mCapacity);
+		}
+
+		/// Returns an iterator to key's item, or end() if it isn't in the map
+		iterator find(std::string_view key)
+		{
+			return iterator(this, find_slot(key));
+		}
+
+		const_iterator find(std::string_view key) const
+		{
+			return const_iterator(this, find_slot(key));
+		}
+
+		/// Returns the value for key, adding it (with a value-initialized value) if it isn't in the map
+		V& operator[](std::string_view key)
+		{
+			unsigned int ind = emplace_unique(key).first;
+			return mValues[ind];
+		}
+
+		/// If key isn't in the map, adds it with a value constructed in place from args.  Returns an iterator to
+		/// key's item and true if it was added
+		template <class... Args>
+		std::pair<iterator, bool> try_emplace(std::string_view key, Args&&... args)
+		{
+			std::pair<unsigned int, bool> result = emplace_unique(key, std::forward<Args>(args)...);
+			return std::pair<iterator, bool>(iterator(this, result.first), result.second);
+		}
+
+		/// <summary>
+		/// Removes key (destroying its value).  Later items in its cluster are shifted back (as in
+		/// UnorderedMap::remove), and its characters become garbage in the arena until the next compaction
+		/// </summary>
+		/// <returns>false if the key was not in the map</returns>
+		bool remove(std::string_view key)
+		{
+			if (mSize == 0)
+				return false;
+
+			bool found;
+			unsigned int hole = probe(key, hashGen(key), found);
+			if (!found)
+				return false;
+
+			mDeadChars += mKeys[hole].mLength;
+			mValues[hole].~V();
+			unsigned int mask = mCapacity - 1;
+			unsigned int ind = (hole + 1) & mask;
+			while (ControlGroup::is_full(mControl[ind]))
+			{
+				unsigned int home = (unsigned int)(stored_hash(mKeys[ind]) >> mShift);
+				if (((ind - home) & mask) >= ((ind - hole) & mask))
+				{
+					mKeys[hole] = mKeys[ind];
+					::new ((void*)(mValues + hole)) V(std::move(mValues[ind]));
+					mValues[ind].~V();
+					set_control(hole, mControl[ind]);
+					hole = ind;
+				}
+				ind = (ind + 1) & mask;
+			}
+			set_control(hole, ControlGroup::msEmpty);
+			mSize--;
+			return true;
+		}
+
+		/// <summary>
+		/// Rebuilds the table with at least new_capacity slots (see UnorderedMap::rehash).  No key is re-hashed
+		/// (the KeyRefs have the bits we need), and if over half the arena is removed keys' characters, the arena is
+		/// compacted too
+		/// </summary>
+		void rehash(unsigned int new_capacity)
+		{
+			unsigned long long needed = (unsigned long long)(mSize / mMaxLoadFactor) + 1;
+			unsigned int cap = round_up_capacity(new_capacity > needed ? new_capacity : needed);
+
+			unsigned char* old_control = mControl;
+			KeyRef* old_keys = mKeys;
+			V* old_values = mValues;
+			unsigned int old_capacity = mCapacity;
+
+			allocate_table(cap);
+			for (unsigned int i = 0; i < old_capacity; i++)
+			{
+				if (ControlGroup::is_full(old_control[i]))
+				{
+					unsigned int ind = insert_unique(old_keys[i], old_control[i]);
+					::new ((void*)(mValues + ind)) V(std::move(old_values[i]));
+					old_values[i].~V();
+				}
+			}
+			deallocate_table(old_control, old_keys, old_values, old_capacity);
+
+			if (mDeadChars > mArenaSize / 2)
+				compact();
+		}
+
+		/// Makes sure the map can hold num_items without growing again
+		void reserve(unsigned int num_items)
+		{
+			if ((unsigned long long)(num_items / mMaxLoadFactor) + 1 > mCapacity)
+				rehash((unsigned int)(num_items / mMaxLoadFactor) + 1);
+		}
+
+		/// Returns the number of items
+		unsigned int size() const
+		{
+			return mSize;
+		}
+
+		/// Returns the number of slots
+		unsigned int capacity() const
+		{
+			return mCapacity;
+		}
+
+		/// Returns size / capacity
+		float load_factor() const
+		{
+			if (mCapacity == 0)
+				return 0.0f;
+			return (float)mSize / mCapacity;
+		}
+
+		/// Returns the number of characters in the arena (including removed keys' characters)
+		unsigned int arena_size() const
+		{
+			return mArenaSize;
+		}
+
+		/// <summary>
+		/// Returns the number of bytes of heap memory the map is using: the table's arrays and the whole arena
+		/// (including any unused room at the end).  Doesn't include anything V's allocate themselves
+		/// </summary>
+		unsigned long long memory_usage() const
+		{
+			unsigned long long table = mCapacity == 0 ? 0 : (unsigned long long)mCapacity * (sizeof(KeyRef) + sizeof(V) + 1) + ControlGroup::msWidth - 1;
+			return table + mArenaCapacity;
+		}
+
+		/// Sets the output to look like {K1: V1, K2: V2, ... , Kn: Vn}
+		friend std::ostream& operator<<(std::ostream& os, const FlatStringMap& M)
+		{
+			os << "{";
+			bool first = true;
+			for (const_iterator it = M.begin(); it != M.end(); ++it)
+			{
+				if (!first)
+					os << ", ";
+				os << (*it).first << ":" << (*it).second;
+				first = false;
+			}
+			os << "}";
+			return os;
+		}
+	};
+
+	namespace pmr
+	{
+		/// A FlatStringMap whose table and arena come from a std::pmr::memory_resource (e.g. an ssuds::MonotonicArena)
+		template <class V, class Hash = FastHash<std::string_view>>
+		using FlatStringMap = ssuds::FlatStringMap<V, Hash, std::pmr::polymorphic_allocator<V>>;
+	}
+}
@@ -0,0 +1,428 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <ostream>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <unordered_map.h>
+
+namespace ssuds
+{
+	/// <summary>
+	/// A hash function whose results can be computed at compile time (FastHash can't be: it uses 128-bit multiply
+	/// intrinsics and memcpy), for FixedFrozenUnorderedMap.  Integers (and enums) are hashed directly and string
+	/// views a character at a time with FNV-1a; either way the result still goes through _frozen_mix.
+	/// </summary>
+	/// <typeparam name="T">The type of key to hash</typeparam>
+	template <class T, class Enable = void>
+	struct FrozenHash;
+
+	template <class T>
+	struct FrozenHash<T, typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type>
+	{
+		constexpr unsigned long long operator()(T value) const
+		{
+			return (unsigned long long)value;
+		}
+	};
+
+	template <class C, class Tr>
+	struct FrozenHash<std::basic_string_view<C, Tr>>
+	{
+		constexpr unsigned long long operator()(std::basic_string_view<C, Tr> value) const
+		{
+			unsigned long long result = 0xcbf29ce484222325ull;
+			for (std::size_t i = 0; i < value.size(); i++)
+			{
+				result ^= (unsigned long long)value[i];
+				result *= 0x100000001b3ull;
+			}
+			return result;
+		}
+	};
+
+
+	/// <summary>
+	/// Finishes off a hash function's result so all 64 bits are well mixed (the murmur3 64-bit finalizer): the
+	/// low half picks a key's bucket and the high half its slot, so both have to look random
+	/// </summary>
+	constexpr unsigned long long _frozen_mix(unsigned long long h)
+	{
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdull;
+		h ^= h >> 33;
+		h *= 0xc4ceb9fe1a85ec53ull;
+		h ^= h >> 33;
+		return h;
+	}
+
+	/// The number of buckets used for n keys (about three keys per bucket)
+	constexpr unsigned int _frozen_num_buckets(unsigned int n)
+	{
+		return n / 3 + 1;
+	}
+
+	/// The bucket (from the low 32 bits of a mixed hash code) -- a multiply and shift rather than a modulus
+	constexpr unsigned int _frozen_bucket(unsigned long long h, unsigned int num_buckets)
+	{
+		return (unsigned int)(((h & 0xFFFFFFFFull) * num_buckets) >> 32);
+	}
+
+	/// The slot a mixed hash code lands in when its bucket's pilot value is pilot
+	constexpr unsigned int _frozen_slot(unsigned long long h, unsigned int pilot, unsigned int n)
+	{
+		return (unsigned int)((((h ^ (pilot * 0x9E3779B97F4A7C15ull)) * 0xD6E8FEB86659FD93ull) >> 32) * n >> 32);
+	}
+
+
+	/// <summary>
+	/// Builds a minimal perfect hash for n distinct (mixed) hash codes, PTHash-style: the codes are split into
+	/// buckets, and then, biggest bucket first, each bucket gets the smallest "pilot" value that sends all of its
+	/// keys to different slots nobody has taken yet.  Each of the n slots ends up holding exactly one key, so a
+	/// lookup is one bucket read and one slot read.  Written with plain loops over caller-provided arrays so it
+	/// can run at compile time.
+	/// </summary>
+	/// <param name="hashes">the n mixed hash codes</param>
+	/// <param name="pilots">[out] num_buckets pilot values</param>
+	/// <param name="slots">[out] the slot each key ended up in</param>
+	/// <param name="starts">scratch space for num_buckets + 1 values</param>
+	/// <param name="members">scratch space for n values</param>
+	/// <param name="order">scratch space for num_buckets values</param>
+	/// <param name="taken">scratch space for n values</param>
+	constexpr void _build_perfect_hash(const unsigned long long* hashes, unsigned int n, unsigned int num_buckets, unsigned int* pilots,
+		unsigned int* slots, unsigned int* starts, unsigned int* members, unsigned int* order, bool* taken)
+	{
+		// group the keys by bucket (a counting sort): bucket b's keys are members[starts[b]] to members[starts[b + 1] - 1]
+		for (unsigned int b = 0; b <= num_buckets; b++)
+			starts[b] = 0;
+		for (unsigned int i = 0; i < n; i++)
+			starts[_frozen_bucket(hashes[i], num_buckets) + 1]++;
+		unsigned int largest = 0;
+		for (unsigned int b = 0; b < num_buckets; b++)
+		{
+			if (starts[b + 1] > largest)
+				largest = starts[b + 1];
+			starts[b + 1] += starts[b];
+		}
+		for (unsigned int b = 0; b < num_buckets; b++)
+			order[b] = starts[b];
+		for (unsigned int i = 0; i < n; i++)
+			members[order[_frozen_bucket(hashes[i], num_buckets)]++] = i;
+
+		// visit the buckets biggest first (they're the hardest to place, so they go while most slots are free)
+		unsigned int num_ordered = 0;
+		for (unsigned int size = largest; size > 0; size--)
+		{
+			for (unsigned int b = 0; b < num_buckets; b++)
+			{
+				if (starts[b + 1] - starts[b] == size)
+					order[num_ordered++] = b;
+			}
+		}
+
+		for (unsigned int i = 0; i < n; i++)
+			taken[i] = false;
+		for (unsigned int b = 0; b < num_buckets; b++)
+			pilots[b] = 0;
+
+		for (unsigned int o = 0; o < num_ordered; o++)
+		{
+			unsigned int b = order[o];
+			unsigned int first = starts[b], last = starts[b + 1];
+			for (unsigned int i = first; i < last; i++)
+			{
+				for (unsigned int j = first; j < i; j++)
+				{
+					if (hashes[members[i]] == hashes[members[j]])
+						throw std::invalid_argument("Frozen map keys must be distinct (and have distinct hash codes)");
+				}
+			}
+
+			// the last few buckets can need about n tries each; far more than that means something is wrong
+			unsigned long long max_pilot = 64ull * n + 1024;
+			for (unsigned int pilot = 0; ; pilot++)
+			{
+				if (pilot > max_pilot)
+					throw std::runtime_error("Unable to build a perfect hash for the frozen map's keys");
+				bool fits = true;
+				for (unsigned int i = first; i < last && fits; i++)
+				{
+					slots[members[i]] = _frozen_slot(hashes[members[i]], pilot, n);
+					if (taken[slots[members[i]]])
+						fits = false;
+					for (unsigned int j = first; j < i && fits; j++)
+					{
+						if (slots[members[j]] == slots[members[i]])
+							fits = false;
+					}
+				}
+				if (fits)
+				{
+					for (unsigned int i = first; i < last; i++)
+						taken[slots[members[i]]] = true;
+					pilots[b] = pilot;
+					break;
+				}
+			}
+		}
+	}
+
+
+	/// <summary>
+	/// A read-only hash map for a key set that never changes, built from an UnorderedMap.  It uses a minimal
+	/// perfect hash (see _build_perfect_hash), so the items are packed in an array with no empty slots, and a
+	/// lookup is one hash, one (small) pilot read and one key comparison, with no probing loop.
+	/// </summary>
+	/// <typeparam name="K">The key type</typeparam>
+	/// <typeparam name="V">The value type</typeparam>
+	/// <typeparam name="Hash">The hash function (transparent ones allow lookups with other key types)</typeparam>
+	/// <typeparam name="Allocator">Where the items (and, rebound, the pilots) come from</typeparam>
+	template <class K, class V, class Hash = FastHash<K>, class Allocator = std::allocator<std::pair<K, V>>>
+	class FrozenUnorderedMap
+	{
+	protected:
+		typedef typename std::allocator_traits<Allocator>::template rebind_alloc<unsigned int> pilot_allocator_type;
+
+		// the items, in slot order
+		std::vector<std::pair<K, V>, Allocator> mItems;
+
+		// a pilot value for each bucket
+		std::vector<unsigned int, pilot_allocator_type> mPilots;
+
+		Hash mHashGenerator;
+
+		// see UnorderedMap::enable_if_lookup_key
+		template <class Q>
+		using enable_if_lookup_key = typename std::enable_if<std::is_same<Q, K>::value || _is_transparent_key<Hash, K, Q>::value, int>::type;
+
+		/// Returns the only slot key could be in (which is only valid if the map isn't empty)
+		template <class Q>
+		unsigned int slot_for(const Q& key) const
+		{
+			unsigned long long h = _frozen_mix((unsigned long long)mHashGenerator(key));
+			return _frozen_slot(h, mPilots[_frozen_bucket(h, (unsigned int)mPilots.size())], (unsigned int)mItems.size());
+		}
+
+	public:
+		typedef typename std::vector<std::pair<K, V>, Allocator>::const_iterator const_iterator;
+
+		/// <summary>
+		/// Builds a frozen copy of map's items (in memory from alloc).  Throws a std::invalid_argument if two keys have
+		/// the same hash code
+		/// </summary>
+		template <class H, class P, class S, class A>
+		explicit FrozenUnorderedMap(const UnorderedMap<K, V, H, P, S, A>& map, const Hash& hash_function = Hash(), const Allocator& alloc = Allocator()) :
+			mItems(alloc), mPilots(pilot_allocator_type(alloc)), mHashGenerator(hash_function)
+		{
+			// UnorderedMap only has a non-const iterator, but nothing is changed through it
+			UnorderedMap<K, V, H, P, S, A>& source = const_cast<UnorderedMap<K, V, H, P, S, A>&>(map);
+			std::vector<const std::pair<K, V>*> items;
+			std::vector<unsigned long long> hashes;
+			for (typename UnorderedMap<K, V, H, P, S, A>::unorderMapIterator it = source.begin(); it != source.end(); ++it)
+			{
+				items.push_back(&*it);
+				hashes.push_back(_frozen_mix((unsigned long long)mHashGenerator(it->first)));
+			}
+
+			unsigned int n = (unsigned int)items.size();
+			unsigned int num_buckets = _frozen_num_buckets(n);
+			mPilots.resize(num_buckets);
+			std::vector<unsigned int> slots(n), starts(num_buckets + 1), members(n), order(num_buckets);
+			std::unique_ptr<bool[]> taken(new bool[n]);
+			_build_perfect_hash(hashes.data(), n, num_buckets, mPilots.data(), slots.data(), starts.data(), members.data(),
+				order.data(), taken.get());
+
+			// order[] is free again: reuse it to list the keys in slot order
+			order.resize(n);
+			for (unsigned int i = 0; i < n; i++)
+				order[slots[i]] = i;
+			mItems.reserve(n);
+			for (unsigned int s = 0; s < n; s++)
+				mItems.push_back(*items[order[s]]);
+		}
+
+		/// Returns the item for key, or end() if it isn't in the map
+		template <class Q, enable_if_lookup_key<Q> = 0>
+		const_iterator find(const Q& key) const
+		{
+			if (mItems.empty())
+				return mItems.end();
+			const_iterator it = mItems.begin() + slot_for(key);
+			return it->first == key ? it : mItems.end();
+		}
+
+		/// Returns true if key is in the map
+		template <class Q, enable_if_lookup_key<Q> = 0>
+		bool contains(const Q& key) const
+		{
+			return find(key) != mItems.end();
+		}
+
+		/// Returns the value for key, throwing a std::out_of_range if it isn't in the map
+		template <class Q, enable_if_lookup_key<Q> = 0>
+		const V& at(const Q& key) const
+		{
+			const_iterator it = find(key);
+			if (it == mItems.end())
+				throw std::out_of_range("Key not in FrozenUnorderedMap");
+			return it->second;
+		}
+
+		const_iterator begin() const
+		{
+			return mItems.begin();
+		}
+
+		const_iterator end() const
+		{
+			return mItems.end();
+		}
+
+		/// Returns the number of items
+		unsigned int size() const
+		{
+			return (unsigned int)mItems.size();
+		}
+
+		/// Returns a copy of the allocator the items come from
+		Allocator get_allocator() const
+		{
+			return mItems.get_allocator();
+		}
+
+		/// Sets the output to look like {K1: V1, K2: V2, ... , Kn: Vn}
+		friend std::ostream& operator<<(std::ostream& os, const FrozenUnorderedMap& M)
+		{
+			os << "{";
+			for (unsigned int i = 0; i < M.mItems.size(); i++)
+			{
+				if (i > 0)
+					os << ", ";
+				os << M.mItems[i].first << ":" << M.mItems[i].second;
+			}
+			os << "}";
+			return os;
+		}
+	};
+
+
+	/// <summary>
+	/// A FrozenUnorderedMap with a fixed number of items, which can be built at compile time (see
+	/// make_frozen_map).  K and V have to be literal types (integers, enums, std::string_view, ...), and the
+	/// hash function has to be constexpr (like FrozenHash).  Compilers limit how much work a constant expression
+	/// may do, so this suits up to a few hundred keys; bigger key sets should use FrozenUnorderedMap.
+	/// </summary>
+	template <class K, class V, std::size_t N, class Hash = FrozenHash<K>>
+	class FixedFrozenUnorderedMap
+	{
+	protected:
+		static constexpr unsigned int msNumBuckets = _frozen_num_buckets((unsigned int)N);
+
+		// keys and values are kept apart since std::pair can't be assigned in a C++17 constant expression
+		std::array<K, N> mKeys;
+		std::array<V, N> mValues;
+		std::array<unsigned int, msNumBuckets> mPilots;
+		Hash mHashGenerator;
+
+		/// Returns the only slot key could be in (which is only valid if N > 0)
+		constexpr unsigned int slot_for(const K& key) const
+		{
+			unsigned long long h = _frozen_mix((unsigned long long)mHashGenerator(key));
+			return _frozen_slot(h, mPilots[_frozen_bucket(h, msNumBuckets)], (unsigned int)N);
+		}
+
+	public:
+		/// <summary>
+		/// Builds the map from an array of (key, value) pairs.  Fails to compile (or throws a std::invalid_argument
+		/// at run time) if two keys have the same hash code
+		/// </summary>
+		constexpr FixedFrozenUnorderedMap(const std::pair<K, V>(&items)[N], const Hash& hash_function = Hash()) : mKeys{}, mValues{},
+			mPilots{}, mHashGenerator(hash_function)
+		{
+			std::array<unsigned long long, N> hashes{};
+			for (std::size_t i = 0; i < N; i++)
+				hashes[i] = _frozen_mix((unsigned long long)mHashGenerator(items[i].first));
+
+			std::array<unsigned int, N> slots{};
+			std::array<unsigned int, N> members{};
+			std::array<unsigned int, msNumBuckets + 1> starts{};
+			std::array<unsigned int, msNumBuckets> order{};
+			std::array<bool, N> taken{};
+			_build_perfect_hash(hashes.data(), (unsigned int)N, msNumBuckets, mPilots.data(), slots.data(), starts.data(), members.data(),
+				order.data(), taken.data());
+
+			for (std::size_t i = 0; i < N; i++)
+			{
+				mKeys[slots[i]] = items[i].first;
+				mValues[slots[i]] = items[i].second;
+			}
+		}
+
+		/// Returns a pointer to key's value, or nullptr if it isn't in the map
+		constexpr const V* find(const K& key) const
+		{
+			if (N == 0)
+				return nullptr;
+			unsigned int slot = slot_for(key);
+			return mKeys[slot] == key ? &mValues[slot] : nullptr;
+		}
+
+		/// Returns true if key is in the map
+		constexpr bool contains(const K& key) const
+		{
+			return N > 0 && mKeys[slot_for(key)] == key;
+		}
+
+		/// Returns the value for key, throwing a std::out_of_range if it isn't in the map
+		constexpr const V& at(const K& key) const
+		{
+			// (this doesn't go through find: some compilers won't compare a pointer into a temporary map with
+			// nullptr in a constant expression)
+			unsigned int slot = N > 0 ? slot_for(key) : 0;
+			if (N == 0 || !(mKeys[slot] == key))
+				throw std::out_of_range("Key not in FixedFrozenUnorderedMap");
+			return mValues[slot];
+		}
+
+		/// The keys, in slot order (value i goes with key i)
+		constexpr const std::array<K, N>& keys() const
+		{
+			return mKeys;
+		}
+
+		constexpr const std::array<V, N>& values() const
+		{
+			return mValues;
+		}
+
+		/// Returns the number of items
+		constexpr unsigned int size() const
+		{
+			return (unsigned int)N;
+		}
+	};
+
+
+	/// <summary>
+	/// Makes a FixedFrozenUnorderedMap (working out the number of items), e.g.
+	///   constexpr auto colors = ssuds::make_frozen_map<std::string_view, int>({ {"red", 1}, {"green", 2} });
+	/// </summary>
+	template <class K, class V, class Hash = FrozenHash<K>, std::size_t N>
+	constexpr FixedFrozenUnorderedMap<K, V, N, Hash> make_frozen_map(const std::pair<K, V>(&items)[N])
+	{
+		return FixedFrozenUnorderedMap<K, V, N, Hash>(items);
+	}
+
+	namespace pmr
+	{
+		/// A FrozenUnorderedMap whose items come from a std::pmr::memory_resource (e.g. an ssuds::MonotonicArena).
+		/// (FixedFrozenUnorderedMap never allocates, so it has no allocator)
+		template <class K, class V, class Hash = FastHash<K>>
+		using FrozenUnorderedMap = ssuds::FrozenUnorderedMap<K, V, Hash, std::pmr::polymorphic_allocator<std::pair<K, V>>>;
+	}
+}
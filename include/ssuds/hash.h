@@ -0,0 +1,190 @@
+#pragma once
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#endif
+
+namespace ssuds
+{
+	/// <summary>
+	/// Multiplies two 64-bit values, returning the low 64 bits of the 128-bit product in a and the high
+	/// 64 bits in b
+	/// </summary>
+	inline void _multiply_128(unsigned long long& a, unsigned long long& b)
+	{
+#if defined(_MSC_VER) && defined(_M_X64)
+		a = _umul128(a, b, &b);
+#elif defined(__SIZEOF_INT128__)
+		unsigned __int128 product = (unsigned __int128)a * b;
+		a = (unsigned long long)product;
+		b = (unsigned long long)(product >> 64);
+#else
+		// Schoolbook multiplication on 32-bit halves
+		unsigned long long a_lo = a & 0xFFFFFFFFull, a_hi = a >> 32;
+		unsigned long long b_lo = b & 0xFFFFFFFFull, b_hi = b >> 32;
+		unsigned long long lo_lo = a_lo * b_lo, hi_lo = a_hi * b_lo, lo_hi = a_lo * b_hi, hi_hi = a_hi * b_hi;
+		unsigned long long cross = (lo_lo >> 32) + (hi_lo & 0xFFFFFFFFull) + lo_hi;
+		a = (cross << 32) | (lo_lo & 0xFFFFFFFFull);
+		b = (hi_lo >> 32) + (cross >> 32) + hi_hi;
+#endif
+	}
+
+
+	/// <summary>
+	/// Multiplies two 64-bit values and folds the 128-bit product back to 64 bits (the wyhash "mum" mix)
+	/// </summary>
+	inline unsigned long long _mix_128(unsigned long long a, unsigned long long b)
+	{
+		_multiply_128(a, b);
+		return a ^ b;
+	}
+
+
+	/// <summary>
+	/// Reads 8 (or 4) bytes starting at p as a (native-endian) integer, without alignment requirements
+	/// </summary>
+	inline unsigned long long _read_8(const unsigned char* p)
+	{
+		unsigned long long v;
+		std::memcpy(&v, p, 8);
+		return v;
+	}
+
+	inline unsigned long long _read_4(const unsigned char* p)
+	{
+		unsigned int v;
+		std::memcpy(&v, p, 4);
+		return v;
+	}
+
+
+	/// <summary>
+	/// Hashes a block of bytes.  This follows the structure of wyhash (https://github.com/wangyi-fudan/wyhash):
+	/// inputs are consumed 16 or 48 bytes at a time, each step being a single 64x64->128 bit multiply, so long
+	/// keys hash at several bytes per cycle and short keys (<= 16 bytes) take just two multiplies.
+	/// </summary>
+	/// <param name="data">the bytes to hash</param>
+	/// <param name="len">how many bytes there are</param>
+	/// <param name="seed">a seed value (different seeds give unrelated hash functions)</param>
+	/// <returns>a 64-bit hash code</returns>
+	inline unsigned long long hash_bytes(const void* data, std::size_t len, unsigned long long seed = 0)
+	{
+		static const unsigned long long secret[4] = { 0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull,
+			0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull };
+
+		const unsigned char* p = (const unsigned char*)data;
+		seed ^= _mix_128(seed ^ secret[0], secret[1]);
+		unsigned long long a, b;
+		if (len <= 16)
+		{
+			if (len >= 4)
+			{
+				// Two (possibly overlapping) 4-byte reads from each end cover every length from 4 to 16
+				std::size_t offset = (len >> 3) << 2;
+				a = (_read_4(p) << 32) | _read_4(p + offset);
+				b = (_read_4(p + len - 4) << 32) | _read_4(p + len - 4 - offset);
+			}
+			else if (len > 0)
+			{
+				a = ((unsigned long long)p[0] << 16) | ((unsigned long long)p[len >> 1] << 8) | p[len - 1];
+				b = 0;
+			}
+			else
+				a = b = 0;
+		}
+		else
+		{
+			std::size_t i = len;
+			if (i > 48)
+			{
+				unsigned long long seed1 = seed, seed2 = seed;
+				do
+				{
+					seed = _mix_128(_read_8(p) ^ secret[1], _read_8(p + 8) ^ seed);
+					seed1 = _mix_128(_read_8(p + 16) ^ secret[2], _read_8(p + 24) ^ seed1);
+					seed2 = _mix_128(_read_8(p + 32) ^ secret[3], _read_8(p + 40) ^ seed2);
+					p += 48;
+					i -= 48;
+				} while (i > 48);
+				seed ^= seed1 ^ seed2;
+			}
+			while (i > 16)
+			{
+				seed = _mix_128(_read_8(p) ^ secret[1], _read_8(p + 8) ^ seed);
+				i -= 16;
+				p += 16;
+			}
+			// The last 16 bytes (which may overlap bytes we've already used)
+			a = _read_8(p + i - 16);
+			b = _read_8(p + i - 8);
+		}
+		a ^= secret[1];
+		b ^= seed;
+		_multiply_128(a, b);
+		return _mix_128(a ^ secret[0] ^ len, b ^ secret[1]);
+	}
+
+
+	/// <summary>
+	/// Mixes the bits of an integer so that keys that only differ in a few (high or low) bits get unrelated
+	/// hash codes.  One 128-bit multiply by an odd constant, folded back to 64 bits.
+	/// </summary>
+	inline unsigned long long mix_integer(unsigned long long value)
+	{
+		return _mix_128(value ^ 0x2d358dccaa6c78a5ull, 0x9E3779B97F4A7C15ull);
+	}
+
+
+	/// <summary>
+	/// The default hash function object for ssuds' hashed containers.  Integers (and enums) go through
+	/// mix_integer, strings and string views through hash_bytes, and anything else falls back to std::hash.
+	/// The string versions are "transparent" (they define is_transparent), so containers can look up a
+	/// std::string key using a std::string_view or const char* without building a std::string.
+	/// </summary>
+	/// <typeparam name="T">The type of key to hash</typeparam>
+	template <class T, class Enable = void>
+	struct FastHash
+	{
+		std::size_t operator()(const T& value) const
+		{
+			return std::hash<T>()(value);
+		}
+	};
+
+	template <class T>
+	struct FastHash<T, typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type>
+	{
+		std::size_t operator()(T value) const
+		{
+			return (std::size_t)mix_integer((unsigned long long)value);
+		}
+	};
+
+	template <class C, class Tr, class A>
+	struct FastHash<std::basic_string<C, Tr, A>>
+	{
+		typedef void is_transparent;
+
+		std::size_t operator()(std::basic_string_view<C, Tr> value) const
+		{
+			return (std::size_t)hash_bytes(value.data(), value.size() * sizeof(C));
+		}
+	};
+
+	template <class C, class Tr>
+	struct FastHash<std::basic_string_view<C, Tr>>
+	{
+		typedef void is_transparent;
+
+		std::size_t operator()(std::basic_string_view<C, Tr> value) const
+		{
+			return (std::size_t)hash_bytes(value.data(), value.size() * sizeof(C));
+		}
+	};
+}
@@ -0,0 +1,325 @@
+#pragma once
+#include <memory>
+#include <memory_resource>
+#include <type_traits>
+#include <utility>
+#include <hash.h>
+#include <unordered_map.h>
+
+namespace ssuds
+{
+	/// <summary>
+	/// An UnorderedMap that never stops to rehash everything at once.  When its table fills up, a table twice the
+	/// size is made and the old one is kept alongside it; from then on every change to the map (try_emplace,
+	/// operator[], insert_or_assign, remove) first moves the items in the next msMigrateSlots slots of the old table
+	/// into the new one (like Redis' dict).  Lookups check both tables until the old one is empty and freed.  So
+	/// the worst case for an insert is allocating the new table plus a few dozen item moves, instead of moving every
+	/// item.  The new table is big enough that it never has to grow before the old one has been emptied.
+	/// There is no iterator (items can be in either table): use for_each.
+	/// </summary>
+	/// <typeparam name="K">The key type</typeparam>
+	/// <typeparam name="V">The value type</typeparam>
+	/// <typeparam name="Hash">The hash function (see UnorderedMap)</typeparam>
+	/// <typeparam name="Probing">The probing policy of the tables (see UnorderedMap)</typeparam>
+	/// <typeparam name="HashStorage">The hash-storage policy of the tables (see UnorderedMap)</typeparam>
+	/// <typeparam name="Allocator">Where both tables come from (see UnorderedMap)</typeparam>
+	template <class K, class V, class Hash = FastHash<K>, class Probing = LinearProbing, class HashStorage = NoStoredHash,
+		class Allocator = std::allocator<std::pair<K, V>>>
+	class IncrementalUnorderedMap
+	{
+	public:
+		/// The type of map each table is
+		typedef UnorderedMap<K, V, Hash, Probing, HashStorage, Allocator> table_type;
+
+	protected:
+		/// The table new items go in (the only one, when not rehashing)
+		table_type mTable;
+
+		/// While rehashing, the table items are being moved out of (otherwise it has no table at all)
+		table_type mOld;
+
+		/// While rehashing, the next slot of mOld to move items out of (every slot before it is unused)
+		unsigned int mCursor;
+
+		/// How many slots of the old table each change to the map moves items out of
+		static const unsigned int msMigrateSlots = 64;
+
+		/// The lookup methods below accept K or anything UnorderedMap's find accepts (see _is_transparent_key)
+		template <class Q>
+		using enable_if_lookup_key = typename std::enable_if<std::is_same<Q, K>::value || _is_transparent_key<Hash, K, Q>::value, int>::type;
+
+		/// <summary>
+		/// Moves the items in the next msMigrateSlots slots of the old table (if we're rehashing) into the new one.
+		/// Each item is removed from the old table as a remove would (backward shift), which can pull a later item
+		/// back into the slot -- but never into a slot before mCursor, since those are all unused
+		/// </summary>
+		void migrate_some()
+		{
+			if (mOld.mCapacity == 0)
+				return;
+			unsigned int stop = mOld.mCapacity - mCursor < msMigrateSlots ? mOld.mCapacity : mCursor + msMigrateSlots;
+			for (; mCursor < stop; mCursor++)
+			{
+				while (ControlGroup::is_full(mOld.mControl[mCursor]))
+				{
+					// The old control byte is the item's fragment, and slot_hash has the bits that pick its home
+					// slot, so (with a stored hash) nothing is re-hashed
+					std::pair<K, V>& item = mOld.mTableData[mCursor];
+					mTable.insert_unique(std::move(item), mOld.slot_hash(mCursor), mOld.mControl[mCursor]);
+					mTable.mSize++;
+					item.~pair();
+					mOld.close_hole(mCursor);
+					mOld.mSize--;
+				}
+			}
+			if (mCursor == mOld.mCapacity)
+				mOld.free_empty_table();
+		}
+
+		/// <summary>
+		/// Called before an item might be added: moves some items along if we're rehashing, or, if the table is
+		/// full, starts rehashing into a new table twice the size.  By the time the old table (which is at most
+		/// max_load_factor full) is emptied, at most capacity / msMigrateSlots items can have been added, which
+		/// always fits in the new table
+		/// </summary>
+		void before_add()
+		{
+			if (mOld.mCapacity != 0)
+				migrate_some();
+			else if (mTable.mSize + 1 > mTable.mCapacity * mTable.mMaxLoadFactor)
+			{
+				table_type bigger(mTable.mCapacity > 0 ? mTable.mCapacity * 2 : 0, mTable.mHashGenerator, mTable.mAllocator);
+				mOld.swap(mTable);
+				mTable.swap(bigger);
+				mCursor = 0;
+				migrate_some();
+			}
+		}
+
+	public:
+		/// <summary>
+		/// Constructor
+		/// </summary>
+		/// <param name="capacity">the starting number of slots (see UnorderedMap)</param>
+		/// <param name="hash_function">the Hash object to use (only needed if Hash has some state)</param>
+		/// <param name="alloc">the allocator both tables come from</param>
+		IncrementalUnorderedMap(int capacity = table_type::msMinCapacity, const Hash& hash_function = Hash(), const Allocator& alloc = Allocator()) :
+			mTable(capacity, hash_function, alloc), mOld(0, hash_function, alloc), mCursor(0)
+		{
+			mOld.free_empty_table();
+		}
+
+		/// Makes an empty map whose tables come from alloc (for a pmr map this can be given a std::pmr::memory_resource*)
+		explicit IncrementalUnorderedMap(const Allocator& alloc) : IncrementalUnorderedMap(table_type::msMinCapacity, Hash(), alloc)
+		{
+			// intentionally empty
+		}
+
+		/// Copy constructor: copies both tables (slot for slot -- nothing is re-hashed) and how far along the rehash
+		/// is.  The allocator is copied as the allocator says to (see UnorderedMap)
+		IncrementalUnorderedMap(const IncrementalUnorderedMap& other) : IncrementalUnorderedMap(other,
+			std::allocator_traits<Allocator>::select_on_container_copy_construction(other.mTable.mAllocator))
+		{
+			// intentionally empty
+		}
+
+		/// Copy constructor that gives the copy's tables a different allocator
+		IncrementalUnorderedMap(const IncrementalUnorderedMap& other, const Allocator& alloc) : mTable(other.mTable, alloc),
+			mOld(other.mOld, alloc), mCursor(other.mCursor)
+		{
+			// Copying a map with no table gives it a (minimum size) table
+			if (other.mOld.mCapacity == 0)
+				mOld.free_empty_table();
+		}
+
+		IncrementalUnorderedMap(IncrementalUnorderedMap&& other) noexcept = default;
+
+		/// Replaces this map with a copy of other (copy-and-swap, keeping this map's allocator)
+		IncrementalUnorderedMap& operator=(const IncrementalUnorderedMap& other)
+		{
+			if (&other != this)
+			{
+				IncrementalUnorderedMap temp(other, mTable.mAllocator);
+				swap(temp);
+			}
+			return *this;
+		}
+
+		IncrementalUnorderedMap& operator=(IncrementalUnorderedMap&& other) noexcept = default;
+
+		/// Exchanges the contents of two maps in O(1)
+		void swap(IncrementalUnorderedMap& other) noexcept
+		{
+			mTable.swap(other.mTable);
+			mOld.swap(other.mOld);
+			std::swap(mCursor, other.mCursor);
+		}
+
+		/// <summary>
+		/// Returns a pointer to the value for key, or nullptr if it isn't in the map.  The pointer is good until
+		/// the map is next changed
+		/// </summary>
+		template <class Q, enable_if_lookup_key<Q> = 0>
+		V* find(const Q& key)
+		{
+			typename table_type::unorderMapIterator it = mTable.find(key);
+			if (it != mTable.end())
+				return &it->second;
+			if (mOld.mCapacity != 0)
+			{
+				typename table_type::unorderMapIterator old_it = mOld.find(key);
+				if (old_it != mOld.end())
+					return &old_it->second;
+			}
+			return nullptr;
+		}
+
+		V* find(const K& key)
+		{
+			return find<K>(key);
+		}
+
+		/// <summary>
+		/// Returns true if key is in the map
+		/// </summary>
+		template <class Q, enable_if_lookup_key<Q> = 0>
+		bool contains(const Q& key)
+		{
+			return find(key) != nullptr;
+		}
+
+		/// <summary>
+		/// Returns the value for key, adding it (with a value-initialized value) if it isn't in the map
+		/// </summary>
+		V& operator[](const K& key)
+		{
+			before_add();
+			V* value = find(key);
+			return value ? *value : mTable[key];
+		}
+
+		/// <summary>
+		/// Adds key with a value constructed from args, if key isn't already in the map
+		/// </summary>
+		/// <returns>true if the key was added</returns>
+		template <class... Args>
+		bool try_emplace(const K& key, Args&&... args)
+		{
+			before_add();
+			if (mOld.mCapacity != 0 && mOld.find(key) != mOld.end())
+				return false;
+			return mTable.try_emplace(key, std::forward<Args>(args)...).second;
+		}
+
+		/// <summary>
+		/// Sets the value for key, adding the key if it isn't already in the map
+		/// </summary>
+		/// <returns>true if the key was added, false if an existing value was replaced</returns>
+		template <class M>
+		bool insert_or_assign(const K& key, M&& value)
+		{
+			before_add();
+			if (mOld.mCapacity != 0)
+			{
+				typename table_type::unorderMapIterator it = mOld.find(key);
+				if (it != mOld.end())
+				{
+					it->second = std::forward<M>(value);
+					return false;
+				}
+			}
+			return mTable.insert_or_assign(key, std::forward<M>(value)).second;
+		}
+
+		/// <summary>
+		/// Removes key from the map
+		/// </summary>
+		/// <returns>false if the key was not in the map</returns>
+		template <class Q, enable_if_lookup_key<Q> = 0>
+		bool remove(const Q& key)
+		{
+			migrate_some();
+			return mTable.remove(key) || (mOld.mCapacity != 0 && mOld.remove(key));
+		}
+
+		bool remove(const K& key)
+		{
+			return remove<K>(key);
+		}
+
+		/// <summary>
+		/// Returns true while items are still being moved from an old table to a new one
+		/// </summary>
+		bool is_rehashing() const
+		{
+			return mOld.mCapacity != 0;
+		}
+
+		/// <summary>
+		/// Moves every remaining item out of the old table now (if we're rehashing), e.g. at a quiet moment
+		/// </summary>
+		void finish_rehash()
+		{
+			while (mOld.mCapacity != 0)
+				migrate_some();
+		}
+
+		/// <summary>
+		/// Makes sure the map can hold num_items without growing again.  This finishes any rehash and then rehashes
+		/// all at once, like UnorderedMap::reserve -- it's meant for before a bulk load, when a pause doesn't matter
+		/// </summary>
+		void reserve(unsigned int num_items)
+		{
+			finish_rehash();
+			mTable.reserve(num_items);
+		}
+
+		/// <summary>
+		/// Returns the number of items
+		/// </summary>
+		unsigned int size() const
+		{
+			return mTable.mSize + mOld.mSize;
+		}
+
+		/// <summary>
+		/// Returns a copy of the allocator the tables come from
+		/// </summary>
+		Allocator get_allocator() const
+		{
+			return mTable.mAllocator;
+		}
+
+		/// <summary>
+		/// Returns the number of slots in the (new) table
+		/// </summary>
+		unsigned int capacity() const
+		{
+			return mTable.mCapacity;
+		}
+
+		/// <summary>
+		/// Calls func(const std::pair<K, V>&) for every item (in both tables while rehashing).  func must not
+		/// change the map
+		/// </summary>
+		template <class F>
+		void for_each(F&& func) const
+		{
+			for (const table_type* table : { &mOld, &mTable })
+			{
+				for (unsigned int i = 0; i < table->mCapacity; i++)
+				{
+					if (ControlGroup::is_full(table->mControl[i]))
+						func((const std::pair<K, V>&)table->mTableData[i]);
+				}
+			}
+		}
+	};
+
+	namespace pmr
+	{
+		/// An IncrementalUnorderedMap whose tables come from a std::pmr::memory_resource (e.g. an ssuds::MonotonicArena)
+		template <class K, class V, class Hash = FastHash<K>, class Probing = LinearProbing, class HashStorage = NoStoredHash>
+		using IncrementalUnorderedMap = ssuds::IncrementalUnorderedMap<K, V, Hash, Probing, HashStorage, std::pmr::polymorphic_allocator<std::pair<K, V>>>;
+	}
+}
@@ -1,11 +1,14 @@
 #pragma once
+#include <memory>
+#include <memory_resource>
 #include <ostream>
 
 namespace ssuds
 {
-	template <class T>
+	template <class T, class Allocator = std::allocator<T>>
 	/// A LinkedList is a collection of non-contiguous Nodes.  To get to
-	/// a certain spot, you must traverse the list.
+	/// a certain spot, you must traverse the list.  Nodes come from Allocator (rebound to
+	/// the Node type -- see ssuds::pmr::LinkedList for one that takes a std::pmr::memory_resource)
 	class LinkedList
 	{
 	protected:
@@ -200,17 +203,32 @@ namespace ssuds
 		/// The number of elements in the list
 		unsigned int mSize;
 
+		typedef typename std::allocator_traits<Allocator>::template rebind_alloc<Node> node_allocator_type;
+		typedef std::allocator_traits<node_allocator_type> node_traits;
+
+		/// Where our Nodes come from
+		node_allocator_type mNodeAllocator;
+
 
 	public:
 		/// The default constructor
-		LinkedList() : mSize(0), mStart(NULL), mEnd(NULL)
+		LinkedList() : mStart(NULL), mEnd(NULL), mSize(0), mNodeAllocator()
+		{
+			// Intentionally blank
+		}
+
+
+		/// Constructor for an empty list whose Nodes come from alloc
+		explicit LinkedList(const Allocator& alloc) : mStart(NULL), mEnd(NULL), mSize(0), mNodeAllocator(alloc)
 		{
 			// Intentionally blank
 		}
 
 
-		/// Copy constructor.  Makes a deep copy of the given LinkedList
-		LinkedList(const LinkedList& L) : mStart(NULL), mEnd(NULL), mSize(0)
+		/// Copy constructor.  Makes a deep copy of the given LinkedList (the allocator is copied as the allocator
+		/// says to -- a pmr list uses the default resource)
+		LinkedList(const LinkedList& L) : mStart(NULL), mEnd(NULL), mSize(0),
+			mNodeAllocator(node_traits::select_on_container_copy_construction(L.mNodeAllocator))
 		{
 			LinkedListIterator it = L.begin();
 			while (it != L.end())
@@ -221,14 +239,15 @@ namespace ssuds
 		}
 
 		/// Initializer-list constructor
-		LinkedList(const std::initializer_list<T>& initial_vals) : mStart(nullptr), mEnd(nullptr), mSize(0)
+		LinkedList(const std::initializer_list<T>& initial_vals, const Allocator& alloc = Allocator()) : mStart(nullptr), mEnd(nullptr), mSize(0),
+			mNodeAllocator(alloc)
 		{
 			for (T val : initial_vals)
 				append(val);
 		}
 
 		/// Move constructor (the noexcept "decorator" indicates we won't be throwing exceptions -- customary for move-constructors)
-		LinkedList(LinkedList&& other) noexcept : mSize(other.mSize), mStart(other.mStart), mEnd(other.mEnd)
+		LinkedList(LinkedList&& other) noexcept : mStart(other.mStart), mEnd(other.mEnd), mSize(other.mSize), mNodeAllocator(other.mNodeAllocator)
 		{
 			// Since we're "stealing" the data from the other one, we set their array pointers to
 			// NULL (so when the destructor runs, it won't free up what is now our memory)
@@ -307,12 +326,12 @@ namespace ssuds
 			if (mStart == NULL)
 			{
 				// Case I: This is the first Node.  start and end will both point towards it
-				mStart = mEnd = new Node(val);
+				mStart = mEnd = new_node(val);
 			}
 			else
 			{
 				// Case II -- we already have a head -- add the new Node to the end
-				Node* new_Node = new Node(val);
+				Node* new_Node = new_node(val);
 				new_Node->mPrev = mEnd;
 				mEnd->mNext = new_Node;
 				mEnd = new_Node;
@@ -340,7 +359,7 @@ namespace ssuds
 				Node* next = temp->mNext;
 
 				// Delete the current Node
-				delete temp;
+				delete_node(temp);
 
 				// Advance to the next Node (if any) using the saved pointer.
 				temp = next;
@@ -359,6 +378,13 @@ namespace ssuds
 		}
 
 
+		/// Returns a copy of the allocator our Nodes come from
+		Allocator get_allocator() const
+		{
+			return Allocator(mNodeAllocator);
+		}
+
+
 		/// Finds the first occurrence of the given value starting at the given iterator
 		LinkedListIterator find(const T& val, const LinkedListIterator& start) const
 		{
@@ -420,13 +446,38 @@ namespace ssuds
 		}
 
 	protected:
+		/// An internal method to make a new (unlinked) Node holding val with our allocator
+		Node* new_node(const T& val)
+		{
+			Node* result = node_traits::allocate(mNodeAllocator, 1);
+			try
+			{
+				node_traits::construct(mNodeAllocator, result, val);
+			}
+			catch (...)
+			{
+				node_traits::deallocate(mNodeAllocator, result, 1);
+				throw;
+			}
+			return result;
+		}
+
+
+		/// An internal method to destroy a Node made by new_node and give its memory back to our allocator
+		void delete_node(Node* n)
+		{
+			node_traits::destroy(mNodeAllocator, n);
+			node_traits::deallocate(mNodeAllocator, n, 1);
+		}
+
+
 		/// An internal method to insert a new value before an existing Node -- this Node should not
 		/// be either the start / end Node (use prepend/append in these situtations)
 		void insert_internal(const T& item, Node* cur)
 		{
 			// Because of our initial checks, we can be sure that this Node will be between two 
 			// existing Nodes
-			Node* new_Node = new Node(item);
+			Node* new_Node = new_node(item);
 			new_Node->mPrev = cur->mPrev;
 			new_Node->mNext = cur;
 			cur->mPrev->mNext = new_Node;
@@ -445,12 +496,12 @@ namespace ssuds
 			if (mStart == NULL)
 			{
 				// Case I: This is the first Node.  start and end will both point towards it
-				mStart = mEnd = new Node(val);
+				mStart = mEnd = new_node(val);
 			}
 			else
 			{
 				// Case II -- we already have a head -- add the new Node before it
-				Node * new_Node = new Node(val);
+				Node * new_Node = new_node(val);
 				new_Node->mNext = mStart;
 				mStart->mPrev = new_Node;
 				mStart = new_Node;
@@ -486,7 +537,7 @@ namespace ssuds
 			{
 				// There's only one element here.  We're clearing the list
 				T val = mStart->mData;
-				delete mStart;
+				delete_node(mStart);
 				mStart = mEnd = NULL;
 				mSize = 0;
 				return end();
@@ -497,7 +548,7 @@ namespace ssuds
 				Node* next = mStart->mNext;
 				next->mPrev = NULL;
 				T val = mStart->mData;
-				delete mStart;
+				delete_node(mStart);
 				mStart = next;
 				mSize--;
 				if (spot.mForward)
@@ -511,7 +562,7 @@ namespace ssuds
 				Node* prev = mEnd->mPrev;
 				prev->mNext = NULL;
 				T val = mEnd->mData;
-				delete mEnd;
+				delete_node(mEnd);
 				mEnd = prev;
 				mSize--;
 				if (spot.mForward)
@@ -531,7 +582,7 @@ namespace ssuds
 					rv = LinkedListIterator(this, goner->mNext, spot.mCurrentIndex, true);
 				else
 					rv = LinkedListIterator(this, goner->mPrev, spot.mCurrentIndex, false);
-				delete goner;
+				delete_node(goner);
 				mSize--;
 				return rv;
 			}
@@ -581,4 +632,12 @@ namespace ssuds
 
 		
 	};	// END of LinkedList class
+
+
+	namespace pmr
+	{
+		/// A LinkedList whose Nodes come from a std::pmr::memory_resource (e.g. an ssuds::FixedPool)
+		template <class T>
+		using LinkedList = ssuds::LinkedList<T, std::pmr::polymorphic_allocator<T>>;
+	}
 }	// END of ssuge namespace
\ No newline at end of file
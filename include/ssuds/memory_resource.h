@@ -0,0 +1,299 @@
+#pragma once
+#include <cstddef>
+#include <memory_resource>
+#include <new>
+
+namespace ssuds
+{
+	/// <summary>
+	/// A std::pmr::memory_resource that hands out memory by bumping a pointer through big chunks it gets from an
+	/// upstream resource.  Deallocating does nothing: everything is given back at once by release() (or the
+	/// destructor).  So every container using a MonotonicArena (through a std::pmr::polymorphic_allocator, e.g. an
+	/// ssuds::pmr::ArrayList) can be thrown away in one shot, without visiting any item -- as long as the items
+	/// don't own memory of their own that lives elsewhere (their destructors aren't run by release).
+	/// Each chunk is twice the size of the one before it.  Not thread-safe.
+	/// </summary>
+	class MonotonicArena : public std::pmr::memory_resource
+	{
+	protected:
+		/// The start of each chunk: a link to the chunk before it (the rest of the chunk is handed out)
+		struct Chunk
+		{
+			Chunk* mPrev;
+			std::size_t mSize;
+		};
+
+		/// The most recent chunk (which the next allocation comes from), or nullptr
+		Chunk* mChunks;
+
+		/// The unused part of the current chunk
+		char* mNext;
+		char* mEnd;
+
+		/// How big the next chunk will be
+		std::size_t mNextChunkSize;
+
+		/// The total of every allocation's size (not counting alignment padding)
+		std::size_t mBytesAllocated;
+
+		std::pmr::memory_resource* mUpstream;
+
+		static const std::size_t msMinChunkSize = 1024;
+
+		/// Gets a new chunk with room for at least bytes (with the given alignment)
+		void add_chunk(std::size_t bytes, std::size_t alignment)
+		{
+			std::size_t needed = sizeof(Chunk) + bytes + alignment;
+			while (mNextChunkSize < needed)
+				mNextChunkSize *= 2;
+			Chunk* chunk = (Chunk*)mUpstream->allocate(mNextChunkSize, alignof(std::max_align_t));
+			chunk->mPrev = mChunks;
+			chunk->mSize = mNextChunkSize;
+			mChunks = chunk;
+			mNext = (char*)(chunk + 1);
+			mEnd = (char*)chunk + mNextChunkSize;
+			mNextChunkSize *= 2;
+		}
+
+		void* do_allocate(std::size_t bytes, std::size_t alignment) override
+		{
+			for (int attempt = 0; attempt < 2; attempt++)
+			{
+				if (mChunks)
+				{
+					std::size_t padding = (alignment - (std::size_t)mNext % alignment) % alignment;
+					if (padding + bytes <= (std::size_t)(mEnd - mNext))
+					{
+						void* result = mNext + padding;
+						mNext += padding + bytes;
+						mBytesAllocated += bytes;
+						return result;
+					}
+				}
+				add_chunk(bytes, alignment);
+			}
+			throw std::bad_alloc();
+		}
+
+		void do_deallocate(void*, std::size_t, std::size_t) override
+		{
+			// Nothing is given back until release
+		}
+
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+		{
+			return this == &other;
+		}
+
+	public:
+		/// <summary>
+		/// Constructor.  Nothing is allocated until the first allocation
+		/// </summary>
+		/// <param name="initial_chunk_size">the size of the first chunk (later ones double)</param>
+		/// <param name="upstream">where the chunks come from</param>
+		explicit MonotonicArena(std::size_t initial_chunk_size = msMinChunkSize, std::pmr::memory_resource* upstream = std::pmr::get_default_resource()) :
+			mChunks(nullptr), mNext(nullptr), mEnd(nullptr), mNextChunkSize(initial_chunk_size < msMinChunkSize ? msMinChunkSize : initial_chunk_size),
+			mBytesAllocated(0), mUpstream(upstream)
+		{
+			// intentionally empty
+		}
+
+		MonotonicArena(const MonotonicArena&) = delete;
+		MonotonicArena& operator=(const MonotonicArena&) = delete;
+
+		/// Destructor: gives back every chunk
+		~MonotonicArena()
+		{
+			release();
+		}
+
+		/// <summary>
+		/// Gives every chunk back to the upstream resource.  Anything allocated from the arena must no longer be used
+		/// </summary>
+		void release()
+		{
+			while (mChunks)
+			{
+				Chunk* prev = mChunks->mPrev;
+				mUpstream->deallocate(mChunks, mChunks->mSize, alignof(std::max_align_t));
+				mChunks = prev;
+			}
+			mNext = mEnd = nullptr;
+			mBytesAllocated = 0;
+		}
+
+		/// <summary>
+		/// Returns the total size of everything allocated since the last release
+		/// </summary>
+		std::size_t bytes_allocated() const
+		{
+			return mBytesAllocated;
+		}
+
+		/// <summary>
+		/// Returns the upstream resource the chunks come from
+		/// </summary>
+		std::pmr::memory_resource* upstream_resource() const
+		{
+			return mUpstream;
+		}
+	};
+
+
+	/// <summary>
+	/// A std::pmr::memory_resource for lots of allocations of one size, like the nodes of an ssuds::pmr::LinkedList
+	/// or OrderedSet.  Blocks of block_size bytes are carved out of chunks from an upstream resource, and a
+	/// deallocated block goes on a free list to be handed out again, so allocating and deallocating are a few
+	/// instructions each and the blocks are packed together.  Requests for more than block_size bytes (or a bigger
+	/// alignment than std::max_align_t) are passed to the upstream resource.  release() (or the destructor) gives
+	/// every chunk back at once.  Not thread-safe.
+	/// </summary>
+	class FixedPool : public std::pmr::memory_resource
+	{
+	protected:
+		/// A free block holds a link to the next free block
+		struct FreeBlock
+		{
+			FreeBlock* mNext;
+		};
+
+		/// The start of each chunk (the blocks follow it)
+		struct Chunk
+		{
+			Chunk* mPrev;
+			std::size_t mSize;
+			alignas(std::max_align_t) char mBlocks[1];
+		};
+
+		std::size_t mBlockSize;
+		std::size_t mBlocksPerChunk;
+
+		/// Every chunk we have, newest first
+		Chunk* mChunks;
+
+		/// The blocks that have been given back
+		FreeBlock* mFree;
+
+		/// The blocks of the newest chunk that have never been handed out
+		char* mNext;
+		char* mEnd;
+
+		/// How many blocks are in use right now
+		std::size_t mBlocksInUse;
+
+		std::pmr::memory_resource* mUpstream;
+
+		void* do_allocate(std::size_t bytes, std::size_t alignment) override
+		{
+			if (bytes > mBlockSize || alignment > alignof(std::max_align_t))
+				return mUpstream->allocate(bytes, alignment);
+			void* result;
+			if (mFree)
+			{
+				result = mFree;
+				mFree = mFree->mNext;
+			}
+			else
+			{
+				if (mNext == mEnd)
+				{
+					std::size_t size = offsetof(Chunk, mBlocks) + mBlockSize * mBlocksPerChunk;
+					Chunk* chunk = (Chunk*)mUpstream->allocate(size, alignof(Chunk));
+					chunk->mPrev = mChunks;
+					chunk->mSize = size;
+					mChunks = chunk;
+					mNext = chunk->mBlocks;
+					mEnd = mNext + mBlockSize * mBlocksPerChunk;
+				}
+				result = mNext;
+				mNext += mBlockSize;
+			}
+			mBlocksInUse++;
+			return result;
+		}
+
+		void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override
+		{
+			if (bytes > mBlockSize || alignment > alignof(std::max_align_t))
+			{
+				mUpstream->deallocate(p, bytes, alignment);
+				return;
+			}
+			FreeBlock* block = (FreeBlock*)p;
+			block->mNext = mFree;
+			mFree = block;
+			mBlocksInUse--;
+		}
+
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+		{
+			return this == &other;
+		}
+
+	public:
+		/// <summary>
+		/// Constructor.  Nothing is allocated until the first allocation
+		/// </summary>
+		/// <param name="block_size">the size of every block (rounded up to a multiple of std::max_align_t's alignment)</param>
+		/// <param name="blocks_per_chunk">how many blocks each chunk from upstream holds</param>
+		/// <param name="upstream">where the chunks (and any allocation too big for a block) come from</param>
+		explicit FixedPool(std::size_t block_size, std::size_t blocks_per_chunk = 256, std::pmr::memory_resource* upstream = std::pmr::get_default_resource()) :
+			mBlocksPerChunk(blocks_per_chunk > 0 ? blocks_per_chunk : 1), mChunks(nullptr), mFree(nullptr), mNext(nullptr), mEnd(nullptr),
+			mBlocksInUse(0), mUpstream(upstream)
+		{
+			const std::size_t align = alignof(std::max_align_t);
+			mBlockSize = block_size < sizeof(FreeBlock) ? sizeof(FreeBlock) : block_size;
+			mBlockSize = (mBlockSize + align - 1) / align * align;
+		}
+
+		FixedPool(const FixedPool&) = delete;
+		FixedPool& operator=(const FixedPool&) = delete;
+
+		/// Destructor: gives back every chunk
+		~FixedPool()
+		{
+			release();
+		}
+
+		/// <summary>
+		/// Gives every chunk back to the upstream resource.  Blocks handed out must no longer be used (allocations that
+		/// were too big for a block went to upstream and are not affected)
+		/// </summary>
+		void release()
+		{
+			while (mChunks)
+			{
+				Chunk* prev = mChunks->mPrev;
+				mUpstream->deallocate(mChunks, mChunks->mSize, alignof(Chunk));
+				mChunks = prev;
+			}
+			mFree = nullptr;
+			mNext = mEnd = nullptr;
+			mBlocksInUse = 0;
+		}
+
+		/// <summary>
+		/// Returns the (rounded up) size of every block
+		/// </summary>
+		std::size_t block_size() const
+		{
+			return mBlockSize;
+		}
+
+		/// <summary>
+		/// Returns how many blocks are handed out right now
+		/// </summary>
+		std::size_t blocks_in_use() const
+		{
+			return mBlocksInUse;
+		}
+
+		/// <summary>
+		/// Returns the upstream resource the chunks come from
+		/// </summary>
+		std::pmr::memory_resource* upstream_resource() const
+		{
+			return mUpstream;
+		}
+	};
+}
@@ -0,0 +1,586 @@
+#pragma once
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <control_group.h>
+#include <hash.h>
+
+namespace ssuds
+{
+	/// <summary>
+	/// A thread-safe map for read-mostly workloads where lookups never write to shared memory (no lock, no
+	/// reference count), so readers on different cores never fight over a cache line.  Keys are split into shards
+	/// (groups of buckets), each an open-addressing table laid out like UnorderedMap's (control bytes probed a
+	/// ControlGroup at a time, fibonacci hashing, backward-shift deletion).  Each shard has:
+	///   - a mutex that writers take, so writers only wait for other writers in the same shard
+	///   - a sequence counter that writers make odd while they change the shard and even again when done.  A
+	///     reader notes the (even) counter, copies what it needs out of the table, and tries again if the counter
+	///     has changed in the meantime (a "seqlock").  A lookup is linearizable: it returns what the shard held at
+	///     the moment the reader read the counter.
+	/// Because a reader may be in the middle of copying a slot while a writer changes it, K and V must be
+	/// trivially copyable (a half-copied int is thrown away harmlessly; a half-copied std::string is not).  So that
+	/// this racing is well-defined, the control bytes are atomics and each slot is stored as a few atomic words, all
+	/// read and written with relaxed loads and stores (the sequence counter does the ordering).  When a
+	/// shard grows, readers may still be looking at its old table, so old tables are only freed when the map is
+	/// destroyed.  Since each table is twice the size of the last, that's never more than the current tables' size.
+	/// </summary>
+	/// <typeparam name="K">The key type (must be trivially copyable)</typeparam>
+	/// <typeparam name="V">The value type (must be trivially copyable)</typeparam>
+	/// <typeparam name="Hash">The hash function (see UnorderedMap)</typeparam>
+	/// <typeparam name="Allocator">Where the shards and tables come from (rebound to each of their arrays)</typeparam>
+	template <class K, class V, class Hash = FastHash<K>, class Allocator = std::allocator<std::pair<K, V>>>
+	class OptimisticUnorderedMap
+	{
+		static_assert(std::is_trivially_copyable<K>::value && std::is_trivially_copyable<V>::value,
+			"OptimisticUnorderedMap's readers copy slots while they might be changing, so K and V must be trivially copyable");
+
+	protected:
+		/// <summary>
+		/// One key-value pair.  (std::pair isn't trivially copyable, even when its members are)
+		/// </summary>
+		struct Slot
+		{
+			K mKey;
+			V mValue;
+		};
+
+		/// The unit slots are stored (and copied) in
+		typedef std::size_t word_type;
+
+		/// How many words one slot takes up, and how many of those its key (which comes first) covers
+		static const unsigned int msSlotWords = (unsigned int)((sizeof(Slot) + sizeof(word_type) - 1) / sizeof(word_type));
+		static const unsigned int msKeyWords = (unsigned int)((sizeof(K) + sizeof(word_type) - 1) / sizeof(word_type));
+
+		static_assert(sizeof(std::atomic<unsigned char>) == 1 && sizeof(std::atomic<word_type>) == sizeof(word_type),
+			"OptimisticUnorderedMap needs lock-free byte and word atomics");
+
+		/// <summary>
+		/// One shard's open-addressing table.  A table that has been handed to readers never changes size, and
+		/// is never freed before the map is
+		/// </summary>
+		struct Table
+		{
+			/// Always a power of two
+			unsigned int mCapacity;
+
+			/// The home slot is hash >> mShift
+			unsigned int mShift;
+
+			/// mCapacity control bytes (see UnorderedMap), plus ControlGroup::msWidth - 1 mirrored ones
+			std::atomic<unsigned char>* mControl;
+
+			/// mCapacity slots of msSlotWords words each (only the used ones hold anything)
+			std::atomic<word_type>* mSlots;
+
+			/// The table this one replaced (kept for readers that might still be using it)
+			Table* mRetired;
+		};
+
+		/// <summary>
+		/// One group of buckets, with its own writer lock and sequence counter.  Each shard gets its own cache
+		/// line(s) so readers of one shard never see writes to another (false sharing)
+		/// </summary>
+		struct alignas(64) Shard
+		{
+			/// Odd while a writer is changing this shard
+			std::atomic<unsigned int> mSequence;
+
+			/// The current table
+			std::atomic<Table*> mTable;
+
+			/// The number of used slots (only changed by writers, so readers just need it to not tear)
+			std::atomic<unsigned int> mSize;
+
+			/// Held by writers
+			std::mutex mLock;
+
+			/// The map gives a new shard its first table (see make_table)
+			Shard() : mSequence(0), mTable(nullptr), mSize(0)
+			{
+				// intentionally empty
+			}
+		};
+
+		/// An array of mNumShards shards
+		Shard* mShards;
+
+		/// The number of shards (always a power of two)
+		unsigned int mNumShards;
+
+		/// The shard for a key is the top log2(mNumShards) bits of its mixed hash code
+		unsigned int mShardShift;
+
+		/// Used to hash keys
+		Hash mHashGenerator;
+
+		/// Where the shards and tables come from
+		Allocator mAllocator;
+
+		/// The default number of shards
+		static const unsigned int msDefaultShards = 64;
+
+		/// The smallest table a shard will have
+		static const unsigned int msMinCapacity = 16;
+
+		/// A shard's table doubles in size when an insert would take it past this fraction
+		static constexpr float msMaxLoadFactor = 0.75f;
+
+		/// See UnorderedMap::msFibonacciMultiplier
+		static const unsigned long long msFibonacciMultiplier = 11400714819323198485ull;
+
+		/// <summary>
+		/// A writer's hold on a shard: locks the shard and makes its sequence counter odd until it goes out of scope
+		/// </summary>
+		class WriteGuard
+		{
+		public:
+			WriteGuard(Shard& shard) : mShard(shard), mLock(shard.mLock)
+			{
+				// Only writers (which hold mLock) change mSequence, so a plain load is enough
+				mShard.mSequence.store(mShard.mSequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+				// Any reader that sees one of our changes to the table will also see the odd counter
+				std::atomic_thread_fence(std::memory_order_release);
+			}
+
+			~WriteGuard()
+			{
+				mShard.mSequence.store(mShard.mSequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+			}
+
+		protected:
+			Shard& mShard;
+			std::lock_guard<std::mutex> mLock;
+		};
+
+		/// The hash function's result for a key (before any mixing)
+		unsigned long long raw_hash(const K& key) const
+		{
+			return (unsigned long long)mHashGenerator(key);
+		}
+
+		/// The shard for a raw hash code.  It is picked from differently mixed bits than the home slot (see
+		/// ConcurrentUnorderedMap::shard_for)
+		Shard& shard_for(unsigned long long raw) const
+		{
+			return mShards[mNumShards == 1 ? 0 : (unsigned int)(mix_integer(raw) >> mShardShift)];
+		}
+
+		/// Gets an (uninitialized) array of n T's from our allocator, rebound to T
+		template <class T>
+		T* allocate_array(std::size_t n)
+		{
+			typename std::allocator_traits<Allocator>::template rebind_alloc<T> alloc(mAllocator);
+			return std::allocator_traits<decltype(alloc)>::allocate(alloc, n);
+		}
+
+		/// Gives an array from allocate_array back
+		template <class T>
+		void deallocate_array(T* arr, std::size_t n)
+		{
+			typename std::allocator_traits<Allocator>::template rebind_alloc<T> alloc(mAllocator);
+			std::allocator_traits<decltype(alloc)>::deallocate(alloc, arr, n);
+		}
+
+		/// Makes an empty table of cap slots (a power of two) that replaces retired
+		Table* make_table(unsigned int cap, Table* retired)
+		{
+			unsigned int shift = 64;
+			for (unsigned int i = cap; i > 1; i /= 2)
+				shift--;
+			Table* table = ::new ((void*)allocate_array<Table>(1)) Table{ cap, shift, nullptr, nullptr, retired };
+			try
+			{
+				table->mControl = allocate_array<std::atomic<unsigned char>>(cap + ControlGroup::msWidth - 1);
+				for (unsigned int i = 0; i < cap + ControlGroup::msWidth - 1; i++)
+					::new ((void*)(table->mControl + i)) std::atomic<unsigned char>(ControlGroup::msEmpty);
+				table->mSlots = allocate_array<std::atomic<word_type>>((std::size_t)cap * msSlotWords);
+				for (std::size_t i = 0; i < (std::size_t)cap * msSlotWords; i++)
+					::new ((void*)(table->mSlots + i)) std::atomic<word_type>(0);
+			}
+			catch (...)
+			{
+				table->mRetired = nullptr;
+				free_tables(table);
+				throw;
+			}
+			return table;
+		}
+
+		/// Frees table and every table it replaced
+		void free_tables(Table* table)
+		{
+			while (table)
+			{
+				Table* retired = table->mRetired;
+				if (table->mControl)
+					deallocate_array(table->mControl, table->mCapacity + ControlGroup::msWidth - 1);
+				if (table->mSlots)
+					deallocate_array(table->mSlots, (std::size_t)table->mCapacity * msSlotWords);
+				deallocate_array(table, 1);
+				table = retired;
+			}
+		}
+
+		/// Sets the control byte of a slot, along with its mirror(s) past the end of the table
+		static void set_control(Table* table, unsigned int ind, unsigned char control)
+		{
+			table->mControl[ind].store(control, std::memory_order_relaxed);
+			for (unsigned int i = ind + table->mCapacity; i < table->mCapacity + ControlGroup::msWidth - 1; i += table->mCapacity)
+				table->mControl[i].store(control, std::memory_order_relaxed);
+		}
+
+		/// The control byte of a slot
+		static unsigned char get_control(const Table* table, unsigned int ind)
+		{
+			return table->mControl[ind].load(std::memory_order_relaxed);
+		}
+
+		/// Copies the ControlGroup::msWidth control bytes starting at ind into group (for a ControlGroup to look at)
+		static void load_group(const Table* table, unsigned int ind, unsigned char* group)
+		{
+			for (unsigned int i = 0; i < ControlGroup::msWidth; i++)
+				group[i] = table->mControl[ind + i].load(std::memory_order_relaxed);
+		}
+
+		/// Copies the first num_words words of slot ind into dest (which must have room for that many words)
+		static void read_slot(const Table* table, unsigned int ind, unsigned int num_words, void* dest)
+		{
+			word_type words[msSlotWords];
+			const std::atomic<word_type>* src = table->mSlots + (std::size_t)ind * msSlotWords;
+			for (unsigned int i = 0; i < num_words; i++)
+				words[i] = src[i].load(std::memory_order_relaxed);
+			std::memcpy(dest, words, num_words * sizeof(word_type));
+		}
+
+		/// Stores item in slot ind
+		static void write_slot(Table* table, unsigned int ind, const Slot& item)
+		{
+			word_type words[msSlotWords] = {};
+			std::memcpy((void*)words, (const void*)&item, sizeof(Slot));
+			std::atomic<word_type>* dest = table->mSlots + (std::size_t)ind * msSlotWords;
+			for (unsigned int i = 0; i < msSlotWords; i++)
+				dest[i].store(words[i], std::memory_order_relaxed);
+		}
+
+		/// Copies slot src_ind over slot dest_ind (writers only)
+		static void move_slot(Table* table, unsigned int dest_ind, unsigned int src_ind)
+		{
+			std::atomic<word_type>* src = table->mSlots + (std::size_t)src_ind * msSlotWords;
+			std::atomic<word_type>* dest = table->mSlots + (std::size_t)dest_ind * msSlotWords;
+			for (unsigned int i = 0; i < msSlotWords; i++)
+				dest[i].store(src[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+		}
+
+		/// The hash function's result for the key in slot ind (writers only)
+		unsigned long long slot_raw_hash(const Table* table, unsigned int ind) const
+		{
+			alignas(Slot) unsigned char buf[msSlotWords * sizeof(word_type)];
+			read_slot(table, ind, msKeyWords, buf);
+			return raw_hash(((const Slot*)buf)->mKey);
+		}
+
+		/// <summary>
+		/// Walks the probe chain for key (a ControlGroup at a time) in table.  Returns the slot holding key (found is
+		/// set to true) or the first unused slot.  Readers call this on a table that may be changing under them, so it
+		/// never looks past mCapacity slots, and anything it returns has to be checked against the sequence counter
+		/// </summary>
+		static unsigned int probe(const Table* table, const K& key, unsigned long long hash, bool& found)
+		{
+			unsigned int mask = table->mCapacity - 1;
+			unsigned char frag = ControlGroup::fragment(hash);
+			unsigned int ind = (unsigned int)(hash >> table->mShift);
+			unsigned char group_bytes[ControlGroup::msWidth];
+			alignas(Slot) unsigned char key_buf[msKeyWords * sizeof(word_type)];
+			for (unsigned int checked = 0; checked <= table->mCapacity; checked += ControlGroup::msWidth)
+			{
+				load_group(table, ind, group_bytes);
+				ControlGroup group(group_bytes);
+				unsigned int empties = group.match_empty();
+				unsigned int candidates = group.match(frag);
+				if (empties != 0)
+					candidates &= (empties & (~empties + 1)) - 1;
+
+				while (candidates != 0)
+				{
+					unsigned int slot = (ind + count_trailing_zeros(candidates)) & mask;
+					read_slot(table, slot, msKeyWords, key_buf);
+					if (((const Slot*)key_buf)->mKey == key)
+					{
+						found = true;
+						return slot;
+					}
+					candidates &= candidates - 1;
+				}
+
+				if (empties != 0)
+				{
+					found = false;
+					return (ind + count_trailing_zeros(empties)) & mask;
+				}
+				ind = (ind + ControlGroup::msWidth) & mask;
+			}
+			// Only a reader that raced with a writer can get here -- its sequence check will fail
+			found = false;
+			return 0;
+		}
+
+		/// <summary>
+		/// Puts (key, value) in the first unused slot of its probe chain.  The key must not be in the table
+		/// </summary>
+		static void insert_unique(Table* table, const Slot& item, unsigned long long hash)
+		{
+			unsigned int mask = table->mCapacity - 1;
+			unsigned int ind = (unsigned int)(hash >> table->mShift);
+			unsigned char group_bytes[ControlGroup::msWidth];
+			unsigned int empties;
+			while (load_group(table, ind, group_bytes), (empties = ControlGroup(group_bytes).match_empty()) == 0)
+				ind = (ind + ControlGroup::msWidth) & mask;
+			ind = (ind + count_trailing_zeros(empties)) & mask;
+			write_slot(table, ind, item);
+			set_control(table, ind, ControlGroup::fragment(hash));
+		}
+
+		/// <summary>
+		/// Builds a table twice the size of the shard's current one and publishes it.  The old table is kept (see
+		/// Table::mRetired).  Must be called under a WriteGuard
+		/// </summary>
+		void grow(Shard& shard)
+		{
+			Table* old_table = shard.mTable.load(std::memory_order_relaxed);
+			Table* new_table = make_table(old_table->mCapacity * 2, old_table);
+			alignas(Slot) unsigned char buf[msSlotWords * sizeof(word_type)];
+			for (unsigned int i = 0; i < old_table->mCapacity; i++)
+			{
+				if (ControlGroup::is_full(get_control(old_table, i)))
+				{
+					read_slot(old_table, i, msSlotWords, buf);
+					const Slot& item = *(const Slot*)buf;
+					insert_unique(new_table, item, raw_hash(item.mKey) * msFibonacciMultiplier);
+				}
+			}
+			shard.mTable.store(new_table, std::memory_order_release);
+		}
+
+		/// <summary>
+		/// The lock-free lookup behind find and contains: if key is found (and slot isn't nullptr) its whole slot is
+		/// copied into slot, which must have room for msSlotWords words.  Retries (spinning) while a writer is
+		/// changing key's shard
+		/// </summary>
+		bool lookup(const K& key, unsigned char* slot) const
+		{
+			unsigned long long raw = raw_hash(key);
+			unsigned long long hash = raw * msFibonacciMultiplier;
+			const Shard& shard = shard_for(raw);
+			while (true)
+			{
+				unsigned int sequence = shard.mSequence.load(std::memory_order_acquire);
+				if (sequence & 1)
+				{
+					std::this_thread::yield();
+					continue;
+				}
+
+				const Table* table = shard.mTable.load(std::memory_order_acquire);
+				bool found;
+				unsigned int ind = probe(table, key, hash, found);
+				if (found && slot)
+					read_slot(table, ind, msSlotWords, slot);
+
+				// Make sure everything above is read before we check the counter again
+				std::atomic_thread_fence(std::memory_order_acquire);
+				if (shard.mSequence.load(std::memory_order_relaxed) == sequence)
+					return found;
+			}
+		}
+
+		/// Frees every shard and its tables
+		void destroy_shards()
+		{
+			for (unsigned int i = 0; i < mNumShards; i++)
+			{
+				free_tables(mShards[i].mTable.load(std::memory_order_relaxed));
+				mShards[i].~Shard();
+			}
+			deallocate_array(mShards, mNumShards);
+		}
+
+	public:
+		/// <summary>
+		/// Constructor
+		/// </summary>
+		/// <param name="num_shards">how many shards to split the map into.  Rounded up to a power of two</param>
+		/// <param name="hash_function">the Hash object to use (only needed if Hash has some state)</param>
+		/// <param name="alloc">the allocator for the shards and their tables</param>
+		OptimisticUnorderedMap(unsigned int num_shards = msDefaultShards, const Hash& hash_function = Hash(), const Allocator& alloc = Allocator()) :
+			mHashGenerator(hash_function), mAllocator(alloc)
+		{
+			if (num_shards == 0)
+				throw std::invalid_argument("Invalid number of shards: 0");
+			mNumShards = 1;
+			mShardShift = 64;
+			while (mNumShards < num_shards)
+			{
+				mNumShards *= 2;
+				mShardShift--;
+			}
+			mShards = allocate_array<Shard>(mNumShards);
+			for (unsigned int i = 0; i < mNumShards; i++)
+				::new ((void*)(mShards + i)) Shard();
+			try
+			{
+				for (unsigned int i = 0; i < mNumShards; i++)
+					mShards[i].mTable.store(make_table(msMinCapacity, nullptr), std::memory_order_relaxed);
+			}
+			catch (...)
+			{
+				destroy_shards();
+				throw;
+			}
+		}
+
+		/// Makes an empty map with the default number of shards, whose memory comes from alloc (for a pmr map this can
+		/// be given a std::pmr::memory_resource*)
+		explicit OptimisticUnorderedMap(const Allocator& alloc) : OptimisticUnorderedMap(msDefaultShards, Hash(), alloc)
+		{
+			// intentionally empty
+		}
+
+		/// The shards (and their locks) can't be shared or handed over, so neither can the map
+		OptimisticUnorderedMap(const OptimisticUnorderedMap& other) = delete;
+		OptimisticUnorderedMap& operator=(const OptimisticUnorderedMap& other) = delete;
+
+		/// Destructor.  No other thread may be using the map
+		~OptimisticUnorderedMap()
+		{
+			destroy_shards();
+		}
+
+		/// Returns a copy of the allocator the shards and tables come from
+		Allocator get_allocator() const
+		{
+			return mAllocator;
+		}
+
+		/// <summary>
+		/// Returns the number of shards the map is split into
+		/// </summary>
+		unsigned int num_shards() const
+		{
+			return mNumShards;
+		}
+
+		/// <summary>
+		/// Looks up key without taking a lock or writing to anything shared, copying its value into value if it is
+		/// found.  Retries (spinning) while a writer is changing key's shard
+		/// </summary>
+		/// <returns>true if the key was found</returns>
+		bool find(const K& key, V& value) const
+		{
+			alignas(Slot) unsigned char buf[msSlotWords * sizeof(word_type)];
+			if (!lookup(key, buf))
+				return false;
+			std::memcpy((void*)&value, (const void*)&((const Slot*)buf)->mValue, sizeof(V));
+			return true;
+		}
+
+		/// <summary>
+		/// Returns true if key is in the map (see find)
+		/// </summary>
+		bool contains(const K& key) const
+		{
+			return lookup(key, nullptr);
+		}
+
+		/// <summary>
+		/// Sets the value for key, adding the key if it isn't already in the map.  Only blocks (and only makes
+		/// readers retry) in key's shard
+		/// </summary>
+		/// <returns>true if the key was added, false if an existing value was replaced</returns>
+		bool insert_or_assign(const K& key, const V& value)
+		{
+			unsigned long long raw = raw_hash(key);
+			unsigned long long hash = raw * msFibonacciMultiplier;
+			Shard& shard = shard_for(raw);
+			WriteGuard guard(shard);
+
+			Table* table = shard.mTable.load(std::memory_order_relaxed);
+			bool found;
+			unsigned int ind = probe(table, key, hash, found);
+			if (found)
+			{
+				write_slot(table, ind, Slot{ key, value });
+				return false;
+			}
+
+			unsigned int size = shard.mSize.load(std::memory_order_relaxed);
+			if (size + 1 > table->mCapacity * msMaxLoadFactor)
+			{
+				grow(shard);
+				table = shard.mTable.load(std::memory_order_relaxed);
+			}
+			insert_unique(table, Slot{ key, value }, hash);
+			shard.mSize.store(size + 1, std::memory_order_relaxed);
+			return true;
+		}
+
+		/// <summary>
+		/// Removes key from the map (using backward-shift deletion, like UnorderedMap::remove)
+		/// </summary>
+		/// <returns>false if the key was not in the map</returns>
+		bool remove(const K& key)
+		{
+			unsigned long long raw = raw_hash(key);
+			unsigned long long hash = raw * msFibonacciMultiplier;
+			Shard& shard = shard_for(raw);
+			WriteGuard guard(shard);
+
+			Table* table = shard.mTable.load(std::memory_order_relaxed);
+			bool found;
+			unsigned int hole = probe(table, key, hash, found);
+			if (!found)
+				return false;
+
+			unsigned int mask = table->mCapacity - 1;
+			unsigned int ind = (hole + 1) & mask;
+			while (ControlGroup::is_full(get_control(table, ind)))
+			{
+				unsigned int home = (unsigned int)((slot_raw_hash(table, ind) * msFibonacciMultiplier) >> table->mShift);
+				if (((ind - home) & mask) >= ((ind - hole) & mask))
+				{
+					move_slot(table, hole, ind);
+					set_control(table, hole, get_control(table, ind));
+					hole = ind;
+				}
+				ind = (ind + 1) & mask;
+			}
+			set_control(table, hole, ControlGroup::msEmpty);
+			shard.mSize.store(shard.mSize.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+			return true;
+		}
+
+		/// <summary>
+		/// Returns the number of items in the map.  If other threads are adding or removing, this is only a snapshot
+		/// </summary>
+		unsigned int size() const
+		{
+			unsigned int result = 0;
+			for (unsigned int i = 0; i < mNumShards; i++)
+				result += mShards[i].mSize.load(std::memory_order_relaxed);
+			return result;
+		}
+	};
+
+	namespace pmr
+	{
+		/// An OptimisticUnorderedMap whose shards and tables come from a std::pmr::memory_resource (e.g. an ssuds::MonotonicArena)
+		template <class K, class V, class Hash = FastHash<K>>
+		using OptimisticUnorderedMap = ssuds::OptimisticUnorderedMap<K, V, Hash, std::pmr::polymorphic_allocator<std::pair<K, V>>>;
+	}
+}
@@ -1,4 +1,6 @@
 #pragma once
+#include <memory>
+#include <memory_resource>
 #include <array_list.h>
 #include <sstream>
 #include <stack.h>
@@ -14,7 +16,9 @@ namespace ssuds
 	/// values in-order (plus a few other ways)
 	/// </summary>
 	/// <typeparam name="T">The type of data we'll store in the set</typeparam>
-	template <class T>
+	/// <typeparam name="Allocator">Where the nodes come from (rebound to the node type -- see ssuds::pmr::OrderedSet
+	/// for one that takes a std::pmr::memory_resource)</typeparam>
+	template <class T, class Allocator = std::allocator<T>>
 	class OrderedSet
 	{
 		/// <summary>
@@ -35,24 +39,11 @@ namespace ssuds
 			}
 
 
-			/// Destructor
+			/// Destructor.  Children are not touched: the set frees nodes through its allocator, so it is
+			/// the set that destroys whole subtrees (see OrderedSet::delete_tree)
 			~node()
 			{
-				// Delete my children (note: i've come to realize [thanks, Zach Kerner!] that calling
-				/// delete on a null-pointer is allowed (it does nothing)
-				delete mLeft;
-				delete mRight;
-
-				// Nothing else to do!  Someone else has deleted me (which is how I got here)
-			}
-
-			/// <summary>
-			/// Clears the children pointers without deleting them (useful if we want to destroy just
-			/// a node)
-			/// </summary>
-			void clear_children()
-			{
-				mLeft = mRight = nullptr;
+				// empty, on purpose
 			}
 
 			/// <summary>
@@ -77,8 +68,9 @@ namespace ssuds
 			/// Removes the given element from this sub-tree, if it exists
 			/// </summary>
 			/// <param name="val">the value to remove</param>
+			/// <param name="owner">the set we belong to (which frees the removed node)</param>
 			/// <returns>the new value this node should be set to</returns>
-			node* erase_recursive(const T& val, bool& found)
+			node* erase_recursive(const T& val, bool& found, OrderedSet& owner)
 			{
 				// Do we contain the data to remove?
 				if (mData == val)
@@ -110,11 +102,10 @@ namespace ssuds
 																	// of that value in our set.
 
 						// This will remove the DUPLICATE value.
-						node* result = mRight->erase_recursive(mData, found);				
+						node* result = mRight->erase_recursive(mData, found, owner);
 						if (result != mRight)
 						{
-							mRight->clear_children();
-							delete mRight;
+							owner.delete_node(mRight);
 							mRight = result;
 						}
 
@@ -126,11 +117,10 @@ namespace ssuds
 				else if (mLeft && val < mData)
 				{
 					// Tell our left child to attempt to erase it
-					node* result = mLeft->erase_recursive(val, found);
+					node* result = mLeft->erase_recursive(val, found, owner);
 					if (result != mLeft && found)
 					{
-						mLeft->clear_children();
-						delete mLeft;
+						owner.delete_node(mLeft);
 						mLeft = result;
 					}
 					return this;
@@ -138,11 +128,10 @@ namespace ssuds
 				else if (mRight && val > mData)
 				{
 					// Tell our right child to attempt to erase it
-					node* result = mRight->erase_recursive(val, found);
+					node* result = mRight->erase_recursive(val, found, owner);
 					if (result != mRight && found)
 					{
-						mRight->clear_children();
-						delete mRight;
+						owner.delete_node(mRight);
 						mRight = result;
 					}
 					return this;
@@ -219,26 +208,27 @@ namespace ssuds
 			/// does nothing
 			/// </summary>
 			/// <param name="val">The new value to insert</param>
+			/// <param name="owner">the set we belong to (which makes the new node)</param>
 			/// <returns>the number of new nodes created (0 or 1)</returns>
-			int insert_recursive(const T& val)
+			int insert_recursive(const T& val, OrderedSet& owner)
 			{
 				if (val < mData)
 				{
 					if (mLeft)
-						return mLeft->insert_recursive(val);
+						return mLeft->insert_recursive(val, owner);
 					else
 					{
-						mLeft = new node(val);
+						mLeft = owner.new_node(val);
 						return 1;
 					}
 				}
 				else if (val > mData)
 				{
 					if (mRight)
-						return mRight->insert_recursive(val);
+						return mRight->insert_recursive(val, owner);
 					else
 					{
-						mRight = new node(val);
+						mRight = owner.new_node(val);
 						return 1;
 					}
 				}
@@ -255,7 +245,7 @@ namespace ssuds
 			/// </summary>
 			/// <param name="data">a reference parameter used to store all data</param>
 			/// <param name="tp">which type of traversal?</param>
-			void traversal_recursive(ssuds::ArrayList<T>& data, TraversalType tp)
+			void traversal_recursive(ssuds::ArrayList<T, Allocator>& data, TraversalType tp)
 			{
 				if (tp == TraversalType::PRE_ORDER)
 					data.append(mData);
@@ -276,11 +266,17 @@ namespace ssuds
 		/// </summary>
 		class OrderedSetIterator
 		{
+		public:
+			/// <summary>
+			/// Where the node stack's memory comes from (the set's allocator, rebound)
+			/// </summary>
+			typedef typename std::allocator_traits<Allocator>::template rebind_alloc<node*> stack_allocator_type;
+
 		protected:
 			/// <summary>
 			///  Used to keep track of which nodes we still have to explore
 			/// </summary>
-			ssuds::Stack<node*> mNodeStack;
+			ssuds::Stack<node*, stack_allocator_type> mNodeStack;
 
 			/// <summary>
 			/// Keeps track of which node we are currently on (or null if we are done)
@@ -301,7 +297,8 @@ namespace ssuds
 			///  Constructor
 			/// </summary>
 			/// <param name="root">the starting node (or null for end iterators)</param>
-			OrderedSetIterator(node* root)
+			/// <param name="alloc">the allocator for the node stack</param>
+			OrderedSetIterator(node* root, const stack_allocator_type& alloc = stack_allocator_type()) : mNodeStack(alloc)
 			{
 				mCurrentNode = root;
 				while (mCurrentNode)
@@ -370,20 +367,39 @@ namespace ssuds
 		/// </summary>
 		unsigned int mSize;
 
+		typedef typename std::allocator_traits<Allocator>::template rebind_alloc<node> node_allocator_type;
+		typedef std::allocator_traits<node_allocator_type> node_traits;
+
+		/// <summary>
+		/// Where our nodes come from
+		/// </summary>
+		node_allocator_type mNodeAllocator;
+
 	public:
 
 		/// Constructor
-		OrderedSet() : mRoot(nullptr), mSize(0)
+		OrderedSet() : mRoot(nullptr), mSize(0), mNodeAllocator()
 		{
 			// empty, on purpose
 		}
 
 
 		/// <summary>
-		/// Copy-constructor
+		/// Constructor for an empty set whose nodes come from alloc
+		/// </summary>
+		/// <param name="alloc">the allocator to use</param>
+		explicit OrderedSet(const Allocator& alloc) : mRoot(nullptr), mSize(0), mNodeAllocator(alloc)
+		{
+			// empty, on purpose
+		}
+
+
+		/// <summary>
+		/// Copy-constructor (the allocator is copied as the allocator says to -- a pmr set uses the default resource)
 		/// </summary>
 		/// <param name="other">the set we wish to copy</param>
-		OrderedSet(const OrderedSet& other) : mRoot(nullptr), mSize(0)
+		OrderedSet(const OrderedSet& other) : mRoot(nullptr), mSize(0),
+			mNodeAllocator(node_traits::select_on_container_copy_construction(other.mNodeAllocator))
 		{
 			for (T val : other)
 				insert(val);
@@ -394,7 +410,8 @@ namespace ssuds
 		/// The initializer-list constructor
 		/// </summary>
 		/// <param name="ilist">contains the initial data</param>
-		OrderedSet(const std::initializer_list<T>& ilist) : mRoot(nullptr), mSize(0)
+		/// <param name="alloc">the allocator to use</param>
+		OrderedSet(const std::initializer_list<T>& ilist, const Allocator& alloc = Allocator()) : mRoot(nullptr), mSize(0), mNodeAllocator(alloc)
 		{
 			for (T val : ilist)
 				insert(val);
@@ -405,7 +422,7 @@ namespace ssuds
 		/// The move-constructor
 		/// </summary>
 		/// <param name="other">the set we are stealing data from</param>
-		OrderedSet(OrderedSet&& other) : mRoot(other.mRoot), mSize(other.mSize)
+		OrderedSet(OrderedSet&& other) : mRoot(other.mRoot), mSize(other.mSize), mNodeAllocator(other.mNodeAllocator)
 		{
 			other.mRoot = nullptr;
 			other.mSize = 0;
@@ -430,14 +447,14 @@ namespace ssuds
 		/// <returns>a possibly modified ostream (not modified currently) </returns>
 		friend std::ostream& operator<<(std::ostream& os, const OrderedSet& the_set)
 		{
-			ssuds::ArrayList<T> result = the_set.traversal(TraversalType::IN_ORDER);
+			ssuds::ArrayList<T, Allocator> result = the_set.traversal(TraversalType::IN_ORDER);
 			os << result;
 			return os;
 		}
 
 
 		/// <summary>
-		/// Makes us a copy of the other set
+		/// Makes us a copy of the other set (we keep our own allocator)
 		/// </summary>
 		/// <param name="other">the set we wish to copy</param>
 		/// <returns>A reference to us</returns>
@@ -456,7 +473,7 @@ namespace ssuds
 		/// <returns>A valid iterator if the set is non-empty, or the end iterator if not</returns>
 		OrderedSetIterator begin() const
 		{
-			return OrderedSetIterator(mRoot);
+			return OrderedSetIterator(mRoot, typename OrderedSetIterator::stack_allocator_type(mNodeAllocator));
 		}
 
 
@@ -466,7 +483,7 @@ namespace ssuds
 		/// </summary>
 		void clear()
 		{
-			delete mRoot;
+			delete_tree(mRoot);
 			mRoot = nullptr;
 			mSize = 0;
 		}
@@ -486,13 +503,23 @@ namespace ssuds
 		}
 
 
+		/// <summary>
+		/// Returns a copy of the allocator our nodes come from
+		/// </summary>
+		/// <returns>the allocator</returns>
+		Allocator get_allocator() const
+		{
+			return Allocator(mNodeAllocator);
+		}
+
+
 		/// <summary>
 		/// Returns a special iterator which marks the end of iteration
 		/// </summary>
 		/// <returns>An end iterator</returns>
 		OrderedSetIterator end() const
 		{
-			return OrderedSetIterator(nullptr);
+			return OrderedSetIterator(nullptr, typename OrderedSetIterator::stack_allocator_type(mNodeAllocator));
 		}
 
 
@@ -508,11 +535,10 @@ namespace ssuds
 
 			if (mRoot)
 			{
-				node* new_root = mRoot->erase_recursive(val, result);
+				node* new_root = mRoot->erase_recursive(val, result, *this);
 				if (new_root != mRoot)
 				{
-					mRoot->clear_children();
-					delete mRoot;
+					delete_node(mRoot);
 					mRoot = new_root;
 				}
 			}
@@ -543,10 +569,10 @@ namespace ssuds
 		{
 			int num_added = 0;
 			if (mRoot)
-				num_added = mRoot->insert_recursive(val);
+				num_added = mRoot->insert_recursive(val, *this);
 			else
 			{
-				mRoot = new node(val);
+				mRoot = new_node(val);
 				num_added = 1;
 			}
 			mSize += num_added;
@@ -560,7 +586,7 @@ namespace ssuds
 		/// </summary>
 		void rebalance()
 		{
-			ssuds::ArrayList<T> data = traversal(TraversalType::IN_ORDER);
+			ssuds::ArrayList<T, Allocator> data = traversal(TraversalType::IN_ORDER);
 			clear();
 			if (data.size() > 0)
 				mRoot = rebalance_helper(data, 0, data.size() - 1);
@@ -568,6 +594,53 @@ namespace ssuds
 		}
 
 	protected:
+		/// <summary>
+		/// An internal method to make a new (childless) node holding val with our allocator
+		/// </summary>
+		/// <param name="val">the node's value</param>
+		/// <returns>the new node</returns>
+		node* new_node(const T& val)
+		{
+			node* result = node_traits::allocate(mNodeAllocator, 1);
+			try
+			{
+				node_traits::construct(mNodeAllocator, result, val);
+			}
+			catch (...)
+			{
+				node_traits::deallocate(mNodeAllocator, result, 1);
+				throw;
+			}
+			return result;
+		}
+
+
+		/// <summary>
+		/// An internal method to destroy just one node (not its children) and give it back to our allocator
+		/// </summary>
+		/// <param name="n">a node made by new_node</param>
+		void delete_node(node* n)
+		{
+			node_traits::destroy(mNodeAllocator, n);
+			node_traits::deallocate(mNodeAllocator, n, 1);
+		}
+
+
+		/// <summary>
+		/// An internal method to destroy a whole subtree (deleting a null-pointer does nothing)
+		/// </summary>
+		/// <param name="n">the root of the subtree</param>
+		void delete_tree(node* n)
+		{
+			if (n)
+			{
+				delete_tree(n->mLeft);
+				delete_tree(n->mRight);
+				delete_node(n);
+			}
+		}
+
+
 		/// <summary>
 		///  An internal method, structured something like binary search that is used to rebalance
 		/// this tree
@@ -576,12 +649,12 @@ namespace ssuds
 		/// <param name="left">the index of the starting value this new subtree should contain</param>
 		/// <param name="right">the index of the ending value this new subtree should contain</param>
 		/// <returns>an optimal root node that contains all the data in the given range.</returns>
-		node* rebalance_helper(ssuds::ArrayList<T>& data, int left, int right)
+		node* rebalance_helper(ssuds::ArrayList<T, Allocator>& data, int left, int right)
 		{
 			if (left <= right)
 			{
 				int mid = (left + right) / 2;
-				node* cur_root = new node(data[mid]);
+				node* cur_root = new_node(data[mid]);
 				cur_root->mLeft = rebalance_helper(data, left, mid - 1);
 				cur_root->mRight = rebalance_helper(data, mid + 1, right);
 				return cur_root;
@@ -605,10 +678,10 @@ namespace ssuds
 		/// Used to create an in-order, pre-order, or post-order copy of all the data in this tree
 		/// </summary>
 		/// <param name="tp">desired type of traversal</param>
-		/// <returns>a copy of all data</returns>
-		ssuds::ArrayList<T> traversal(TraversalType tp) const
+		/// <returns>a copy of all data (using our allocator)</returns>
+		ssuds::ArrayList<T, Allocator> traversal(TraversalType tp) const
 		{
-			ssuds::ArrayList<T> results;
+			ssuds::ArrayList<T, Allocator> results(get_allocator());
 			if (mRoot)
 				mRoot->traversal_recursive(results, tp);
 			return results;
@@ -640,10 +713,12 @@ namespace ssuds
 	/// <param name="A">set1</param>
 	/// <param name="B">set2</param>
 	/// <returns>The resulting union</returns>
-	template <class T>
-	OrderedSet<T> operator|(const OrderedSet<T>& A, const OrderedSet<T>& B)
+	template <class T, class Allocator>
+	OrderedSet<T, Allocator> operator|(const OrderedSet<T, Allocator>& A, const OrderedSet<T, Allocator>& B)
 	{
-		OrderedSet<T> result = A;
+		OrderedSet<T, Allocator> result(A.get_allocator());
+		for (T item : A)
+			result.insert(item);
 		for (T item : B)
 			result.insert(item);
 		return result;
@@ -657,10 +732,10 @@ namespace ssuds
 	/// <param name="A">set1</param>
 	/// <param name="B">set2</param>
 	/// <returns>The resulting intersection</returns>
-	template <class T>
-	OrderedSet<T> operator&(const OrderedSet<T>& A, const OrderedSet<T>& B)
+	template <class T, class Allocator>
+	OrderedSet<T, Allocator> operator&(const OrderedSet<T, Allocator>& A, const OrderedSet<T, Allocator>& B)
 	{
-		OrderedSet<T> result;
+		OrderedSet<T, Allocator> result(A.get_allocator());
 		for (T item : B)
 		{
 			if (A.contains(item))
@@ -677,10 +752,10 @@ namespace ssuds
 	/// <param name="A">set1</param>
 	/// <param name="B">set2</param>
 	/// <returns>The resulting difference</returns>
-	template <class T>
-	OrderedSet<T> operator-(const OrderedSet<T>& A, const OrderedSet<T>& B)
+	template <class T, class Allocator>
+	OrderedSet<T, Allocator> operator-(const OrderedSet<T, Allocator>& A, const OrderedSet<T, Allocator>& B)
 	{
-		OrderedSet<T> result;
+		OrderedSet<T, Allocator> result(A.get_allocator());
 		for (T item : A)
 		{
 			if (!B.contains(item))
@@ -688,4 +763,12 @@ namespace ssuds
 		}
 		return result;
 	}
+
+
+	namespace pmr
+	{
+		/// An OrderedSet whose nodes come from a std::pmr::memory_resource (e.g. an ssuds::FixedPool)
+		template <class T>
+		using OrderedSet = ssuds::OrderedSet<T, std::pmr::polymorphic_allocator<T>>;
+	}
 }
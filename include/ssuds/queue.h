@@ -7,13 +7,41 @@ namespace ssuds
 	/// This Queue classes uses LinkedList in a "has-a" relationship to implement a FIFO structure (First-in-first-out)
 	/// </summary>
 	/// <typeparam name="T">The type of all elements in the queue</typeparam>
-	template <class T>
+	/// <typeparam name="Allocator">Where the memory comes from (passed on to the LinkedList)</typeparam>
+	template <class T, class Allocator = std::allocator<T>>
 	class Queue
 	{
 	protected:
-		LinkedList<T> mInternalList;
+		LinkedList<T, Allocator> mInternalList;
 
 	public:
+		/// <summary>
+		/// Default constructor
+		/// </summary>
+		Queue()
+		{
+			// intentionally empty
+		}
+
+
+		/// <summary>
+		/// Constructor for an empty queue whose memory comes from alloc
+		/// </summary>
+		explicit Queue(const Allocator& alloc) : mInternalList(alloc)
+		{
+			// intentionally empty
+		}
+
+
+		/// <summary>
+		/// Returns a copy of the allocator the queue's memory comes from
+		/// </summary>
+		Allocator get_allocator() const
+		{
+			return mInternalList.get_allocator();
+		}
+
+
 		/// <summary>
 		/// Shallow wrapper around the underlying linked list clear method
 		/// </summary>
@@ -43,7 +71,7 @@ namespace ssuds
 			// See https://pages.cs.wisc.edu/~driscoll/typename.html for a discussion of why the "typename" keyword is necessary here.  If you
 			// don't include it, you get an error like this (in Visual Studio 2022):
 			// error C3878: syntax error: unexpected token 'identifier' following 'expression'
-			typename LinkedList<T>::LinkedListIterator it = mInternalList.begin();
+			typename LinkedList<T, Allocator>::LinkedListIterator it = mInternalList.begin();
 			T return_val = *it;
 			mInternalList.remove(it);
 			return return_val;
@@ -89,7 +117,7 @@ namespace ssuds
 		/// A shallow wrapper around LinkedList's begin method
 		/// </summary>
 		/// <returns>A LinkedListIterator capable of walking through all values in this queue</returns>
-		typename LinkedList<T>::LinkedListIterator begin()
+		typename LinkedList<T, Allocator>::LinkedListIterator begin()
 		{
 			return mInternalList.begin();
 		}
@@ -98,7 +126,7 @@ namespace ssuds
 		/// A shallow wrapper around LinkedList's end method
 		/// </summary>
 		/// <returns>A LinkedListIterator end value</returns>
-		typename LinkedList<T>::LinkedListIterator end()
+		typename LinkedList<T, Allocator>::LinkedListIterator end()
 		{
 			return mInternalList.end();
 		}
@@ -113,4 +141,11 @@ namespace ssuds
 			return mInternalList.size();
 		}
 	};
+
+	namespace pmr
+	{
+		/// A Queue whose memory comes from a std::pmr::memory_resource
+		template <class T>
+		using Queue = ssuds::Queue<T, std::pmr::polymorphic_allocator<T>>;
+	}
 }
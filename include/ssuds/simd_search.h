@@ -0,0 +1,511 @@
+#pragma once
+#include <type_traits>
+#include <control_group.h>
+
+#if defined(SSUDS_HAVE_SSE2) && !defined(SSUDS_HAVE_AVX2) && (defined(__SSE4_1__) || defined(__AVX__))
+#include <smmintrin.h>
+#endif
+
+// Linear searches of an array for a value (used by ArrayList's find, find_last and count).  For arithmetic types
+// of 1, 2, 4 or 8 bytes, a whole vector register of items (32 bytes with AVX2, else 16 with SSE2) is compared with
+// the value at once.  A build with AVX2 enabled (/arch:AVX2 or -mavx2, see control_group.h) always uses the AVX2
+// versions.  Otherwise (with MSVC, GCC or Clang) the AVX2 versions are still compiled in, and each search asks the
+// CPU (once, with cpuid) whether it can run them, falling back to SSE2 if not.  Define SSUDS_AVX2_DISPATCH as 0 to
+// leave them out and always use SSE2.  Everything else (or SSUDS_DISABLE_SIMD) compares one item at a time with ==.
+#ifndef SSUDS_AVX2_DISPATCH
+#define SSUDS_AVX2_DISPATCH 1
+#endif
+
+#if defined(SSUDS_HAVE_SSE2) && (defined(SSUDS_HAVE_AVX2) || (SSUDS_AVX2_DISPATCH && (defined(_MSC_VER) || defined(__GNUC__))))
+#define SSUDS_HAVE_AVX2_SEARCH 1
+#include <immintrin.h>
+// GCC and Clang only allow AVX2 intrinsics in functions compiled for AVX2; MSVC allows them anywhere
+#if defined(__GNUC__) || defined(__clang__)
+#define SSUDS_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define SSUDS_TARGET_AVX2
+#endif
+#endif
+
+namespace ssuds
+{
+	/// <summary>
+	/// True if T can be searched a vector at a time: an arithmetic type whose == is the same as comparing its
+	/// bytes (or, for float and double, the same as the CPU's compare, which also says NaN != NaN and -0.0 == 0.0)
+	/// </summary>
+	template <class T>
+	struct _is_vector_searchable
+	{
+#if defined(SSUDS_HAVE_SSE2)
+		static const bool value = (std::is_integral<T>::value || std::is_same<T, float>::value || std::is_same<T, double>::value) &&
+			(sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8);
+#else
+		static const bool value = false;
+#endif
+	};
+
+
+#if defined(SSUDS_HAVE_SSE2)
+	/// <summary>
+	/// Compares an SSE2 register's worth (msLanes) of T's with one value.  Each match method returns a bit mask
+	/// with one bit per BYTE of the register, so an item that matches sets sizeof(T) bits (item i's are bits
+	/// i * sizeof(T) and up)
+	/// </summary>
+	template <class T>
+	class VectorCompare
+	{
+	public:
+		typedef __m128i vector_type;
+		static const unsigned int msBytes = 16;
+
+		/// How many items one register holds
+		static const unsigned int msLanes = msBytes / sizeof(T);
+
+		/// <summary>
+		/// Constructor
+		/// </summary>
+		/// <param name="val">the value to look for</param>
+		explicit VectorCompare(const T& val)
+		{
+			T copies[msLanes];
+			for (unsigned int i = 0; i < msLanes; i++)
+				copies[i] = val;
+			mValue = load(copies);
+		}
+
+		/// <summary>
+		/// Compares the msLanes items starting at p (which don't have to be aligned) with the value: each lane of the
+		/// result is all 1's where they match and all 0's where they don't
+		/// </summary>
+		vector_type equal(const T* p) const
+		{
+			return equal_lanes(load(p), mValue);
+		}
+
+		/// <summary>
+		/// Turns the result of equal (or several of them or'ed together) into a bit mask
+		/// </summary>
+		static unsigned int mask(vector_type lanes)
+		{
+			return (unsigned int)_mm_movemask_epi8(lanes);
+		}
+
+		/// Ors two results of equal together
+		static vector_type either(vector_type a, vector_type b)
+		{
+			return _mm_or_si128(a, b);
+		}
+
+		/// Returns a register of all 0's (a new set of counts for add_matches)
+		static vector_type zero()
+		{
+			return _mm_setzero_si128();
+		}
+
+		/// <summary>
+		/// Adds 1 to each byte of counts where lanes (a result of equal) is set.  A byte wraps around after 255, so
+		/// counts has to be added up with total at least that often
+		/// </summary>
+		static vector_type add_matches(vector_type counts, vector_type lanes)
+		{
+			// A set byte is 0xFF, i.e. -1
+			return _mm_sub_epi8(counts, lanes);
+		}
+
+		/// <summary>
+		/// Returns the sum of the bytes of counts (see add_matches)
+		/// </summary>
+		static unsigned int total(vector_type counts)
+		{
+			// sad_epu8 against 0 sums each group of 8 bytes into a 64-bit lane
+			__m128i halves = _mm_sad_epu8(counts, _mm_setzero_si128());
+			return (unsigned int)(_mm_cvtsi128_si32(halves) + _mm_cvtsi128_si32(_mm_srli_si128(halves, 8)));
+		}
+
+		/// <summary>
+		/// Finds the items among the msLanes starting at p that match the value
+		/// </summary>
+		/// <returns>a bit mask with sizeof(T) bits set for each match</returns>
+		unsigned int match(const T* p) const
+		{
+			return mask(equal(p));
+		}
+
+	protected:
+		/// The value, in every lane
+		vector_type mValue;
+
+		static vector_type load(const T* p)
+		{
+			return _mm_loadu_si128((const __m128i*)p);
+		}
+
+		static vector_type equal_lanes(vector_type a, vector_type b)
+		{
+			if constexpr (std::is_same<T, float>::value)
+				return _mm_castps_si128(_mm_cmpeq_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(b)));
+			else if constexpr (std::is_same<T, double>::value)
+				return _mm_castpd_si128(_mm_cmpeq_pd(_mm_castsi128_pd(a), _mm_castsi128_pd(b)));
+			else if constexpr (sizeof(T) == 1)
+				return _mm_cmpeq_epi8(a, b);
+			else if constexpr (sizeof(T) == 2)
+				return _mm_cmpeq_epi16(a, b);
+			else if constexpr (sizeof(T) == 4)
+				return _mm_cmpeq_epi32(a, b);
+			else
+			{
+#if defined(__SSE4_1__) || defined(__AVX__)
+				return _mm_cmpeq_epi64(a, b);
+#else
+				// Both 32-bit halves of a 64-bit lane have to match
+				__m128i halves = _mm_cmpeq_epi32(a, b);
+				return _mm_and_si128(halves, _mm_shuffle_epi32(halves, _MM_SHUFFLE(2, 3, 0, 1)));
+#endif
+			}
+		}
+	};
+#endif
+
+
+#if defined(SSUDS_HAVE_AVX2_SEARCH)
+	/// <summary>
+	/// True if the CPU we're running on (and its OS, which has to save the wider registers) can run AVX2
+	/// instructions.  Found out the first time it's asked
+	/// </summary>
+	inline bool cpu_has_avx2()
+	{
+#if defined(_MSC_VER)
+		static const bool result = []() {
+			int info[4];
+			__cpuid(info, 0);
+			if (info[0] < 7)
+				return false;
+			// OSXSAVE and AVX, and the OS saves the XMM and YMM registers
+			__cpuid(info, 1);
+			if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0 || (_xgetbv(0) & 6) != 6)
+				return false;
+			__cpuidex(info, 7, 0);
+			return (info[1] & (1 << 5)) != 0;
+		}();
+#else
+		static const bool result = (__builtin_cpu_init(), __builtin_cpu_supports("avx2") != 0);
+#endif
+		return result;
+	}
+
+
+	/// <summary>
+	/// The AVX2 version of VectorCompare (32-byte registers).  Everything here is compiled for AVX2, so must only be
+	/// used once cpu_has_avx2 says so (or in a build with AVX2 on)
+	/// </summary>
+	template <class T>
+	class VectorCompare256
+	{
+	public:
+		typedef __m256i vector_type;
+		static const unsigned int msBytes = 32;
+
+		/// How many items one register holds
+		static const unsigned int msLanes = msBytes / sizeof(T);
+
+		SSUDS_TARGET_AVX2 explicit VectorCompare256(const T& val)
+		{
+			T copies[msLanes];
+			for (unsigned int i = 0; i < msLanes; i++)
+				copies[i] = val;
+			mValue = load(copies);
+		}
+
+		SSUDS_TARGET_AVX2 vector_type equal(const T* p) const
+		{
+			__m256i a = load(p);
+			if constexpr (std::is_same<T, float>::value)
+				return _mm256_castps_si256(_mm256_cmp_ps(_mm256_castsi256_ps(a), _mm256_castsi256_ps(mValue), _CMP_EQ_OQ));
+			else if constexpr (std::is_same<T, double>::value)
+				return _mm256_castpd_si256(_mm256_cmp_pd(_mm256_castsi256_pd(a), _mm256_castsi256_pd(mValue), _CMP_EQ_OQ));
+			else if constexpr (sizeof(T) == 1)
+				return _mm256_cmpeq_epi8(a, mValue);
+			else if constexpr (sizeof(T) == 2)
+				return _mm256_cmpeq_epi16(a, mValue);
+			else if constexpr (sizeof(T) == 4)
+				return _mm256_cmpeq_epi32(a, mValue);
+			else
+				return _mm256_cmpeq_epi64(a, mValue);
+		}
+
+		SSUDS_TARGET_AVX2 static unsigned int mask(vector_type lanes)
+		{
+			return (unsigned int)_mm256_movemask_epi8(lanes);
+		}
+
+		SSUDS_TARGET_AVX2 static vector_type either(vector_type a, vector_type b)
+		{
+			return _mm256_or_si256(a, b);
+		}
+
+		SSUDS_TARGET_AVX2 static vector_type zero()
+		{
+			return _mm256_setzero_si256();
+		}
+
+		SSUDS_TARGET_AVX2 static vector_type add_matches(vector_type counts, vector_type lanes)
+		{
+			return _mm256_sub_epi8(counts, lanes);
+		}
+
+		SSUDS_TARGET_AVX2 static unsigned int total(vector_type counts)
+		{
+			__m256i sums = _mm256_sad_epu8(counts, _mm256_setzero_si256());
+			__m128i halves = _mm_add_epi64(_mm256_castsi256_si128(sums), _mm256_extracti128_si256(sums, 1));
+			return (unsigned int)(_mm_cvtsi128_si32(halves) + _mm_cvtsi128_si32(_mm_srli_si128(halves, 8)));
+		}
+
+		SSUDS_TARGET_AVX2 unsigned int match(const T* p) const
+		{
+			return mask(equal(p));
+		}
+
+	protected:
+		/// The value, in every lane
+		vector_type mValue;
+
+		SSUDS_TARGET_AVX2 static vector_type load(const T* p)
+		{
+			return _mm256_loadu_si256((const __m256i*)p);
+		}
+	};
+
+
+	/// search_first (see below) with AVX2 (T must be _is_vector_searchable)
+	template <class T>
+	SSUDS_TARGET_AVX2 unsigned int _search_first_avx2(const T* items, unsigned int n, const T& val)
+	{
+		typedef VectorCompare256<T> compare_type;
+		const unsigned int lanes = compare_type::msLanes;
+		compare_type compare(val);
+		unsigned int i = 0;
+		for (; n - i >= 4 * lanes; i += 4 * lanes)
+		{
+			__m256i equal[4];
+			for (unsigned int j = 0; j < 4; j++)
+				equal[j] = compare.equal(items + i + j * lanes);
+			if (compare_type::mask(compare_type::either(compare_type::either(equal[0], equal[1]), compare_type::either(equal[2], equal[3]))) != 0)
+			{
+				for (unsigned int j = 0; ; j++)
+				{
+					unsigned int found = compare_type::mask(equal[j]);
+					if (found != 0)
+						return i + j * lanes + count_trailing_zeros(found) / sizeof(T);
+				}
+			}
+		}
+		for (; n - i >= lanes; i += lanes)
+		{
+			unsigned int found = compare.match(items + i);
+			if (found != 0)
+				return i + count_trailing_zeros(found) / sizeof(T);
+		}
+		for (; i < n; i++)
+		{
+			if (items[i] == val)
+				return i;
+		}
+		return n;
+	}
+
+
+	/// search_last (see below) with AVX2 (T must be _is_vector_searchable)
+	template <class T>
+	SSUDS_TARGET_AVX2 unsigned int _search_last_avx2(const T* items, unsigned int n, const T& val)
+	{
+		typedef VectorCompare256<T> compare_type;
+		const unsigned int lanes = compare_type::msLanes;
+		compare_type compare(val);
+		unsigned int i = n;
+		for (unsigned int whole = n - n % lanes; i > whole; i--)
+		{
+			if (items[i - 1] == val)
+				return i - 1;
+		}
+		for (; i > 0; i -= lanes)
+		{
+			unsigned int found = compare.match(items + i - lanes);
+			if (found != 0)
+				return i - lanes + highest_set_bit(found) / sizeof(T);
+		}
+		return n;
+	}
+
+
+	/// search_count (see below) with AVX2 (T must be _is_vector_searchable)
+	template <class T>
+	SSUDS_TARGET_AVX2 unsigned int _search_count_avx2(const T* items, unsigned int n, const T& val)
+	{
+		typedef VectorCompare256<T> compare_type;
+		const unsigned int lanes = compare_type::msLanes;
+		compare_type compare(val);
+		unsigned int i = 0;
+		unsigned long long matched_bytes = 0;
+		while (n - i >= lanes)
+		{
+			__m256i counts = compare_type::zero();
+			for (unsigned int block = 0; block < 255 && n - i >= lanes; block++, i += lanes)
+				counts = compare_type::add_matches(counts, compare.equal(items + i));
+			matched_bytes += compare_type::total(counts);
+		}
+		unsigned int result = (unsigned int)(matched_bytes / sizeof(T));
+		for (; i < n; i++)
+		{
+			if (items[i] == val)
+				result++;
+		}
+		return result;
+	}
+
+
+	/// True if the searches should use their AVX2 versions
+	inline bool _use_avx2_search()
+	{
+#if defined(SSUDS_HAVE_AVX2)
+		return true;
+#else
+		return cpu_has_avx2();
+#endif
+	}
+#endif
+
+
+	/// <summary>
+	/// Returns the index of the first of the n items that == val, or n if there isn't one
+	/// </summary>
+	template <class T>
+	unsigned int search_first(const T* items, unsigned int n, const T& val)
+	{
+		unsigned int i = 0;
+#if defined(SSUDS_HAVE_SSE2)
+		if constexpr (_is_vector_searchable<T>::value)
+		{
+#if defined(SSUDS_HAVE_AVX2_SEARCH)
+			if (_use_avx2_search())
+				return _search_first_avx2(items, n, val);
+#endif
+			typedef VectorCompare<T> compare_type;
+			const unsigned int lanes = compare_type::msLanes;
+			compare_type compare(val);
+
+			// Four registers at a time (with one test for all of them) while there's room, then one at a time
+			for (; n - i >= 4 * lanes; i += 4 * lanes)
+			{
+				typename compare_type::vector_type equal[4];
+				for (unsigned int j = 0; j < 4; j++)
+					equal[j] = compare.equal(items + i + j * lanes);
+				if (compare_type::mask(compare_type::either(compare_type::either(equal[0], equal[1]), compare_type::either(equal[2], equal[3]))) != 0)
+				{
+					for (unsigned int j = 0; ; j++)
+					{
+						unsigned int found = compare_type::mask(equal[j]);
+						if (found != 0)
+							return i + j * lanes + count_trailing_zeros(found) / sizeof(T);
+					}
+				}
+			}
+			for (; n - i >= lanes; i += lanes)
+			{
+				unsigned int found = compare.match(items + i);
+				if (found != 0)
+					return i + count_trailing_zeros(found) / sizeof(T);
+			}
+		}
+#endif
+		for (; i < n; i++)
+		{
+			if (items[i] == val)
+				return i;
+		}
+		return n;
+	}
+
+
+	/// <summary>
+	/// Returns the index of the last of the n items that == val, or n if there isn't one
+	/// </summary>
+	template <class T>
+	unsigned int search_last(const T* items, unsigned int n, const T& val)
+	{
+		unsigned int i = n;
+#if defined(SSUDS_HAVE_SSE2)
+		if constexpr (_is_vector_searchable<T>::value)
+		{
+#if defined(SSUDS_HAVE_AVX2_SEARCH)
+			if (_use_avx2_search())
+				return _search_last_avx2(items, n, val);
+#endif
+			typedef VectorCompare<T> compare_type;
+			const unsigned int lanes = compare_type::msLanes;
+			compare_type compare(val);
+
+			// The items past the last whole register (counting from the start) one at a time, then a register at
+			// a time back to the start
+			for (unsigned int whole = n - n % lanes; i > whole; i--)
+			{
+				if (items[i - 1] == val)
+					return i - 1;
+			}
+			for (; i > 0; i -= lanes)
+			{
+				unsigned int found = compare.match(items + i - lanes);
+				if (found != 0)
+					return i - lanes + highest_set_bit(found) / sizeof(T);
+			}
+			return n;
+		}
+#endif
+		for (; i > 0; i--)
+		{
+			if (items[i - 1] == val)
+				return i - 1;
+		}
+		return n;
+	}
+
+
+	/// <summary>
+	/// Returns how many of the n items == val
+	/// </summary>
+	template <class T>
+	unsigned int search_count(const T* items, unsigned int n, const T& val)
+	{
+		unsigned int i = 0;
+		unsigned int result = 0;
+#if defined(SSUDS_HAVE_SSE2)
+		if constexpr (_is_vector_searchable<T>::value)
+		{
+#if defined(SSUDS_HAVE_AVX2_SEARCH)
+			if (_use_avx2_search())
+				return _search_count_avx2(items, n, val);
+#endif
+			typedef VectorCompare<T> compare_type;
+			const unsigned int lanes = compare_type::msLanes;
+			compare_type compare(val);
+
+			// Matches are counted per byte (each one counts in sizeof(T) bytes), in blocks of 255 registers so no
+			// byte's count wraps around
+			unsigned long long matched_bytes = 0;
+			while (n - i >= lanes)
+			{
+				typename compare_type::vector_type counts = compare_type::zero();
+				for (unsigned int block = 0; block < 255 && n - i >= lanes; block++, i += lanes)
+					counts = compare_type::add_matches(counts, compare.equal(items + i));
+				matched_bytes += compare_type::total(counts);
+			}
+			result = (unsigned int)(matched_bytes / sizeof(T));
+		}
+#endif
+		for (; i < n; i++)
+		{
+			if (items[i] == val)
+				result++;
+		}
+		return result;
+	}
+}
@@ -0,0 +1,405 @@
+#pragma once
+#include <cstring>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <control_group.h>
+#include <hash.h>
+#include <unordered_map.h>
+
+namespace ssuds
+{
+	/// <summary>
+	/// A map that keeps up to N items inside the object itself, only "spilling" into an UnorderedMap (with its heap
+	/// allocated table) when an (N+1)th item is added.  So a map that stays small never allocates at all.  While
+	/// small, the items are packed at the start of an inline array, with a parallel array of control bytes holding
+	/// each item's 7-bit hash fragment (see ControlGroup), and a lookup is one ControlGroup match over all of them at
+	/// once -- a key is only compared with items whose fragment matches.  The inline array and the UnorderedMap share
+	/// the same bytes (only one is ever in use), and once spilled the map stays an UnorderedMap.
+	/// There is no iterator (the items are in one of two places): use for_each.
+	/// </summary>
+	/// <typeparam name="K">The key type</typeparam>
+	/// <typeparam name="V">The value type</typeparam>
+	/// <typeparam name="N">How many items can be kept inline (at most ControlGroup::msWidth)</typeparam>
+	/// <typeparam name="Hash">The hash function (see UnorderedMap)</typeparam>
+	/// <typeparam name="Probing">The probing policy of the map once spilled (see UnorderedMap)</typeparam>
+	/// <typeparam name="HashStorage">The hash-storage policy of the map once spilled (see UnorderedMap)</typeparam>
+	/// <typeparam name="Allocator">Where the map's table comes from once spilled (see UnorderedMap)</typeparam>
+	template <class K, class V, unsigned int N = 8, class Hash = FastHash<K>, class Probing = LinearProbing, class HashStorage = NoStoredHash,
+		class Allocator = std::allocator<std::pair<K, V>>>
+	class SmallUnorderedMap
+	{
+		static_assert(N > 0 && N <= ControlGroup::msWidth, "A SmallUnorderedMap keeps 1 to ControlGroup::msWidth items inline");
+
+	public:
+		/// The type of map the items spill into
+		typedef UnorderedMap<K, V, Hash, Probing, HashStorage, Allocator> table_type;
+
+	protected:
+		union
+		{
+			/// While small: the items (only the first mSmallSize are constructed)
+			alignas(std::pair<K, V>) unsigned char mInline[N * sizeof(std::pair<K, V>)];
+
+			/// Once spilled: everything
+			table_type mLarge;
+		};
+
+		/// While small: each item's fragment (the rest are ControlGroup::msEmpty, which never matches a fragment)
+		unsigned char mControl[ControlGroup::msWidth];
+
+		/// While small: how many items there are
+		unsigned int mSmallSize;
+
+		bool mIsLarge;
+		Hash mHashGenerator;
+
+		/// What a spill gets its table from.  (A table moved in from another map keeps the allocator it came from)
+		Allocator mAllocator;
+
+		// see UnorderedMap::msFibonacciMultiplier (the fragment has to come from the same bits UnorderedMap uses)
+		static const unsigned long long msFibonacciMultiplier = 11400714819323198485ull;
+
+		/// The lookup methods below accept K or anything UnorderedMap's find accepts (see _is_transparent_key)
+		template <class Q>
+		using enable_if_lookup_key = typename std::enable_if<std::is_same<Q, K>::value || _is_transparent_key<Hash, K, Q>::value, int>::type;
+
+		/// The inline item at index i
+		std::pair<K, V>* item(unsigned int i)
+		{
+			return (std::pair<K, V>*)mInline + i;
+		}
+
+		const std::pair<K, V>* item(unsigned int i) const
+		{
+			return (const std::pair<K, V>*)mInline + i;
+		}
+
+		/// The fragment of key's hash code (as UnorderedMap would store it)
+		template <class Q>
+		unsigned char fragment(const Q& key) const
+		{
+			return ControlGroup::fragment((unsigned long long)mHashGenerator(key) * msFibonacciMultiplier);
+		}
+
+		/// While small: returns the index of the item with key (or N if there isn't one)
+		template <class Q>
+		unsigned int small_find(const Q& key, unsigned char frag) const
+		{
+			unsigned int candidates = ControlGroup(mControl).match(frag);
+			while (candidates != 0)
+			{
+				unsigned int i = count_trailing_zeros(candidates);
+				if (item(i)->first == key)
+					return i;
+				candidates &= candidates - 1;
+			}
+			return N;
+		}
+
+		/// Moves the inline items into a new UnorderedMap, which takes over the inline bytes
+		void spill()
+		{
+			table_type large(2 * N + 1, mHashGenerator, mAllocator);
+			for (unsigned int i = 0; i < mSmallSize; i++)
+				large.try_emplace(std::move(item(i)->first), std::move(item(i)->second));
+			destroy_small();
+			::new ((void*)&mLarge) table_type(std::move(large));
+			mIsLarge = true;
+		}
+
+		/// <summary>
+		/// Looks up key and, if it isn't there, adds it with a value constructed from args (spilling first if the
+		/// inline array is full).  Returns the key's value and true if it was added
+		/// </summary>
+		template <class... Args>
+		std::pair<V*, bool> emplace_key(const K& key, Args&&... args)
+		{
+			if (!mIsLarge)
+			{
+				unsigned char frag = fragment(key);
+				unsigned int i = small_find(key, frag);
+				if (i < N)
+					return std::pair<V*, bool>(&item(i)->second, false);
+				if (mSmallSize < N)
+				{
+					::new ((void*)item(mSmallSize)) std::pair<K, V>(std::piecewise_construct, std::forward_as_tuple(key),
+						std::forward_as_tuple(std::forward<Args>(args)...));
+					mControl[mSmallSize] = frag;
+					return std::pair<V*, bool>(&item(mSmallSize++)->second, true);
+				}
+				spill();
+			}
+			std::pair<typename table_type::unorderMapIterator, bool> result = mLarge.try_emplace(key, std::forward<Args>(args)...);
+			return std::pair<V*, bool>(&result.first->second, result.second);
+		}
+
+		/// Destroys the inline items (leaving the map small and empty)
+		void destroy_small()
+		{
+			for (unsigned int i = 0; i < mSmallSize; i++)
+				item(i)->~pair();
+			mSmallSize = 0;
+			std::memset(mControl, ControlGroup::msEmpty, sizeof(mControl));
+		}
+
+		/// Destroys everything (the inline items or the UnorderedMap), leaving the map small and empty
+		void destroy_all()
+		{
+			if (mIsLarge)
+			{
+				mLarge.~table_type();
+				mIsLarge = false;
+				std::memset(mControl, ControlGroup::msEmpty, sizeof(mControl));
+			}
+			else
+				destroy_small();
+		}
+
+		/// Moves other's contents into this (small, empty) map, leaving other small and empty
+		void take(SmallUnorderedMap& other)
+		{
+			mHashGenerator = other.mHashGenerator;
+			if (other.mIsLarge)
+			{
+				::new ((void*)&mLarge) table_type(std::move(other.mLarge));
+				mIsLarge = true;
+			}
+			else
+			{
+				for (unsigned int i = 0; i < other.mSmallSize; i++)
+					::new ((void*)item(i)) std::pair<K, V>(std::move(*other.item(i)));
+				mSmallSize = other.mSmallSize;
+				std::memcpy(mControl, other.mControl, sizeof(mControl));
+			}
+			other.destroy_all();
+		}
+
+	public:
+		/// <summary>
+		/// Constructor.  Nothing is allocated until there are more than N items
+		/// </summary>
+		/// <param name="hash_function">the Hash object to use (only needed if Hash has some state)</param>
+		/// <param name="alloc">the allocator for the table, if the map spills</param>
+		SmallUnorderedMap(const Hash& hash_function = Hash(), const Allocator& alloc = Allocator()) : mSmallSize(0), mIsLarge(false),
+			mHashGenerator(hash_function), mAllocator(alloc)
+		{
+			std::memset(mControl, ControlGroup::msEmpty, sizeof(mControl));
+		}
+
+		/// Makes an empty map whose table (if it spills) comes from alloc (for a pmr map this can be given a
+		/// std::pmr::memory_resource*)
+		explicit SmallUnorderedMap(const Allocator& alloc) : SmallUnorderedMap(Hash(), alloc)
+		{
+			// intentionally empty
+		}
+
+		/// Copy constructor.  The allocator is copied as the allocator says to (see UnorderedMap)
+		SmallUnorderedMap(const SmallUnorderedMap& other) : SmallUnorderedMap(other,
+			std::allocator_traits<Allocator>::select_on_container_copy_construction(other.mAllocator))
+		{
+			// intentionally empty
+		}
+
+		/// Copy constructor that gives the copy a different allocator
+		SmallUnorderedMap(const SmallUnorderedMap& other, const Allocator& alloc) : SmallUnorderedMap(other.mHashGenerator, alloc)
+		{
+			if (other.mIsLarge)
+			{
+				::new ((void*)&mLarge) table_type(other.mLarge, mAllocator);
+				mIsLarge = true;
+				return;
+			}
+			for (; mSmallSize < other.mSmallSize; mSmallSize++)
+			{
+				try
+				{
+					::new ((void*)item(mSmallSize)) std::pair<K, V>(*other.item(mSmallSize));
+				}
+				catch (...)
+				{
+					destroy_small();
+					throw;
+				}
+			}
+			std::memcpy(mControl, other.mControl, sizeof(mControl));
+		}
+
+		/// Move constructor: other is left empty
+		SmallUnorderedMap(SmallUnorderedMap&& other) : SmallUnorderedMap(other.mHashGenerator, other.mAllocator)
+		{
+			take(other);
+		}
+
+		/// Destructor
+		~SmallUnorderedMap()
+		{
+			destroy_all();
+		}
+
+		/// Replaces this map with a copy of other, made with this map's allocator (the copy is made first, so if it
+		/// throws this map is unchanged)
+		SmallUnorderedMap& operator=(const SmallUnorderedMap& other)
+		{
+			if (&other != this)
+			{
+				SmallUnorderedMap temp(other, mAllocator);
+				destroy_all();
+				take(temp);
+			}
+			return *this;
+		}
+
+		/// Replaces this map with other's contents, leaving other empty
+		SmallUnorderedMap& operator=(SmallUnorderedMap&& other)
+		{
+			if (&other != this)
+			{
+				destroy_all();
+				take(other);
+			}
+			return *this;
+		}
+
+		/// <summary>
+		/// Returns a pointer to the value for key, or nullptr if it isn't in the map.  The pointer is good until
+		/// the map is next changed
+		/// </summary>
+		template <class Q, enable_if_lookup_key<Q> = 0>
+		V* find(const Q& key)
+		{
+			if (mIsLarge)
+			{
+				typename table_type::unorderMapIterator it = mLarge.find(key);
+				return it != mLarge.end() ? &it->second : nullptr;
+			}
+			unsigned int i = small_find(key, fragment(key));
+			return i < N ? &item(i)->second : nullptr;
+		}
+
+		V* find(const K& key)
+		{
+			return find<K>(key);
+		}
+
+		/// <summary>
+		/// Returns true if key is in the map
+		/// </summary>
+		template <class Q, enable_if_lookup_key<Q> = 0>
+		bool contains(const Q& key)
+		{
+			return find(key) != nullptr;
+		}
+
+		/// <summary>
+		/// Returns the value for key, adding it (with a value-initialized value) if it isn't in the map
+		/// </summary>
+		V& operator[](const K& key)
+		{
+			return *emplace_key(key).first;
+		}
+
+		/// <summary>
+		/// Adds key with a value constructed from args, if key isn't already in the map
+		/// </summary>
+		/// <returns>true if the key was added</returns>
+		template <class... Args>
+		bool try_emplace(const K& key, Args&&... args)
+		{
+			return emplace_key(key, std::forward<Args>(args)...).second;
+		}
+
+		/// <summary>
+		/// Sets the value for key, adding the key if it isn't already in the map
+		/// </summary>
+		/// <returns>true if the key was added, false if an existing value was replaced</returns>
+		template <class M>
+		bool insert_or_assign(const K& key, M&& value)
+		{
+			std::pair<V*, bool> result = emplace_key(key, std::forward<M>(value));
+			if (!result.second)
+				*result.first = std::forward<M>(value);
+			return result.second;
+		}
+
+		/// <summary>
+		/// Removes key from the map.  While small, the last item moves into its place
+		/// </summary>
+		/// <returns>false if the key was not in the map</returns>
+		template <class Q, enable_if_lookup_key<Q> = 0>
+		bool remove(const Q& key)
+		{
+			if (mIsLarge)
+				return mLarge.remove(key);
+			unsigned int i = small_find(key, fragment(key));
+			if (i == N)
+				return false;
+			item(i)->~pair();
+			unsigned int last = --mSmallSize;
+			if (i != last)
+			{
+				::new ((void*)item(i)) std::pair<K, V>(std::move(*item(last)));
+				item(last)->~pair();
+				mControl[i] = mControl[last];
+			}
+			mControl[last] = ControlGroup::msEmpty;
+			return true;
+		}
+
+		bool remove(const K& key)
+		{
+			return remove<K>(key);
+		}
+
+		/// <summary>
+		/// Returns the number of items
+		/// </summary>
+		unsigned int size() const
+		{
+			return mIsLarge ? (unsigned int)mLarge.size() : mSmallSize;
+		}
+
+		/// <summary>
+		/// Returns a copy of the allocator a spill gets its table from
+		/// </summary>
+		Allocator get_allocator() const
+		{
+			return mAllocator;
+		}
+
+		/// <summary>
+		/// Returns true while the items are still kept inline
+		/// </summary>
+		bool is_small() const
+		{
+			return !mIsLarge;
+		}
+
+		/// <summary>
+		/// Calls func(const std::pair<K, V>&) for every item.  func must not change the map
+		/// </summary>
+		template <class F>
+		void for_each(F&& func) const
+		{
+			if (!mIsLarge)
+			{
+				for (unsigned int i = 0; i < mSmallSize; i++)
+					func(*item(i));
+				return;
+			}
+			table_type& large = const_cast<table_type&>(mLarge);
+			for (typename table_type::unorderMapIterator it = large.begin(); it != large.end(); ++it)
+				func((const std::pair<K, V>&)*it);
+		}
+	};
+
+	namespace pmr
+	{
+		/// A SmallUnorderedMap whose table (once spilled) comes from a std::pmr::memory_resource (e.g. an ssuds::MonotonicArena)
+		template <class K, class V, unsigned int N = 8, class Hash = FastHash<K>, class Probing = LinearProbing, class HashStorage = NoStoredHash>
+		using SmallUnorderedMap = ssuds::SmallUnorderedMap<K, V, N, Hash, Probing, HashStorage, std::pmr::polymorphic_allocator<std::pair<K, V>>>;
+	}
+}
@@ -0,0 +1,243 @@
+#pragma once
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <hash.h>
+
+namespace ssuds
+{
+	/// <summary>
+	/// The header at the start of a hashed-container snapshot file (see UnorderedMap::save).  Everything after the
+	/// header is found through the offsets here, so the file holds no pointers and can be mapped at any address.
+	/// The file is in the saving machine's byte order (mByteOrder tells a reader if that isn't its own).
+	/// </summary>
+	struct SnapshotHeader
+	{
+		/// Always msMagic
+		char mMagic[8];
+
+		/// The file format version (msVersion when written by this code)
+		unsigned int mVersion;
+
+		/// msByteOrder, as written by the saving machine
+		unsigned int mByteOrder;
+
+		/// Sizes (in bytes) of the saved types, so a snapshot isn't opened as the wrong kind of container
+		unsigned int mKeySize;
+		unsigned int mValueSize;
+		unsigned int mSlotSize;
+		unsigned int mSlotAlignment;
+
+		/// The size of each probe distance and stored hash (0 if the container doesn't keep them)
+		unsigned int mProbeDistanceSize;
+		unsigned int mStoredHashSize;
+
+		/// The container's capacity, size and max load factor
+		unsigned int mCapacity;
+		unsigned int mSize;
+		float mMaxLoadFactor;
+
+		/// The number of control bytes saved (the capacity plus msControlPadding mirrored ones)
+		unsigned int mControlBytes;
+
+		/// The container's hash code for the key in its first used slot (0 if there isn't one).  Checked when the
+		/// snapshot is opened, to catch a hash function that gives different results in the opening program
+		unsigned long long mHashCheck;
+
+		/// Where each section starts (from the start of the file).  Every section is msAlignment-aligned
+		unsigned long long mControlOffset;
+		unsigned long long mSlotsOffset;
+		unsigned long long mProbeDistanceOffset;
+		unsigned long long mStoredHashOffset;
+
+		/// The total file size
+		unsigned long long mFileSize;
+
+		/// The checksum (see snapshot_checksum) of everything after the header
+		unsigned long long mDataChecksum;
+
+		/// The checksum of the header itself (everything above this member)
+		unsigned long long mHeaderChecksum;
+
+		static constexpr const char* msMagic = "SSUDSMAP";
+		static const unsigned int msVersion = 1;
+		static const unsigned int msByteOrder = 0x01020304;
+
+		/// Sections start on a multiple of this many bytes (enough for any slot alignment, and a cache line)
+		static const unsigned int msAlignment = 64;
+
+		/// Enough mirrored control bytes for the widest ControlGroup, so a snapshot can be used by any build
+		static const unsigned int msControlPadding = 31;
+
+		/// The data checksum is made by hashing msChecksumChunk bytes at a time
+		static const unsigned int msChecksumChunk = 1 << 20;
+
+		/// Rounds an offset up to the next multiple of msAlignment
+		static unsigned long long align(unsigned long long offset)
+		{
+			return (offset + msAlignment - 1) / msAlignment * msAlignment;
+		}
+
+		/// Returns the checksum of this header (everything before mHeaderChecksum)
+		unsigned long long header_checksum() const
+		{
+			return hash_bytes(this, offsetof(SnapshotHeader, mHeaderChecksum));
+		}
+
+		/// <summary>
+		/// Throws a std::runtime_error (mentioning path) if this isn't a valid, uncorrupted header from this
+		/// format version that describes a file of file_size bytes
+		/// </summary>
+		void check(const std::string& path, unsigned long long file_size) const
+		{
+			if (std::memcmp(mMagic, msMagic, sizeof(mMagic)) != 0)
+				throw std::runtime_error("Not a snapshot file: " + path);
+			if (mByteOrder != msByteOrder)
+				throw std::runtime_error("Snapshot was saved on a machine with a different byte order: " + path);
+			if (mVersion != msVersion)
+				throw std::runtime_error("Unsupported snapshot version " + std::to_string(mVersion) + ": " + path);
+			if (mHeaderChecksum != header_checksum() || mFileSize != file_size)
+				throw std::runtime_error("Snapshot is corrupt or truncated: " + path);
+		}
+	};
+
+
+	/// <summary>
+	/// Returns the checksum of len bytes as snapshot files use it: each msChecksumChunk-byte chunk is hashed
+	/// with hash_bytes, seeded by the hash of the chunk before it.  seed continues a checksum of earlier bytes
+	/// (see SnapshotWriter)
+	/// </summary>
+	inline unsigned long long snapshot_checksum(const void* data, unsigned long long len, unsigned long long seed = 0)
+	{
+		const unsigned char* p = (const unsigned char*)data;
+		while (len > 0)
+		{
+			std::size_t chunk = len < SnapshotHeader::msChecksumChunk ? (std::size_t)len : SnapshotHeader::msChecksumChunk;
+			seed = hash_bytes(p, chunk, seed);
+			p += chunk;
+			len -= chunk;
+		}
+		return seed;
+	}
+
+
+	/// <summary>
+	/// Writes a snapshot file: the header is written last (over a placeholder), once the data checksum and
+	/// section offsets are known.  Data is buffered in msChecksumChunk-byte chunks, each one checksummed as it
+	/// is written, so the checksum matches snapshot_checksum of the whole data section.
+	/// </summary>
+	class SnapshotWriter
+	{
+	public:
+		/// Opens (creating or replacing) the file at path and leaves room for the header
+		SnapshotWriter(const std::string& path) : mPath(path), mFile(path, std::ios::binary | std::ios::trunc), mOffset(sizeof(SnapshotHeader)),
+			mChecksum(0)
+		{
+			if (!mFile)
+				throw std::runtime_error("Unable to create snapshot file: " + path);
+			mBuffer.reserve(SnapshotHeader::msChecksumChunk);
+			SnapshotHeader placeholder = {};
+			mFile.write((const char*)&placeholder, sizeof(placeholder));
+		}
+
+		/// The offset (from the start of the file) the next byte will be written at
+		unsigned long long offset() const
+		{
+			return mOffset;
+		}
+
+		/// Appends len bytes
+		void write(const void* data, unsigned long long len)
+		{
+			const unsigned char* p = (const unsigned char*)data;
+			while (len > 0)
+			{
+				std::size_t room = SnapshotHeader::msChecksumChunk - mBuffer.size();
+				std::size_t amount = len < room ? (std::size_t)len : room;
+				mBuffer.insert(mBuffer.end(), p, p + amount);
+				p += amount;
+				len -= amount;
+				mOffset += amount;
+				if (mBuffer.size() == SnapshotHeader::msChecksumChunk)
+					flush();
+			}
+		}
+
+		/// Appends zero bytes up to the next msAlignment boundary, returning the (aligned) offset
+		unsigned long long align()
+		{
+			static const unsigned char zeros[SnapshotHeader::msAlignment] = {};
+			write(zeros, SnapshotHeader::align(mOffset) - mOffset);
+			return mOffset;
+		}
+
+		/// Writes out the rest of the data, then fills in header's size and checksum fields and writes it at the
+		/// start of the file
+		void finish(SnapshotHeader& header)
+		{
+			flush();
+			header.mFileSize = mOffset;
+			header.mDataChecksum = mChecksum;
+			header.mHeaderChecksum = header.header_checksum();
+			mFile.seekp(0);
+			mFile.write((const char*)&header, sizeof(header));
+			mFile.close();
+			if (!mFile)
+				throw std::runtime_error("Unable to write snapshot file: " + mPath);
+		}
+
+	protected:
+		/// Checksums and writes the buffered data
+		void flush()
+		{
+			mChecksum = snapshot_checksum(mBuffer.data(), mBuffer.size(), mChecksum);
+			mFile.write((const char*)mBuffer.data(), mBuffer.size());
+			mBuffer.clear();
+		}
+
+		std::string mPath;
+		std::ofstream mFile;
+		std::vector<unsigned char> mBuffer;
+		unsigned long long mOffset;
+		unsigned long long mChecksum;
+	};
+
+
+	/// <summary>
+	/// A whole file mapped into memory copy-on-write: pages are only read from disk when first touched, and
+	/// writing to the memory changes this process's copy but never the file.  The mapping lasts until the
+	/// MappedFile is destroyed.  The constructor and destructor are in src/ssuds/snapshot.cpp (which programs using
+	/// UnorderedMap compile in) so windows.h / the POSIX headers don't leak into every file including this one.
+	/// </summary>
+	class MappedFile
+	{
+	public:
+		/// Maps the file at path, throwing a std::runtime_error if it can't be opened or mapped
+		MappedFile(const std::string& path);
+
+		MappedFile(const MappedFile& other) = delete;
+		MappedFile& operator=(const MappedFile& other) = delete;
+
+		/// Unmaps the file
+		~MappedFile();
+
+		/// The start of the mapped file
+		unsigned char* data() const
+		{
+			return (unsigned char*)mData;
+		}
+
+		/// The size of the file
+		unsigned long long size() const
+		{
+			return mSize;
+		}
+
+	protected:
+		void* mData;
+		unsigned long long mSize;
+	};
+}
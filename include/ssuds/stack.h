@@ -3,11 +3,26 @@
 
 namespace ssuds
 {
-	/// This Stack classes uses inheritance (from LinkedList) to create a LIFO structure (Last-in-first-out)
-	template <class T>
-	class Stack : private LinkedList<T>
+	/// This Stack classes uses inheritance (from LinkedList) to create a LIFO structure (Last-in-first-out).  Allocator
+	/// is passed on to the LinkedList
+	template <class T, class Allocator = std::allocator<T>>
+	class Stack : private LinkedList<T, Allocator>
 	{
 	public:
+		/// Default constructor
+		Stack()
+		{
+			// Intentionally blank
+		}
+
+
+		/// Constructor for an empty stack whose memory comes from alloc
+		explicit Stack(const Allocator& alloc) : LinkedList<T, Allocator>(alloc)
+		{
+			// Intentionally blank
+		}
+
+
 		/// <summary>
 		///  Adds a new element to the top of the stack
 		/// </summary>
@@ -56,17 +71,25 @@ namespace ssuds
 			return this->mSize == 0;
 		}
 
-		using LinkedList<T>::clear;
-		using LinkedList<T>::begin;
-		using LinkedList<T>::end;
-		using LinkedList<T>::size;
+		using LinkedList<T, Allocator>::clear;
+		using LinkedList<T, Allocator>::begin;
+		using LinkedList<T, Allocator>::end;
+		using LinkedList<T, Allocator>::size;
+		using LinkedList<T, Allocator>::get_allocator;
 
 		friend std::ostream& operator<<(std::ostream& os, const Stack& S)
 		{
-			os << dynamic_cast<const LinkedList<T> &>(S);
+			os << dynamic_cast<const LinkedList<T, Allocator> &>(S);
 
 			return os;
 		}
 	};
+
+	namespace pmr
+	{
+		/// A Stack whose memory comes from a std::pmr::memory_resource
+		template <class T>
+		using Stack = ssuds::Stack<T, std::pmr::polymorphic_allocator<T>>;
+	}
 }
 
@@ -1,222 +1,1144 @@
+#pragma once
 #include <ostream>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <control_group.h>
+#include <hash.h>
+#include <snapshot.h>
+#include <unordered_map_stats.h>
+
+#if SSUDS_UNORDERED_MAP_STATS
+#include <chrono>
+#endif
 
 namespace ssuds
 {
-	template <class K, class V>
+	//the default probing policy for UnorderedMap: an item goes in the first unused slot at or after its home slot
+	struct LinearProbing
+	{
+		static const bool msRobinHood = false;
+	};
+
+	//a probing policy for UnorderedMap that still probes linearly, but an item being inserted takes the slot of
+	//any item that is closer to its own home slot ("richer"), which then moves on.  This keeps every probe distance
+	//close to the mean, and lets a lookup stop as soon as it sees an item richer than the key would be
+	struct RobinHoodProbing
+	{
+		static const bool msRobinHood = true;
+	};
+
+	//the default hash-storage policy for UnorderedMap: nothing but the 7-bit fragment in the control byte is kept,
+	//so growing the table re-hashes every key
+	struct NoStoredHash
+	{
+		static const bool msStoreHash = false;
+		typedef unsigned char hash_type;
+	};
+
+	//a hash-storage policy for UnorderedMap that keeps (the low bits of) each item's hash code in a parallel array of
+	//T's.  Growing the table then never calls the hash function, and a probe skips any key whose stored hash differs
+	//before comparing keys.  Worth it for keys that are slow to hash or compare (e.g. long strings), not for ints
+	template <class T>
+	struct StoredHash
+	{
+		static const bool msStoreHash = true;
+		typedef T hash_type;
+	};
+
+	typedef StoredHash<unsigned int> StoredHash32;
+	typedef StoredHash<unsigned long long> StoredHash64;
+
+	//true if a Q can be used to look up a K without first being converted to a K: the hash function has to say it is
+	//"transparent" (define is_transparent, like FastHash<std::string> does) and be callable with a Q.  The hash
+	//function must give a Q the same hash code as the K it equals, and K == Q must work
+	template <class Hash, class K, class Q, class = void>
+	struct _is_transparent_key : std::false_type
+	{
+	};
+
+	template <class Hash, class K, class Q>
+	struct _is_transparent_key<Hash, K, Q, std::void_t<typename Hash::is_transparent, decltype(std::declval<const Hash&>()(std::declval<const Q&>()))>>
+		: std::integral_constant<bool, !std::is_same<Q, K>::value>
+	{
+	};
+
+	template <class K, class V, class Hash, class Probing, class HashStorage, class Allocator>
+	class IncrementalUnorderedMap;
+
+	//Allocator is where the table's arrays come from: the pairs, and (rebound) the control bytes, probe distances and
+	//stored hashes.  It always goes with the table -- a moved-to or swapped map takes the other map's allocator
+	//along with its table -- except that assigning a copy keeps this map's own (see ssuds::pmr::UnorderedMap for a
+	//map that takes a std::pmr::memory_resource)
+	template <class K, class V, class Hash = FastHash<K>, class Probing = LinearProbing, class HashStorage = NoStoredHash,
+		class Allocator = std::allocator<std::pair<K, V>>>
 	class UnorderedMap
 	{
+		static_assert(std::is_same<typename std::allocator_traits<Allocator>::value_type, std::pair<K, V>>::value,
+			"Allocator::value_type must be std::pair<K, V>");
+
+		// moves items from one table to another a few slots at a time, so it works on the slots directly
+		template <class, class, class, class, class, class>
+		friend class IncrementalUnorderedMap;
+
 	protected:
-		// Option2: an array of pair objects and a bool "used" array
+		// an array of pair objects and a parallel array of control bytes.  A control byte is either
+		// ControlGroup::msEmpty or the 7-bit hash fragment of the pair in that slot, so most failed
+		// key comparisons are ruled out without touching mTableData.  mTableData is uninitialized
+		// storage: a pair only exists (is constructed with placement new) in a used slot.  The control array has
+		// ControlGroup::msWidth - 1 extra bytes at the end that mirror the start of the table, so a
+		// group can be loaded at any index without wrapping
 		std::pair<K, V>* mTableData;
-		bool* mTableUsed;
+		unsigned char* mControl;
+
+		// for RobinHoodProbing only (nullptr otherwise): how far each used slot is from its item's home slot
+		unsigned int* mProbeDistance;
+
+		// for StoredHash policies only (nullptr otherwise): each used slot's hash code, truncated to hash_type
+		typename HashStorage::hash_type* mStoredHash;
 
 		// Both
 		unsigned int mSize;
 		unsigned int mCapacity;
-		std::hash<K> mHashGenerator;
+		Hash mHashGenerator;
+
+		// the home slot is the top log2(mCapacity) bits of the hash code, i.e. hash >> mShift
+		unsigned int mShift;
+
+		// the fraction of the table that may be used before we grow (double) the capacity
+		float mMaxLoadFactor;
+
+		// for a map made by open_mapped (nullptr otherwise): the snapshot file the arrays above live in.  The
+		// arrays are "freed" by unmapping the file, which happens when the map is destroyed or first rehashes
+		MappedFile* mMapping;
+
+		// where the arrays above come from (unless they're in a snapshot)
+		Allocator mAllocator;
+
+#if SSUDS_UNORDERED_MAP_STATS
+		// the lookup and rehash counts (see stats).  Lookups in a const map are counted too, hence mutable
+		mutable _UnorderedMapCounters mCounters;
+#endif
+
+		// the smallest table we will ever allocate.  Capacities are always a power of two so the
+		// home slot can be found with a shift instead of a modulo
+		static const unsigned int msMinCapacity = 8;
+		static constexpr float msDefaultMaxLoadFactor = 0.75f;
+
+		// how many keys find_batch and contains_batch have in flight (hashed and prefetched) at once
+		static const unsigned int msBatchSize = 16;
+
+		// 2^64 / the golden ratio.  Multiplying by this ("fibonacci hashing") spreads every bit of the hash
+		// function's result into the top bits, which are the ones that pick the home slot
+		static const unsigned long long msFibonacciMultiplier = 11400714819323198485ull;
+
+		// snapshots keep enough mirrored control bytes for any group width up to 32
+		static_assert(ControlGroup::msWidth - 1 <= SnapshotHeader::msControlPadding, "Snapshots don't have enough mirrored control bytes");
+
+		// stored hashes keep the top bits of the hash code (the ones that pick the home slot)
+		static const unsigned int msStoredHashShift = 64 - 8 * sizeof(typename HashStorage::hash_type);
 	public:
 		//will create an iterator class that will step through and take note of any item that currently has something in it.
-		//If the item looked at has a mTableUsed of false, it will be ignored as it is empty
+		//Empty slots are skipped a group of control bytes at a time: the used slots in a group form a bitmap, and
+		//the next item is found with a count-trailing-zeros, so sparse tables don't cost a read per slot
 		class unorderMapIterator
 		{
 		protected:
-			const std::pair<K, V>* mData;
+			std::pair<K, V>* mData;
 
-			const bool* mUsed;
+			const unsigned char* mControl;
 
 			const unsigned int mCapacity;
 
 			int mPosition;
 
-			unorderMapIterator(int start_index, std::pair<K, V>* Data, bool* Used, unsigned int cap) : mPosition(start_index), mData(Data), mUsed(Used), mCapacity(cap)
+			unorderMapIterator(int start_index, std::pair<K, V>* Data, unsigned char* Control, unsigned int cap) : mData(Data), mControl(Control), mCapacity(cap), mPosition(start_index)
+			{
+				skip_unused();
+			}
+
+			//moves mPosition forward to the first used slot at or after it (or to mCapacity if there is none).  The
+			//mirrored control bytes past the end of the table mean a group can be loaded at any slot
+			void skip_unused()
 			{
-				for (unsigned int i = mPosition; i < mCapacity; i++)
+				while (mPosition < (int)mCapacity)
 				{
-					if (mUsed[mPosition] == false)
-						++mPosition;
+					unsigned int full = ControlGroup(mControl + mPosition).match_full();
+					if (full != 0)
+					{
+						// A match past the end of the table is a mirror of a slot we've already been past
+						mPosition += count_trailing_zeros(full);
+						if (mPosition > (int)mCapacity)
+							mPosition = mCapacity;
+						return;
+					}
+					mPosition += ControlGroup::msWidth;
 				}
+				mPosition = mCapacity;
 			}
 		public:
 			friend class UnorderedMap;
 
 			//will return true if the unorderedlist being looked at is equal to the other passed for comparison if they have the same
-			//mTableData, mTableUsed, and same index location
+			//mTableData, mControl, and same index location
 			bool operator== (const unorderMapIterator& other) const
 			{
-				return this->mData == other.mData && this->mUsed == other.mUsed && this->mPosition == other.mPosition;
+				return this->mData == other.mData && this->mControl == other.mControl && this->mPosition == other.mPosition;
 			}
 
 
-			//will step forward to the next item of the unordered map that has a mTableUsed = true
-			void const operator++()
+			//will step forward to the next item of the unordered map that has a full control byte
+			unorderMapIterator& operator++()
 			{
 				++mPosition;
-				for (unsigned int i = mPosition; i < mCapacity; i++)
-				{
-					if (mUsed[mPosition] == false)
-						++mPosition;
-				}
+				skip_unused();
+				return *this;
 			}
 
 
-			//Returns a std::pair<K,V> pointer to the current item being looked at
-			std::pair<K,V> const operator*()
+			//Returns a reference to the current item being looked at (the key must not be changed through it)
+			std::pair<K, V>& operator*() const
 			{
 				return mData[mPosition];
 			}
 
+			std::pair<K, V>* operator->() const
+			{
+				return mData + mPosition;
+			}
+
 			//will return false if the unorderedlist being looked at is not equal to the other passed for comparison if they have the different
-			//mTableData, mTableUsed, and different index location
+			//mTableData, mControl, and different index location
 			bool const operator!= (const unorderMapIterator& other) const
 			{
-				return this->mData != other.mData || this->mUsed != other.mUsed || this->mPosition != other.mPosition;
+				return this->mData != other.mData || this->mControl != other.mControl || this->mPosition != other.mPosition;
 			}
 		};
 
 
 	private:
 
-		//creates a hash code based on the given key
-		unsigned long long hashGen(const K& the_key)
+		//the template methods below that take a key of type Q (find, remove, operator[]) accept K itself or any
+		//type Q for which _is_transparent_key<Hash, K, Q> is true
+		template <class Q>
+		using enable_if_lookup_key = typename std::enable_if<std::is_same<Q, K>::value || _is_transparent_key<Hash, K, Q>::value, int>::type;
+
+		//creates a hash code based on the given key (which is a K or a transparent lookup key) by running the hash
+		//function and then fibonacci hashing the result
+		template <class Q>
+		unsigned long long hashGen(const Q& the_key) const
+		{
+			return (unsigned long long)mHashGenerator(the_key) * msFibonacciMultiplier;
+		}
+
+		//the slot where an item with the given hash code would ideally go
+		unsigned int home_slot(unsigned long long hash) const
+		{
+			return (unsigned int)(hash >> mShift);
+		}
+
+		//an iterator at the first used slot at or after start_index (for the const members that walk the table)
+		unorderMapIterator iterator_at(unsigned int start_index) const
+		{
+			return unorderMapIterator(start_index, mTableData, mControl, mCapacity);
+		}
+
+		//returns the smallest power of two that is >= n (and at least msMinCapacity)
+		static unsigned int round_up_capacity(unsigned long long n)
+		{
+			unsigned int result = msMinCapacity;
+			while (result < n)
+				result *= 2;
+			return result;
+		}
+
+		//the smallest capacity that can hold num_items without going over the max load factor
+		unsigned long long min_capacity_for(unsigned long long num_items) const
+		{
+			return (unsigned long long)(num_items / mMaxLoadFactor) + 1;
+		}
+
+		//sets the control byte of a slot, along with its mirror(s) past the end of the table
+		void set_control(unsigned int ind, unsigned char control)
+		{
+			mControl[ind] = control;
+			for (unsigned int i = ind + mCapacity; i < mCapacity + ControlGroup::msWidth - 1; i += mCapacity)
+				mControl[i] = control;
+		}
+
+		//the amount to shift a hash code right by to get a home slot in a table of the given (power of two) capacity
+		static unsigned int shift_for(unsigned int cap)
+		{
+			unsigned int shift = 64;
+			for (unsigned int i = cap; i > 1; i /= 2)
+				shift--;
+			return shift;
+		}
+
+		//gets an (uninitialized) array of n T's from our allocator, rebound to T
+		template <class T>
+		T* allocate_array(std::size_t n)
+		{
+			typename std::allocator_traits<Allocator>::template rebind_alloc<T> alloc(mAllocator);
+			return std::allocator_traits<decltype(alloc)>::allocate(alloc, n);
+		}
+
+		//gives an array from allocate_array back (nothing is done for nullptr)
+		template <class T>
+		void deallocate_array(T* arr, std::size_t n)
+		{
+			typename std::allocator_traits<Allocator>::template rebind_alloc<T> alloc(mAllocator);
+			if (arr)
+				std::allocator_traits<decltype(alloc)>::deallocate(alloc, arr, n);
+		}
+
+		//exchanges two maps' allocators (which a swap must do, since each map's arrays have to be freed by the
+		//allocator they came from).  A polymorphic_allocator can't be assigned, so each one is re-made in place
+		void swap_allocators(UnorderedMap& other) noexcept
+		{
+			Allocator temp(mAllocator);
+			mAllocator.~Allocator();
+			::new ((void*)&mAllocator) Allocator(other.mAllocator);
+			other.mAllocator.~Allocator();
+			::new ((void*)&other.mAllocator) Allocator(temp);
+		}
+
+		//allocates a table of the given capacity with every slot empty
+		void allocate_table(unsigned int cap)
+		{
+			mCapacity = cap;
+			mShift = shift_for(cap);
+			mTableData = allocate_array<std::pair<K, V>>(cap);
+			mControl = allocate_array<unsigned char>(cap + ControlGroup::msWidth - 1);
+			for (unsigned int i = 0; i < cap + ControlGroup::msWidth - 1; i++)
+				mControl[i] = ControlGroup::msEmpty;
+			mProbeDistance = Probing::msRobinHood ? allocate_array<unsigned int>(cap) : nullptr;
+			mStoredHash = HashStorage::msStoreHash ? allocate_array<typename HashStorage::hash_type>(cap) : nullptr;
+		}
+
+		//returns the hash code of the item in a used slot -- only the (top) bits kept by HashStorage, which are
+		//always enough for the home slot, if we're storing hashes
+		unsigned long long slot_hash(unsigned int ind) const
+		{
+			if (HashStorage::msStoreHash)
+				return (unsigned long long)mStoredHash[ind] << msStoredHashShift;
+			else
+				return hashGen(mTableData[ind].first);
+		}
+
+		//remembers the hash code of the item in slot ind (if we're storing hashes)
+		void store_hash(unsigned int ind, unsigned long long hash)
+		{
+			if (HashStorage::msStoreHash)
+				mStoredHash[ind] = (typename HashStorage::hash_type)(hash >> msStoredHashShift);
+		}
+
+		//false if we know (from the stored hash) that the item in slot ind can't have the given hash code
+		bool stored_hash_matches(unsigned int ind, unsigned long long hash) const
+		{
+			return !HashStorage::msStoreHash || mStoredHash[ind] == (typename HashStorage::hash_type)(hash >> msStoredHashShift);
+		}
+
+		//constructs the pair in (unused) slot ind from args, without touching its control byte
+		template <class... Args>
+		void construct_slot(unsigned int ind, Args&&... args)
+		{
+			::new ((void*)(mTableData + ind)) std::pair<K, V>(std::forward<Args>(args)...);
+		}
+
+		//destroys the pair in every used slot (the control bytes are left alone)
+		void destroy_items()
+		{
+			for (unsigned int i = 0; i < mCapacity; i++)
+			{
+				if (ControlGroup::is_full(mControl[i]))
+					mTableData[i].~pair();
+			}
+		}
+
+		//destroys every item and frees all of the table's arrays (which may be nullptr for a moved-from map)
+		void free_table()
+		{
+			destroy_items();
+			free_arrays(mTableData, mControl, mProbeDistance, mStoredHash, mCapacity);
+		}
+
+		//frees a table's arrays (which must be the current ones, or ones the current ones just replaced).  If they
+		//are in a mapped snapshot, the file is unmapped instead
+		void free_arrays(std::pair<K, V>* data, unsigned char* control, unsigned int* distance, typename HashStorage::hash_type* hash,
+			unsigned int cap)
+		{
+			if (mMapping)
+			{
+				delete mMapping;
+				mMapping = nullptr;
+				return;
+			}
+			deallocate_array(data, cap);
+			deallocate_array(control, cap + ControlGroup::msWidth - 1);
+			deallocate_array(distance, cap);
+			deallocate_array(hash, cap);
+		}
+
+		//frees the table of a map that is known to be empty, without destroy_items' look at every slot, leaving the
+		//map with no table (like a moved-from one)
+		void free_empty_table()
+		{
+			free_arrays(mTableData, mControl, mProbeDistance, mStoredHash, mCapacity);
+			mTableData = nullptr;
+			mControl = nullptr;
+			mProbeDistance = nullptr;
+			mStoredHash = nullptr;
+			mCapacity = 0;
+		}
+
+		//gives this map (which must not have a table yet) a copy of other's table, slot for slot
+		void copy_table(const UnorderedMap& other)
+		{
+			if (other.mCapacity == 0)
+			{
+				allocate_table(msMinCapacity);
+				return;
+			}
+
+			allocate_table(other.mCapacity);
+			if (std::is_trivially_copyable<K>::value && std::is_trivially_copyable<V>::value)
+				std::memcpy((void*)mTableData, (const void*)other.mTableData, sizeof(std::pair<K, V>) * mCapacity);
+			else
+			{
+				for (unsigned int i = 0; i < mCapacity; i++)
+				{
+					if (!ControlGroup::is_full(other.mControl[i]))
+						continue;
+					try
+					{
+						construct_slot(i, other.mTableData[i]);
+					}
+					catch (...)
+					{
+						// Only the slots before i have been made (and marked as used)
+						free_table();
+						throw;
+					}
+					mControl[i] = other.mControl[i];
+				}
+			}
+
+			std::memcpy(mControl, other.mControl, mCapacity + ControlGroup::msWidth - 1);
+			if (Probing::msRobinHood)
+				std::memcpy(mProbeDistance, other.mProbeDistance, sizeof(unsigned int) * mCapacity);
+			if (HashStorage::msStoreHash)
+				std::memcpy(mStoredHash, other.mStoredHash, sizeof(typename HashStorage::hash_type) * mCapacity);
+			mSize = other.mSize;
+		}
+
+		//moves the item (and its control byte and stored hash) from a used slot to an unused one.  The pair in
+		//from is destroyed, but from's control byte is left for the caller to deal with
+		void move_slot(unsigned int from, unsigned int to)
+		{
+			construct_slot(to, std::move(mTableData[from]));
+			mTableData[from].~pair();
+			set_control(to, mControl[from]);
+			if (HashStorage::msStoreHash)
+				mStoredHash[to] = mStoredHash[from];
+		}
+
+		//returns how many slots the item in the given (used) slot is past its home slot
+		unsigned int probe_distance(unsigned int ind) const
+		{
+			if (Probing::msRobinHood)
+				return mProbeDistance[ind];
+			else
+				return (ind - home_slot(slot_hash(ind))) & (mCapacity - 1);
+		}
+
+		//the first part of find_batch / contains_batch: hashes keys[start] .. keys[stop - 1] (into hashes) and
+		//prefetches the control bytes and first pair of each one's home slot
+		template <class Q>
+		void prefetch_homes(const Q* keys, unsigned int start, unsigned int stop, unsigned long long* hashes) const
+		{
+			for (unsigned int i = start; i < stop; i++)
+			{
+				hashes[i - start] = hashGen(keys[i]);
+				unsigned int home = home_slot(hashes[i - start]);
+				prefetch(mControl + home);
+				prefetch(mTableData + home);
+			}
+		}
+
+		//finds the slot holding the_key (found is set to true) or the slot where it would be inserted.  dist is set
+		//to the distance of the returned slot from the_key's home slot (only used by RobinHoodProbing).  Every
+		//lookup goes through here, so this is where they are counted (with SSUDS_UNORDERED_MAP_STATS)
+		template <class Q>
+		unsigned int probe(const Q& the_key, unsigned long long hash, bool& found, unsigned int& dist) const
+		{
+			unsigned int ind;
+			if (Probing::msRobinHood)
+				ind = probe_robin_hood(the_key, hash, found, dist);
+			else
+			{
+				dist = 0;
+				ind = probe_linear(the_key, hash, found);
+			}
+#if SSUDS_UNORDERED_MAP_STATS
+			mCounters.count_lookup(found, (ind - home_slot(hash)) & (mCapacity - 1));
+#endif
+			return ind;
+		}
+
+		//walks the probe chain for the_key starting at its home slot, one group of control bytes at a time.  Only
+		//slots whose hash fragment matches have their key compared.  Stops at either the slot holding the_key
+		//(found is set to true) or the first unused slot, which is where the_key would be inserted.  Because the
+		//load factor is always below 1, there is always an unused slot to stop on.
+		template <class Q>
+		unsigned int probe_linear(const Q& the_key, unsigned long long hash, bool& found) const
+		{
+			unsigned int mask = mCapacity - 1;
+			unsigned char frag = ControlGroup::fragment(hash);
+			unsigned int ind = home_slot(hash);
+			while (true)
+			{
+				ControlGroup group(mControl + ind);
+				unsigned int empties = group.match_empty();
+				unsigned int candidates = group.match(frag);
+
+				// Slots after the first empty one belong to a different cluster
+				if (empties != 0)
+					candidates &= (empties & (~empties + 1)) - 1;
+
+				while (candidates != 0)
+				{
+					unsigned int slot = (ind + count_trailing_zeros(candidates)) & mask;
+					if (stored_hash_matches(slot, hash) && mTableData[slot].first == the_key)
+					{
+						found = true;
+						return slot;
+					}
+					candidates &= candidates - 1;
+				}
+
+				if (empties != 0)
+				{
+					found = false;
+					return (ind + count_trailing_zeros(empties)) & mask;
+				}
+				ind = (ind + ControlGroup::msWidth) & mask;
+			}
+		}
+
+		//the RobinHoodProbing version of probe: walks slot by slot from the home slot, stopping at the key, an unused
+		//slot, or an item that is closer to its home than the_key would be (the_key can't be any further along, and
+		//that is the slot it would take if inserted)
+		template <class Q>
+		unsigned int probe_robin_hood(const Q& the_key, unsigned long long hash, bool& found, unsigned int& dist) const
+		{
+			unsigned int mask = mCapacity - 1;
+			unsigned char frag = ControlGroup::fragment(hash);
+			unsigned int ind = home_slot(hash);
+			dist = 0;
+			while (ControlGroup::is_full(mControl[ind]) && mProbeDistance[ind] >= dist)
+			{
+				if (mControl[ind] == frag && stored_hash_matches(ind, hash) && mTableData[ind].first == the_key)
+				{
+					found = true;
+					return ind;
+				}
+				ind = (ind + 1) & mask;
+				dist++;
+			}
+			found = false;
+			return ind;
+		}
+
+		//puts item (with the given hash code and control byte) in slot ind (dist slots from its home), where
+		//probe_robin_hood stopped.  Whatever was there moves along the chain, taking the place of the next richer
+		//item, until something lands in an unused slot
+		void robin_hood_place(unsigned int ind, unsigned int dist, std::pair<K, V>&& item, unsigned long long hash, unsigned char frag)
+		{
+			unsigned int mask = mCapacity - 1;
+			while (ControlGroup::is_full(mControl[ind]))
+			{
+				if (mProbeDistance[ind] < dist)
+				{
+					std::swap(mTableData[ind], item);
+					std::swap(mProbeDistance[ind], dist);
+					unsigned char displaced = mControl[ind];
+					set_control(ind, frag);
+					frag = displaced;
+					if (HashStorage::msStoreHash)
+					{
+						unsigned long long displaced_hash = slot_hash(ind);
+						store_hash(ind, hash);
+						hash = displaced_hash;
+					}
+				}
+				ind = (ind + 1) & mask;
+				dist++;
+			}
+			construct_slot(ind, std::move(item));
+			mProbeDistance[ind] = dist;
+			set_control(ind, frag);
+			store_hash(ind, hash);
+		}
+
+		//places a pair (whose key we know is not in the table) in the first unused slot of its probe chain.  hash
+		//only needs the top bits that pick the home slot, since the control byte (fragment) is passed separately
+		void insert_unique(std::pair<K, V>&& item, unsigned long long hash, unsigned char frag)
+		{
+			unsigned int mask = mCapacity - 1;
+			if (Probing::msRobinHood)
+			{
+				robin_hood_place(home_slot(hash), 0, std::move(item), hash, frag);
+				return;
+			}
+
+			unsigned int ind = home_slot(hash);
+			unsigned int empties;
+			while ((empties = ControlGroup(mControl + ind).match_empty()) == 0)
+				ind = (ind + ControlGroup::msWidth) & mask;
+			ind = (ind + count_trailing_zeros(empties)) & mask;
+
+			construct_slot(ind, std::move(item));
+			set_control(ind, frag);
+			store_hash(ind, hash);
+		}
+
+		//marks the (already destroyed or never constructed) slot hole as unused.  Any items later in the same
+		//cluster that could live closer to their home slot are shifted back into the hole (backward-shift deletion),
+		//so the probe chains stay intact without tombstones
+		void close_hole(unsigned int hole)
+		{
+			unsigned int mask = mCapacity - 1;
+			unsigned int ind = (hole + 1) & mask;
+			if (Probing::msRobinHood)
+			{
+				// Every item after the hole that isn't in its home slot moves back one spot
+				while (ControlGroup::is_full(mControl[ind]) && mProbeDistance[ind] > 0)
+				{
+					move_slot(ind, hole);
+					mProbeDistance[hole] = mProbeDistance[ind] - 1;
+					hole = ind;
+					ind = (ind + 1) & mask;
+				}
+			}
+			else
+			{
+				while (ControlGroup::is_full(mControl[ind]))
+				{
+					// The item at ind may move back into the hole only if its home slot is not between the
+					// hole and ind (cyclically) -- otherwise it would end up before its own home slot
+					unsigned int home = home_slot(slot_hash(ind));
+					if (((ind - home) & mask) >= ((ind - hole) & mask))
+					{
+						move_slot(ind, hole);
+						hole = ind;
+					}
+					ind = (ind + 1) & mask;
+				}
+			}
+
+			set_control(hole, ControlGroup::msEmpty);
+		}
+
+		//the RobinHoodProbing part of adding a new item at slot ind (where probe_robin_hood stopped): if ind is used,
+		//its item moves along the chain (see robin_hood_place) and ind is left unused for the new item
+		void robin_hood_evict(unsigned int ind)
 		{
-			return mHashGenerator(the_key);
+			if (!ControlGroup::is_full(mControl[ind]))
+				return;
+			std::pair<K, V> displaced(std::move(mTableData[ind]));
+			mTableData[ind].~pair();
+			unsigned char frag = mControl[ind];
+			unsigned long long hash = HashStorage::msStoreHash ? slot_hash(ind) : 0;
+			set_control(ind, ControlGroup::msEmpty);
+			robin_hood_place((ind + 1) & (mCapacity - 1), mProbeDistance[ind] + 1, std::move(displaced), hash, frag);
+		}
+
+		//looks up lookup_key and, if it isn't there, constructs a new pair in place from key (which must equal
+		//lookup_key) and value_args, growing the table first if needed.  The pair is constructed exactly once and
+		//nothing is copied or moved.  Returns the slot holding lookup_key and whether a new pair was added
+		template <class Q, class KArg, class... Args>
+		std::pair<unsigned int, bool> emplace_unique(const Q& lookup_key, KArg&& key, Args&&... value_args)
+		{
+			// A moved-from map has no table at all
+			if (mCapacity == 0)
+				allocate_table(msMinCapacity);
+
+			unsigned long long hash = hashGen(lookup_key);
+
+			bool found;
+			unsigned int dist;
+			unsigned int ind = probe(lookup_key, hash, found, dist);
+			if (found)
+				return std::pair<unsigned int, bool>(ind, false);
+
+			if (mSize + 1 > mCapacity * mMaxLoadFactor)
+			{
+				rehash(mCapacity * 2);
+				ind = probe(lookup_key, hash, found, dist);
+			}
+
+			// With RobinHoodProbing the new pair always ends up in slot ind -- it's everything after it that might move
+			if (Probing::msRobinHood)
+				robin_hood_evict(ind);
+			try
+			{
+				construct_slot(ind, std::piecewise_construct, std::forward_as_tuple(std::forward<KArg>(key)),
+					std::forward_as_tuple(std::forward<Args>(value_args)...));
+			}
+			catch (...)
+			{
+				// Put back anything robin_hood_evict moved
+				if (Probing::msRobinHood)
+					close_hole(ind);
+				throw;
+			}
+
+			if (Probing::msRobinHood)
+				mProbeDistance[ind] = dist;
+			set_control(ind, ControlGroup::fragment(hash));
+			store_hash(ind, hash);
+			mSize++;
+			return std::pair<unsigned int, bool>(ind, true);
 		}
 	public:
 		 
 		//points the iterator to the beginning of the unorderedmap
-		typename unorderMapIterator begin() 
+		unorderMapIterator begin()
 		{
-			return unorderMapIterator(0, this->mTableData, this->mTableUsed, mCapacity); 
+			return unorderMapIterator(0, this->mTableData, this->mControl, mCapacity); 
 		}
 
 		//points the iterator to the end of the unorderedmap
-		typename unorderMapIterator end()
+		unorderMapIterator end()
+		{
+			return unorderMapIterator(mCapacity, this->mTableData, this->mControl, mCapacity);
+		}
+
+		//constructor for the unorderedmap class that takes a int capacity as a parameter.  The capacity is
+		//rounded up to the next power of two (minimum msMinCapacity) and grows automatically as items are added.
+		//hash_function is the Hash object to use (only needed if Hash has some state), and alloc the allocator
+		UnorderedMap(int capacity = msMinCapacity, const Hash& hash_function = Hash(), const Allocator& alloc = Allocator()) : mSize(0),
+			mHashGenerator(hash_function), mMaxLoadFactor(msDefaultMaxLoadFactor), mMapping(nullptr), mAllocator(alloc)
+		{
+			allocate_table(round_up_capacity(capacity > 0 ? capacity : 0));
+		}
+
+		//makes an empty map whose arrays come from alloc (for a pmr map this can be given a std::pmr::memory_resource*)
+		explicit UnorderedMap(const Allocator& alloc) : UnorderedMap(msMinCapacity, Hash(), alloc)
+		{
+		}
+
+		//copy constructor: makes a new table the same size as other's with a copy of each item in the same slot, so
+		//nothing is re-hashed.  If K and V are trivially copyable the whole table is copied with one memcpy.  The
+		//allocator is copied as the allocator says to (a pmr map's copy uses the default resource)
+		UnorderedMap(const UnorderedMap& other) : UnorderedMap(other,
+			std::allocator_traits<Allocator>::select_on_container_copy_construction(other.mAllocator))
+		{
+		}
+
+		//copy constructor that gives the copy's arrays a different allocator
+		UnorderedMap(const UnorderedMap& other, const Allocator& alloc) : mSize(0), mHashGenerator(other.mHashGenerator),
+			mMaxLoadFactor(other.mMaxLoadFactor), mMapping(nullptr), mAllocator(alloc)
 		{
-			return unorderMapIterator(mCapacity, this -> mTableData, this->mTableUsed, mCapacity);
+			copy_table(other);
 		}
 
-		//constructor for the unorderedmap class that takes a int capacity as a parameter
-		UnorderedMap(int capacity) : mCapacity(capacity)
+		//move constructor: "steals" other's table in O(1).  other is left empty, with no table (it makes a new one
+		//the first time something is added to it)
+		UnorderedMap(UnorderedMap&& other) noexcept : mTableData(other.mTableData), mControl(other.mControl),
+			mProbeDistance(other.mProbeDistance), mStoredHash(other.mStoredHash), mSize(other.mSize), mCapacity(other.mCapacity),
+			mHashGenerator(std::move(other.mHashGenerator)), mShift(other.mShift), mMaxLoadFactor(other.mMaxLoadFactor),
+			mMapping(other.mMapping), mAllocator(other.mAllocator)
 		{
-			mTableData = new std::pair<K, V>[capacity];
-			mTableUsed = new bool[capacity];
-			for (int i = 0; i < capacity; i++)
-				mTableUsed[i] = false;
+			other.mTableData = nullptr;
+			other.mControl = nullptr;
+			other.mProbeDistance = nullptr;
+			other.mStoredHash = nullptr;
+			other.mMapping = nullptr;
+			other.mSize = 0;
+			other.mCapacity = 0;
+#if SSUDS_UNORDERED_MAP_STATS
+			mCounters.swap(other.mCounters);
+#endif
 		}
 
 		//deconstructor for unorderedMap that deletes all items in the class and then sets the size and capacity to 0
 		~UnorderedMap()
 		{
-			delete[]mTableData;
-			delete[]mTableUsed;
+			free_table();
 			mSize = 0;
 			mCapacity = 0;
 		}
-		
 
-		//first creates a hash using hashGen, given the key passed in for the function. it then finds the index location
-		//by taking the modulo of hash and mCapacity. If the Size of the current map is 0, it returns the end() of the iterator
-		//if it finds a location in the map that uses the index, it returns an iterator object for the indexed location,
-		//otherwise it returns the end() iterator
-		typename unorderMapIterator find(const K& key)
+		//replaces this map with a copy of other (made with this map's allocator).  The copy is made before anything
+		//is freed, so if copying an item throws this map is left as it was (this also makes assigning a map to
+		//itself safe)
+		UnorderedMap& operator=(const UnorderedMap& other)
 		{
-			unsigned long long int hash = hashGen(key);
+			if (&other != this)
+			{
+				UnorderedMap temp(other, mAllocator);
+				swap(temp);
+			}
+			return *this;
+		}
 
-			int ind = hash % mCapacity;
+		//frees this map's table and "steals" other's in O(1), leaving other empty (as the move constructor does)
+		UnorderedMap& operator=(UnorderedMap&& other) noexcept
+		{
+			if (&other != this)
+			{
+				UnorderedMap temp(std::move(other));
+				swap(temp);
+			}
+			return *this;
+		}
+
+		//exchanges the contents (and allocators) of two maps in O(1) -- no items are copied, moved or re-hashed
+		void swap(UnorderedMap& other) noexcept
+		{
+			std::swap(mTableData, other.mTableData);
+			std::swap(mControl, other.mControl);
+			std::swap(mProbeDistance, other.mProbeDistance);
+			std::swap(mStoredHash, other.mStoredHash);
+			std::swap(mSize, other.mSize);
+			std::swap(mCapacity, other.mCapacity);
+			std::swap(mHashGenerator, other.mHashGenerator);
+			std::swap(mShift, other.mShift);
+			std::swap(mMaxLoadFactor, other.mMaxLoadFactor);
+			std::swap(mMapping, other.mMapping);
+			swap_allocators(other);
+#if SSUDS_UNORDERED_MAP_STATS
+			mCounters.swap(other.mCounters);
+#endif
+		}
 
+		friend void swap(UnorderedMap& a, UnorderedMap& b) noexcept
+		{
+			a.swap(b);
+		}
+		
+
+		//first creates a hash using hashGen, given the key passed in for the function. it then walks the probe
+		//chain starting at the home slot (the top bits of the hash).  If it finds a slot holding the key, it
+		//returns an iterator object for that indexed location, otherwise it returns the end() iterator.
+		//With std::string keys, key may also be a std::string_view or const char* (no std::string is made)
+		unorderMapIterator find(const K& key)
+		{
+			return find<K>(key);
+		}
+
+		template <class Q, enable_if_lookup_key<Q> = 0>
+		unorderMapIterator find(const Q& key)
+		{
 			if (mSize == 0)
-			{
 				return end();
-			}
+
+			bool found;
+			unsigned int dist;
+			unsigned int ind = probe(key, hashGen(key), found, dist);
+			if (found)
+				return unorderMapIterator(ind, mTableData, mControl, mCapacity);
 			else
+				return end();
+		}
+
+		//looks up num_keys keys at once, setting values[i] to point at the value for keys[i] (or nullptr if it isn't
+		//there).  The keys are done msBatchSize at a time: all of a batch's hash codes are computed and their home
+		//slots prefetched first, so the cache misses for the whole batch overlap instead of each find waiting for
+		//its own.  The pointers are good until the map is next changed
+		template <class Q, enable_if_lookup_key<Q> = 0>
+		void find_batch(const Q* keys, unsigned int num_keys, V** values)
+		{
+			unsigned long long hashes[msBatchSize];
+			for (unsigned int start = 0; start < num_keys; start += msBatchSize)
 			{
-				if (mTableUsed[ind] != false)
+				unsigned int stop = num_keys - start < msBatchSize ? num_keys : start + msBatchSize;
+				if (mSize == 0)
 				{
-					return unorderMapIterator(ind, mTableData, mTableUsed, mCapacity);
+					for (unsigned int i = start; i < stop; i++)
+						values[i] = nullptr;
+					continue;
 				}
-				else
+				prefetch_homes(keys, start, stop, hashes);
+				for (unsigned int i = start; i < stop; i++)
 				{
-					return end();
+					bool found;
+					unsigned int dist;
+					unsigned int ind = probe(keys[i], hashes[i - start], found, dist);
+					values[i] = found ? &mTableData[ind].second : nullptr;
 				}
 			}
 		}
 
-		//first creates a hash using hashGen, given the key passed in for the function. it then finds the index location
-		//by taking the modulo of hash and mCapacity. If the Size of the current map is 0 or the indexed value has a 
-		//mTableUsed of false. If truem it will loop through to check to see if the mTableData's first item at that index is the
-		//same as the given key, set the used for that index to false and decrease the size and set found to true. Then copy the 
-		//map into a temp, and swap it back into the original in the proper index slots
+		//like find_batch, but just sets results[i] to whether keys[i] is in the map.  Returns how many were
+		template <class Q, enable_if_lookup_key<Q> = 0>
+		unsigned int contains_batch(const Q* keys, unsigned int num_keys, bool* results)
+		{
+			unsigned long long hashes[msBatchSize];
+			unsigned int num_found = 0;
+			for (unsigned int start = 0; start < num_keys; start += msBatchSize)
+			{
+				unsigned int stop = num_keys - start < msBatchSize ? num_keys : start + msBatchSize;
+				if (mSize == 0)
+				{
+					for (unsigned int i = start; i < stop; i++)
+						results[i] = false;
+					continue;
+				}
+				prefetch_homes(keys, start, stop, hashes);
+				for (unsigned int i = start; i < stop; i++)
+				{
+					unsigned int dist;
+					probe(keys[i], hashes[i - start], results[i], dist);
+					num_found += results[i];
+				}
+			}
+			return num_found;
+		}
+
+		//finds the slot holding the given key, destroys its pair and marks it as unused, decreasing the size.  Any
+		//items later in the same cluster that could live closer to their home slot are shifted back into the hole
+		//(backward-shift deletion), so the probe chains stay intact without tombstones.  This costs O(probe length)
+		//and never allocates.  Returns false if the key was not in the map
 		bool remove(const K& key)
 		{
-			unsigned long long hash = hashGen(key);
+			return remove<K>(key);
+		}
 
-			unsigned long long ind = hash % mCapacity;
+		template <class Q, enable_if_lookup_key<Q> = 0>
+		bool remove(const Q& key)
+		{
+			if (mSize == 0)
+				return false;
 
-			bool found = false;
-			if (mSize == 0 || mTableUsed[ind] == false)
-			{
+			bool found;
+			unsigned int dist;
+			unsigned int hole = probe(key, hashGen(key), found, dist);
+			if (!found)
 				return false;
-			}
 
-			for (unsigned int i = 0; i < mCapacity; i++)
+			mTableData[hole].~pair();
+			close_hole(hole);
+			mSize--;
+			return true;
+		}
+
+		//returns the maximum load factor (size / capacity) the map will reach before growing
+		float max_load_factor() const
+		{
+			return mMaxLoadFactor;
+		}
+
+		//sets a new maximum load factor, which must be in the range (0, 1) since open addressing needs at
+		//least one unused slot.  The table grows immediately if it is now over the new limit
+		void max_load_factor(float mlf)
+		{
+			if (!(mlf > 0.0f && mlf < 1.0f))
+				throw std::invalid_argument("Invalid max load factor: " + std::to_string(mlf));
+			mMaxLoadFactor = mlf;
+			if (mSize > mCapacity * mMaxLoadFactor)
+				rehash(mCapacity);
+		}
+
+		//returns the current load factor (size / capacity) of the UnorderedMap
+		float load_factor() const
+		{
+			if (mCapacity == 0)
+				return 0.0f;
+			return (float)mSize / mCapacity;
+		}
+
+		//makes sure the map can hold num_items without growing again (useful before a bulk load of a known size)
+		void reserve(unsigned int num_items)
+		{
+			if (min_capacity_for(num_items) > mCapacity)
+				rehash((unsigned int)min_capacity_for(num_items));
+		}
+
+		//rebuilds the table with a capacity of at least new_capacity (rounded up to a power of two, and never so
+		//small that the current items would go over the max load factor).  Every item is moved into its new home
+		//slot, so this is O(capacity).  Doubling on growth keeps inserts amortized O(1)
+		void rehash(unsigned int new_capacity)
+		{
+#if SSUDS_UNORDERED_MAP_STATS
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+#endif
+			unsigned long long needed = min_capacity_for(mSize);
+			unsigned int cap = round_up_capacity(new_capacity > needed ? new_capacity : needed);
+
+			std::pair<K, V>* old_data = mTableData;
+			unsigned char* old_control = mControl;
+			unsigned int* old_distance = mProbeDistance;
+			typename HashStorage::hash_type* old_hash = mStoredHash;
+			unsigned int old_capacity = mCapacity;
+
+			allocate_table(cap);
+			for (unsigned int i = 0; i < old_capacity; i++)
 			{
-				if (mTableUsed[i] == true && mTableData[i].first == key)
+				if (ControlGroup::is_full(old_control[i]))
 				{
-					mTableUsed[i] = false;
-					mSize--;
-					found = true;
+					// With stored hashes this is just a move -- the old control byte already has the fragment
+					unsigned long long hash = HashStorage::msStoreHash ? (unsigned long long)old_hash[i] << msStoredHashShift : hashGen(old_data[i].first);
+					insert_unique(std::move(old_data[i]), hash, old_control[i]);
+					old_data[i].~pair();
 				}
 			}
 
-			if (found == true)
+			free_arrays(old_data, old_control, old_distance, old_hash, old_capacity);
+#if SSUDS_UNORDERED_MAP_STATS
+			mCounters.count_rehash(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+#endif
+		}
+
+		//writes the whole table (control bytes, slots, probe distances / stored hashes and sizes) to a snapshot file
+		//at path (see SnapshotHeader), replacing any file that is there.  open_mapped can use the file directly,
+		//without re-inserting anything.  Only for trivially copyable K and V, which can be saved byte for byte.
+		//Throws a std::runtime_error if the file can't be written
+		void save(const std::string& path) const
+		{
+			static_assert(std::is_trivially_copyable<K>::value && std::is_trivially_copyable<V>::value,
+				"Only maps with trivially copyable keys and values can be saved");
+
+			SnapshotHeader header;
+			std::memset(&header, 0, sizeof(header));
+			std::memcpy(header.mMagic, SnapshotHeader::msMagic, sizeof(header.mMagic));
+			header.mVersion = SnapshotHeader::msVersion;
+			header.mByteOrder = SnapshotHeader::msByteOrder;
+			header.mKeySize = sizeof(K);
+			header.mValueSize = sizeof(V);
+			header.mSlotSize = sizeof(std::pair<K, V>);
+			header.mSlotAlignment = alignof(std::pair<K, V>);
+			header.mProbeDistanceSize = Probing::msRobinHood ? sizeof(unsigned int) : 0;
+			header.mStoredHashSize = HashStorage::msStoreHash ? sizeof(typename HashStorage::hash_type) : 0;
+			header.mCapacity = mCapacity;
+			header.mSize = mSize;
+			header.mMaxLoadFactor = mMaxLoadFactor;
+			header.mControlBytes = mCapacity == 0 ? 0 : mCapacity + SnapshotHeader::msControlPadding;
+
+			SnapshotWriter writer(path);
+			header.mControlOffset = writer.align();
+			writer.write(mControl, mCapacity);
+			for (unsigned int i = mCapacity; i < header.mControlBytes; i++)
+				writer.write(&mControl[i % mCapacity], 1);
+
+			// Unused slots (and their distances / hashes) are saved as zeros so the same map always makes the same file
+			static const unsigned char zeros[sizeof(std::pair<K, V>)] = {};
+			header.mSlotsOffset = writer.align();
+			bool first = true;
+			for (unsigned int i = 0; i < mCapacity; i++)
 			{
-				UnorderedMap<K, V> temp(mCapacity);
-				for (unsigned int i = 0; i < mCapacity; i++)
+				bool full = ControlGroup::is_full(mControl[i]);
+				writer.write(full ? (const void*)&mTableData[i] : (const void*)zeros, sizeof(std::pair<K, V>));
+				if (full && first)
 				{
-					if (mTableUsed[i] == true)
-					{
-						temp.mTableData[i] = mTableData[i];
-						temp.mSize++;
-					}
-					else
-					{
-						i++;
-					}
+					header.mHashCheck = hashGen(mTableData[i].first);
+					first = false;
 				}
-				std::swap(mTableData, temp.mTableData);
-				std::swap(mTableUsed, temp.mTableUsed);
-				mSize = temp.mSize;
 			}
-			else
+			if (Probing::msRobinHood)
 			{
-				return false;
+				header.mProbeDistanceOffset = writer.align();
+				for (unsigned int i = 0; i < mCapacity; i++)
+					writer.write(ControlGroup::is_full(mControl[i]) ? (const void*)&mProbeDistance[i] : (const void*)zeros, sizeof(unsigned int));
 			}
+			if (HashStorage::msStoreHash)
+			{
+				header.mStoredHashOffset = writer.align();
+				for (unsigned int i = 0; i < mCapacity; i++)
+					writer.write(ControlGroup::is_full(mControl[i]) ? (const void*)&mStoredHash[i] : (const void*)zeros, header.mStoredHashSize);
+			}
+			writer.finish(header);
 		}
 
-		//when a ostream is used, sets the output to look like, {K1: V1, K2: V2, ... , Kn: Vn}
-		friend std::ostream& operator<<(std::ostream& os, const UnorderedMap& M)
+		//opens a file written by save (by a map of exactly this type) by memory-mapping it: nothing is read or
+		//copied up front, pages of the table are just loaded from disk the first time they're used.  The map can be
+		//changed like any other (changed pages become private copies -- the file is never written), and the first
+		//rehash moves it off the file.  Only the header is checked by default; set verify_checksum to true to also
+		//check the data checksum, which means reading the whole file before returning (so nothing is loaded lazily).
+		//Throws a std::runtime_error if the file can't be mapped, is corrupt, or was saved by a different kind of
+		//map.  alloc is used once the map moves off the file
+		static UnorderedMap open_mapped(const std::string& path, bool verify_checksum = false, const Hash& hash_function = Hash(),
+			const Allocator& alloc = Allocator())
 		{
-			os << "{";
+			static_assert(std::is_trivially_copyable<K>::value && std::is_trivially_copyable<V>::value,
+				"Only maps with trivially copyable keys and values can be opened from a snapshot");
 
-			for (unsigned int i = 0; i < M.capacity(); i++)
+			MappedFile* mapping = new MappedFile(path);
+			const SnapshotHeader* header = (const SnapshotHeader*)mapping->data();
+			try
 			{
-				if (M.mTableUsed[i] == true)
-				{
-					if (i != M.capacity() - 1)
-					{
-						os << M.mTableData[i].first << ":" << M.mTableData[i].second << ", ";
-					}
-					else
-					{
-						os << M.mTableData[i].first << ":" << M.mTableData[i].second ;
-					}
-				}
-				else
+				if (mapping->size() < sizeof(SnapshotHeader))
+					throw std::runtime_error("Snapshot is corrupt or truncated: " + path);
+				header->check(path, mapping->size());
+				if (header->mKeySize != sizeof(K) || header->mValueSize != sizeof(V) || header->mSlotSize != sizeof(std::pair<K, V>) ||
+					header->mSlotAlignment != alignof(std::pair<K, V>) ||
+					header->mProbeDistanceSize != (Probing::msRobinHood ? sizeof(unsigned int) : 0) ||
+					header->mStoredHashSize != (HashStorage::msStoreHash ? sizeof(typename HashStorage::hash_type) : 0))
+					throw std::runtime_error("Snapshot was saved by a different kind of map: " + path);
+				unsigned long long cap = header->mCapacity;
+				if ((cap & (cap - 1)) != 0 || header->mSize >= (cap > 0 ? cap : 1) ||
+					header->mControlBytes != (cap == 0 ? 0 : cap + SnapshotHeader::msControlPadding) ||
+					header->mControlOffset + header->mControlBytes > mapping->size() ||
+					header->mSlotsOffset + cap * sizeof(std::pair<K, V>) > mapping->size() ||
+					header->mProbeDistanceOffset + cap * header->mProbeDistanceSize > mapping->size() ||
+					header->mStoredHashOffset + cap * header->mStoredHashSize > mapping->size())
+					throw std::runtime_error("Snapshot is corrupt: " + path);
+				if (verify_checksum && snapshot_checksum(mapping->data() + sizeof(SnapshotHeader), mapping->size() - sizeof(SnapshotHeader)) != header->mDataChecksum)
+					throw std::runtime_error("Snapshot is corrupt: " + path);
+			}
+			catch (...)
+			{
+				delete mapping;
+				throw;
+			}
+
+			UnorderedMap result(msMinCapacity, hash_function, alloc);
+			result.free_table();
+			unsigned char* base = mapping->data();
+			result.mMapping = mapping;
+			result.mTableData = (std::pair<K, V>*)(base + header->mSlotsOffset);
+			result.mControl = base + header->mControlOffset;
+			result.mProbeDistance = Probing::msRobinHood ? (unsigned int*)(base + header->mProbeDistanceOffset) : nullptr;
+			result.mStoredHash = HashStorage::msStoreHash ? (typename HashStorage::hash_type*)(base + header->mStoredHashOffset) : nullptr;
+			result.mCapacity = header->mCapacity;
+			result.mShift = shift_for(header->mCapacity);
+			result.mSize = header->mSize;
+			result.mMaxLoadFactor = header->mMaxLoadFactor;
+
+			// The items are only where this program expects them if its hash function agrees with the saving program's
+			for (unsigned int i = 0; i < result.mCapacity; i++)
+			{
+				if (ControlGroup::is_full(result.mControl[i]))
 				{
-					i++;
+					if (result.hashGen(result.mTableData[i].first) != header->mHashCheck)
+						throw std::runtime_error("Snapshot was saved with a different hash function: " + path);
+					break;
 				}
 			}
+			return result;
+		}
 
+		//when a ostream is used, sets the output to look like, {K1:V1, K2:V2, ... , Kn:Vn}
+		friend std::ostream& operator<<(std::ostream& os, const UnorderedMap& M)
+		{
+			os << "{";
+			bool first = true;
+			for (unorderMapIterator it = M.iterator_at(0); it != M.iterator_at(M.mCapacity); ++it)
+			{
+				if (!first)
+					os << ", ";
+				os << (*it).first << ":" << (*it).second;
+				first = false;
+			}
 			os << "}";
 			return os;
 		}
@@ -233,47 +1155,188 @@ namespace ssuds
 			return mCapacity;
 		}
 
-		// Take K, generate the hash code using mHashGenerator.
-		// Mod the hash code with the table capacity to get desired spot
-		// possibly loop until we either find an "empty" spot or a pair
-		// with the_key.  Then...
-
-		// If we found an empty spot, make a new key-value pair
-		// with the given key and an UNINITIALIZED value and return a reference to that new value.
+		//returns a copy of the allocator the table's arrays come from
+		Allocator get_allocator() const
+		{
+			return mAllocator;
+		}
 
-		// If we found a non-empty spot, return the value of the existing pair
-		V& operator[](const K& the_key)
+		//returns the largest distance (in slots) any item is from its home slot, which bounds how far a lookup
+		//can probe.  This looks at every slot, so it is O(capacity)
+		unsigned int max_probe_distance() const
 		{
-			unsigned long long hash = hashGen(the_key);
+			unsigned int result = 0;
+			for (unsigned int i = 0; i < mCapacity; i++)
+			{
+				if (ControlGroup::is_full(mControl[i]) && probe_distance(i) > result)
+					result = probe_distance(i);
+			}
+			return result;
+		}
 
-			unsigned long long ind = hash % mCapacity;
+		//returns the average distance (in slots) the items are from their home slots (0 for an empty map).  This
+		//looks at every slot, so it is O(capacity)
+		double mean_probe_distance() const
+		{
+			if (mSize == 0)
+				return 0.0;
+			unsigned long long total = 0;
 			for (unsigned int i = 0; i < mCapacity; i++)
 			{
-				if (mTableUsed[ind] == true)
+				if (ControlGroup::is_full(mControl[i]))
+					total += probe_distance(i);
+			}
+			return (double)total / mSize;
+		}
+
+		//returns a snapshot of the table's shape (cluster lengths and how far items are from their home slots) and,
+		//with SSUDS_UNORDERED_MAP_STATS, of the lookup and rehash counters -- see UnorderedMapStats, which can
+		//also be written to an ostream.  This looks at every slot, so it is O(capacity)
+		UnorderedMapStats stats() const
+		{
+			UnorderedMapStats result = {};
+			result.mSize = mSize;
+			result.mCapacity = mCapacity;
+			result.mLoadFactor = load_factor();
+			result.mMaxLoadFactor = mMaxLoadFactor;
+			if (mCapacity > 0)
+			{
+				// Runs are counted from just after an unused slot (there always is one), so a cluster that wraps
+				// around the end of the table is counted as one
+				unsigned int mask = mCapacity - 1;
+				unsigned int start = 0;
+				while (ControlGroup::is_full(mControl[start]))
+					start++;
+				unsigned int run = 0;
+				for (unsigned int i = (start + 1) & mask; i != start; i = (i + 1) & mask)
 				{
-					if (mTableData[ind].first == the_key)
-					{
-						return mTableData[ind].second;
-					}
-					
-					else if (ind < mCapacity)
+					if (!ControlGroup::is_full(mControl[i]))
 					{
-						ind++;
+						run = 0;
+						continue;
 					}
-					else
-					{
-						ind = 0;
-					}
-				}
-				else if (mTableUsed[ind] == false)
-				{
-					mTableData[ind].first = the_key;
-					mSize++;
-					mTableUsed[ind] = true;
-					return mTableData[ind].second;
+					run++;
+					if (run > result.mMaxClusterLength)
+						result.mMaxClusterLength = run;
+					unsigned int dist = probe_distance(i);
+					result.mDisplacement[dist < UnorderedMapStats::msHistogramSize ? dist : UnorderedMapStats::msHistogramSize - 1]++;
 				}
 			}
-			
+#if SSUDS_UNORDERED_MAP_STATS
+			mCounters.fill(result);
+#endif
+			return result;
+		}
+
+		// Take K, generate the hash code using mHashGenerator.
+		// The top log2(capacity) bits of the (fibonacci-hashed) hash code are the desired spot
+		// loop (a group of control bytes at a time) until we either find an "empty" spot or a pair
+		// with the_key.  Then...
+
+		// If we found an empty spot, construct a new key-value pair there with the given key and a
+		// value-initialized value and return a reference to that new value.
+		// If adding the pair would put us over the max load factor, the table doubles in size first.
+
+		// If we found a non-empty spot, return the value of the existing pair
+
+		// With std::string keys, the_key may also be a std::string_view or const char*.  A std::string is only
+		// made from it if a new pair has to be added
+		V& operator[](const K& the_key)
+		{
+			// (emplace_unique may grow the table, so mTableData can only be looked at after it returns)
+			unsigned int ind = emplace_unique(the_key, the_key).first;
+			return mTableData[ind].second;
+		}
+
+		V& operator[](K&& the_key)
+		{
+			unsigned int ind = emplace_unique(the_key, std::move(the_key)).first;
+			return mTableData[ind].second;
+		}
+
+		template <class Q, typename std::enable_if<_is_transparent_key<Hash, K, Q>::value, int>::type = 0>
+		V& operator[](const Q& the_key)
+		{
+			unsigned int ind = emplace_unique(the_key, the_key).first;
+			return mTableData[ind].second;
+		}
+
+		//if key isn't in the map, adds a pair whose value is constructed in place from args (nothing is made if
+		//the key is already there -- args are left alone).  Returns an iterator to the pair with this key and true
+		//if it was added.  As with operator[], key may be a transparent lookup key like a std::string_view
+		template <class... Args>
+		std::pair<unorderMapIterator, bool> try_emplace(const K& key, Args&&... args)
+		{
+			return make_result(emplace_unique(key, key, std::forward<Args>(args)...));
+		}
+
+		template <class... Args>
+		std::pair<unorderMapIterator, bool> try_emplace(K&& key, Args&&... args)
+		{
+			return make_result(emplace_unique(key, std::move(key), std::forward<Args>(args)...));
+		}
+
+		template <class Q, class... Args, typename std::enable_if<_is_transparent_key<Hash, K, Q>::value, int>::type = 0>
+		std::pair<unorderMapIterator, bool> try_emplace(const Q& key, Args&&... args)
+		{
+			return make_result(emplace_unique(key, key, std::forward<Args>(args)...));
+		}
+
+		//like try_emplace, except key can be anything a K can be constructed from.  If it isn't a K (or a transparent
+		//lookup key), a K is made from it first to do the lookup, and then moved into the new pair
+		template <class KArg, class... Args>
+		std::pair<unorderMapIterator, bool> emplace(KArg&& key, Args&&... args)
+		{
+			typedef typename std::decay<KArg>::type key_arg_type;
+			if constexpr (std::is_same<key_arg_type, K>::value || _is_transparent_key<Hash, K, key_arg_type>::value)
+				return make_result(emplace_unique(key, std::forward<KArg>(key), std::forward<Args>(args)...));
+			else
+			{
+				K lookup_key(std::forward<KArg>(key));
+				return make_result(emplace_unique(lookup_key, std::move(lookup_key), std::forward<Args>(args)...));
+			}
+		}
+
+		//sets the value for key to value, adding a new pair (with the value constructed in place) if key isn't
+		//there yet.  Returns an iterator to the pair with this key and true if it was added
+		template <class M>
+		std::pair<unorderMapIterator, bool> insert_or_assign(const K& key, M&& value)
+		{
+			return assign_result(emplace_unique(key, key, std::forward<M>(value)), std::forward<M>(value));
+		}
+
+		template <class M>
+		std::pair<unorderMapIterator, bool> insert_or_assign(K&& key, M&& value)
+		{
+			return assign_result(emplace_unique(key, std::move(key), std::forward<M>(value)), std::forward<M>(value));
+		}
+
+		template <class Q, class M, typename std::enable_if<_is_transparent_key<Hash, K, Q>::value, int>::type = 0>
+		std::pair<unorderMapIterator, bool> insert_or_assign(const Q& key, M&& value)
+		{
+			return assign_result(emplace_unique(key, key, std::forward<M>(value)), std::forward<M>(value));
+		}
+	private:
+		//turns the result of emplace_unique into what try_emplace / emplace return
+		std::pair<unorderMapIterator, bool> make_result(std::pair<unsigned int, bool> result)
+		{
+			return std::pair<unorderMapIterator, bool>(unorderMapIterator(result.first, mTableData, mControl, mCapacity), result.second);
+		}
+
+		//the rest of insert_or_assign: if emplace_unique found an existing pair, assigns value to it
+		template <class M>
+		std::pair<unorderMapIterator, bool> assign_result(std::pair<unsigned int, bool> result, M&& value)
+		{
+			if (!result.second)
+				mTableData[result.first].second = std::forward<M>(value);
+			return make_result(result);
 		}
 	};
+
+	namespace pmr
+	{
+		//an UnorderedMap whose table comes from a std::pmr::memory_resource (e.g. an ssuds::MonotonicArena)
+		template <class K, class V, class Hash = FastHash<K>, class Probing = LinearProbing, class HashStorage = NoStoredHash>
+		using UnorderedMap = ssuds::UnorderedMap<K, V, Hash, Probing, HashStorage, std::pmr::polymorphic_allocator<std::pair<K, V>>>;
+	}
 }
@@ -0,0 +1,160 @@
+#pragma once
+#include <atomic>
+#include <ostream>
+
+// Define SSUDS_UNORDERED_MAP_STATS as 1 (for the whole build, or before including any ssuds map) to have every
+// UnorderedMap count its lookups, their probe lengths and its rehashes (see UnorderedMap::stats).  It is off by
+// default, and then none of the counting code is compiled in.
+#ifndef SSUDS_UNORDERED_MAP_STATS
+#define SSUDS_UNORDERED_MAP_STATS 0
+#endif
+
+namespace ssuds
+{
+	/// <summary>
+	/// A snapshot of how an UnorderedMap is doing (see UnorderedMap::stats).  The table's shape (sizes, clusters,
+	/// how far items are from their home slots) is always filled in.  The traffic counters (lookups, their probe
+	/// lengths and rehashes) are only kept when SSUDS_UNORDERED_MAP_STATS is on -- otherwise they are all 0 and
+	/// mCountersEnabled is false.
+	/// </summary>
+	struct UnorderedMapStats
+	{
+		/// Histograms have one bucket per probe length up to msHistogramSize - 2; the last bucket counts all
+		/// longer ones
+		static const unsigned int msHistogramSize = 16;
+
+		unsigned int mSize;
+		unsigned int mCapacity;
+		float mLoadFactor;
+		float mMaxLoadFactor;
+
+		/// The longest run of used slots (with no unused slot in it)
+		unsigned int mMaxClusterLength;
+
+		/// How many items are each distance (in slots) from their home slot
+		unsigned long long mDisplacement[msHistogramSize];
+
+		/// True if the map was built with SSUDS_UNORDERED_MAP_STATS on (so the rest is filled in)
+		bool mCountersEnabled;
+
+		/// Every key lookup (find, find_batch, contains_batch, remove and the lookup that starts every insert), and
+		/// how many of them found the key
+		unsigned long long mLookups;
+		unsigned long long mHits;
+		unsigned long long mMisses;
+
+		/// How many lookups stopped each distance (in slots) from the key's home slot: where the key was, or where
+		/// the lookup gave up
+		unsigned long long mProbeLengths[msHistogramSize];
+
+		/// How many times the table was rebuilt, and the total time that took
+		unsigned long long mRehashes;
+		double mRehashSeconds;
+
+		/// The mean distance from the home slot over all lookups (0 if there were none)
+		double mean_probe_length() const
+		{
+			unsigned long long total = 0;
+			for (unsigned int i = 0; i < msHistogramSize; i++)
+				total += i * mProbeLengths[i];
+			return mLookups == 0 ? 0.0 : (double)total / mLookups;
+		}
+
+		/// Writes a few lines summing up the stats (histograms are written as distance:count, skipping zeros)
+		friend std::ostream& operator<<(std::ostream& os, const UnorderedMapStats& s)
+		{
+			os << "size " << s.mSize << " / capacity " << s.mCapacity << " (load factor " << s.mLoadFactor << ", max " << s.mMaxLoadFactor << ")\n";
+			os << "longest cluster " << s.mMaxClusterLength << ", items by distance from home:";
+			write_histogram(os, s.mDisplacement);
+			os << "\n";
+			if (!s.mCountersEnabled)
+				return os << "(lookups and rehashes aren't counted: build with SSUDS_UNORDERED_MAP_STATS defined as 1)\n";
+			os << "lookups " << s.mLookups << " (hits " << s.mHits << ", misses " << s.mMisses << "), mean probe length " << s.mean_probe_length();
+			os << ", lookups by probe length:";
+			write_histogram(os, s.mProbeLengths);
+			os << "\n";
+			return os << "rehashes " << s.mRehashes << " (" << s.mRehashSeconds << " s)\n";
+		}
+
+	protected:
+		static void write_histogram(std::ostream& os, const unsigned long long* histogram)
+		{
+			for (unsigned int i = 0; i < msHistogramSize; i++)
+			{
+				if (histogram[i] != 0)
+					os << " " << i << (i == msHistogramSize - 1 ? "+:" : ":") << histogram[i];
+			}
+		}
+	};
+
+
+	/// <summary>
+	/// The traffic counters an UnorderedMap keeps when SSUDS_UNORDERED_MAP_STATS is on.  A lookup in a const
+	/// map is counted too, and several threads may be reading a map at once (e.g. a ConcurrentUnorderedMap shard),
+	/// so the counters are atomics -- but they are bumped with a relaxed load and store rather than a (much slower)
+	/// locked add, so counts can come up a little short while threads are racing.
+	/// </summary>
+	struct _UnorderedMapCounters
+	{
+		std::atomic<unsigned long long> mLookups;
+		std::atomic<unsigned long long> mHits;
+		std::atomic<unsigned long long> mProbeLengths[UnorderedMapStats::msHistogramSize];
+		std::atomic<unsigned long long> mRehashes;
+		std::atomic<unsigned long long> mRehashNanoseconds;
+
+		_UnorderedMapCounters() : mLookups(0), mHits(0), mRehashes(0), mRehashNanoseconds(0)
+		{
+			for (unsigned int i = 0; i < UnorderedMapStats::msHistogramSize; i++)
+				mProbeLengths[i] = 0;
+		}
+
+		static void add(std::atomic<unsigned long long>& counter, unsigned long long amount)
+		{
+			counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+		}
+
+		void count_lookup(bool hit, unsigned int probe_length)
+		{
+			add(mLookups, 1);
+			add(mHits, hit);
+			if (probe_length >= UnorderedMapStats::msHistogramSize)
+				probe_length = UnorderedMapStats::msHistogramSize - 1;
+			add(mProbeLengths[probe_length], 1);
+		}
+
+		void count_rehash(unsigned long long nanoseconds)
+		{
+			add(mRehashes, 1);
+			add(mRehashNanoseconds, nanoseconds);
+		}
+
+		/// Fills in the counter part of stats
+		void fill(UnorderedMapStats& stats) const
+		{
+			stats.mCountersEnabled = true;
+			stats.mLookups = mLookups.load(std::memory_order_relaxed);
+			stats.mHits = mHits.load(std::memory_order_relaxed);
+			stats.mMisses = stats.mLookups - stats.mHits;
+			for (unsigned int i = 0; i < UnorderedMapStats::msHistogramSize; i++)
+				stats.mProbeLengths[i] = mProbeLengths[i].load(std::memory_order_relaxed);
+			stats.mRehashes = mRehashes.load(std::memory_order_relaxed);
+			stats.mRehashSeconds = mRehashNanoseconds.load(std::memory_order_relaxed) / 1e9;
+		}
+
+		/// Exchanges two maps' counters (not atomically -- the maps are being swapped, so nobody is using them)
+		void swap(_UnorderedMapCounters& other)
+		{
+			exchange(mLookups, other.mLookups);
+			exchange(mHits, other.mHits);
+			for (unsigned int i = 0; i < UnorderedMapStats::msHistogramSize; i++)
+				exchange(mProbeLengths[i], other.mProbeLengths[i]);
+			exchange(mRehashes, other.mRehashes);
+			exchange(mRehashNanoseconds, other.mRehashNanoseconds);
+		}
+
+		static void exchange(std::atomic<unsigned long long>& a, std::atomic<unsigned long long>& b)
+		{
+			a = b.exchange(a.load());
+		}
+	};
+}
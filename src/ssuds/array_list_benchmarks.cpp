@@ -0,0 +1,190 @@
+#include <gtest/gtest.h>
+#include <array_list.h>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// These aren't really tests -- they time ssuds::ArrayList (and std::vector) and print the results.  They take a
+// while (and should be run in Release), so they are off by default.
+#define DO_ARRAY_LIST_BENCHMARKS 0
+#if DO_ARRAY_LIST_BENCHMARKS
+
+namespace
+{
+	/// Runs func once and returns the elapsed time in nanoseconds per operation
+	template <class F>
+	double time_per_op(unsigned int num_ops, F func)
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		func();
+		std::chrono::steady_clock::time_point stop = std::chrono::steady_clock::now();
+		return std::chrono::duration<double, std::nano>(stop - start).count() / num_ops;
+	}
+
+	/// Appends num items, then goes back and forth between removing and appending `swing` items across the size
+	/// the list last grew at, and prints the time per operation and how many times the array was reallocated
+	template <class L>
+	void run_oscillation_benchmark(const char* label, unsigned int num, unsigned int swing, unsigned int rounds)
+	{
+		L list;
+		unsigned int reallocations = 0;
+		unsigned int last_capacity = 0;
+		auto count = [&]() {
+			if (list.capacity() != last_capacity)
+				reallocations++;
+			last_capacity = list.capacity();
+			};
+		double append_ns = time_per_op(num, [&]() {
+			for (unsigned int i = 0; i < num; i++)
+			{
+				list.append(std::to_string(i));
+				count();
+			}
+			});
+		unsigned int grow_reallocations = reallocations;
+		double oscillate_ns = time_per_op(2 * swing * rounds, [&]() {
+			for (unsigned int r = 0; r < rounds; r++)
+			{
+				for (unsigned int i = 0; i < swing; i++)
+				{
+					list.remove(list.size() - 1);
+					count();
+				}
+				for (unsigned int i = 0; i < swing; i++)
+				{
+					list.append(std::to_string(i));
+					count();
+				}
+			}
+			});
+		std::cout << label << "\tappend " << append_ns << " ns (" << grow_reallocations << " reallocations)\toscillate " << oscillate_ns <<
+			" ns (" << reallocations - grow_reallocations << " reallocations)\tcapacity " << list.capacity() << std::endl;
+	}
+}
+
+TEST(ArrayListBenchmarks, append_remove_oscillation)
+{
+	// The size starts just past the boundary the list grew at (5 * 2^k + 1), and swings down and back across
+	// half of that capacity.  Shrinking as soon as the list was under half full used to reallocate twice per round
+	const unsigned int num = 5 * 65536 + 1;
+	const unsigned int swing = 2 * 65536;
+	const unsigned int rounds = 20;
+	run_oscillation_benchmark<ssuds::ArrayList<std::string>>("doubling", num, swing, rounds);
+	run_oscillation_benchmark<ssuds::ArrayList<std::string, std::allocator<std::string>, ssuds::HalfAgainGrowth>>("1.5x    ", num, swing, rounds);
+	run_oscillation_benchmark<ssuds::ArrayList<std::string, std::allocator<std::string>, ssuds::PageGrowth<>>>("paged   ", num, swing, rounds);
+
+	// The same swing with a reserve up front never reallocates
+	ssuds::ArrayList<std::string> reserved;
+	reserved.reserve(num);
+	double reserved_ns = time_per_op(2 * swing * rounds, [&]() {
+		for (unsigned int i = 0; i < num; i++)
+			reserved.append(std::to_string(i));
+		for (unsigned int r = 0; r < rounds; r++)
+		{
+			for (unsigned int i = 0; i < swing; i++)
+				reserved.remove(reserved.size() - 1);
+			for (unsigned int i = 0; i < swing; i++)
+				reserved.append(std::to_string(i));
+		}
+		});
+	std::cout << "reserved\t" << reserved_ns << " ns per op, capacity " << reserved.capacity() << std::endl;
+
+	std::vector<std::string> vec;
+	double vector_ns = time_per_op(2 * swing * rounds, [&]() {
+		for (unsigned int i = 0; i < num; i++)
+			vec.push_back(std::to_string(i));
+		for (unsigned int r = 0; r < rounds; r++)
+		{
+			for (unsigned int i = 0; i < swing; i++)
+				vec.pop_back();
+			for (unsigned int i = 0; i < swing; i++)
+				vec.push_back(std::to_string(i));
+		}
+		});
+	std::cout << "std::vector\t" << vector_ns << " ns per op (never shrinks)" << std::endl;
+}
+
+TEST(ArrayListBenchmarks, bulk_remove_and_append)
+{
+	// Removing every third item: one find + remove per item (each remove shifts the rest of the list down) against
+	// one compacting pass
+	const unsigned int num = 30000;
+	ssuds::ArrayList<std::string> source;
+	for (unsigned int i = 0; i < num; i++)
+		source.append(std::to_string(i % 3));
+
+	ssuds::ArrayList<std::string> one_at_a_time(source);
+	double one_at_a_time_ns = time_per_op(num, [&]() {
+		int index = 0;
+		while ((index = one_at_a_time.find("0", index)) >= 0)
+			one_at_a_time.remove(index, false);
+		});
+	ssuds::ArrayList<std::string> one_pass(source);
+	double one_pass_ns = time_per_op(num, [&]() { one_pass.remove_all("0", false); });
+	std::cout << "remove every 3rd\tfind + remove " << one_at_a_time_ns << " ns per item\tremove_all " << one_pass_ns <<
+		" ns per item" << std::endl;
+
+	// Adding a block of items one at a time against append_range (which makes room once)
+	std::vector<std::string> block(num, "item");
+	ssuds::ArrayList<std::string> appended;
+	double append_ns = time_per_op(num, [&]() {
+		for (const std::string& s : block)
+			appended.append(s);
+		});
+	ssuds::ArrayList<std::string> ranged;
+	double range_ns = time_per_op(num, [&]() { ranged.append_range(block); });
+	std::cout << "append block\tappend " << append_ns << " ns per item\tappend_range " << range_ns << " ns per item" << std::endl;
+}
+
+TEST(ArrayListBenchmarks, find_and_count)
+{
+	// Lists of int ids from 1K to 100M items, searched for a value that isn't there (so every item is looked at).
+	// "scalar" is the one-item-at-a-time loop find used to be.  On a CPU with AVX2 the searches compare 8 ints at a
+	// time; build with -DSSUDS_AVX2_DISPATCH=0 to see the 4-at-a-time SSE2 version
+	std::cout << "items\tscalar find\tfind\tfind_last\tcount\t(ns per item)" << std::endl;
+	for (unsigned int num : { 1000u, 100000u, 10000000u, 100000000u })
+	{
+		ssuds::ArrayList<int> list;
+		list.reserve(num);
+		for (unsigned int i = 0; i < num; i++)
+			list.append((int)(i % 1000));
+		const int missing = -1;
+		const unsigned int rounds = 100000000u / num + 1;
+
+		volatile long long sink = 0;
+		double scalar_ns = time_per_op(num * rounds, [&]() {
+			for (unsigned int r = 0; r < rounds; r++)
+			{
+				const int* items = list.data();
+				int found = -1;
+				for (unsigned int i = 0; i < list.size(); i++)
+				{
+					if (items[i] == missing)
+					{
+						found = i;
+						break;
+					}
+				}
+				sink = sink + found;
+			}
+			});
+		double find_ns = time_per_op(num * rounds, [&]() {
+			for (unsigned int r = 0; r < rounds; r++)
+				sink = sink + list.find(missing);
+			});
+		double find_last_ns = time_per_op(num * rounds, [&]() {
+			for (unsigned int r = 0; r < rounds; r++)
+				sink = sink + list.find_last(missing);
+			});
+		double count_ns = time_per_op(num * rounds, [&]() {
+			for (unsigned int r = 0; r < rounds; r++)
+				sink = sink + list.count(missing);
+			});
+		EXPECT_EQ(list.find(999), 999);
+		EXPECT_EQ(list.count(999), num / 1000);
+		std::cout << num << "\t" << scalar_ns << "\t" << find_ns << "\t" << find_last_ns << "\t" << count_ns << std::endl;
+	}
+}
+
+#endif
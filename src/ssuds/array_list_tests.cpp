@@ -1,7 +1,13 @@
 #include <gtest/gtest.h>
 #include <array_list.h>
-
-#define EXECUTE_ARRAY_LIST_TESTS 0
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#define EXECUTE_ARRAY_LIST_TESTS 1
 #if EXECUTE_ARRAY_LIST_TESTS
 
 
@@ -380,4 +386,367 @@ TEST(ArrayListTests, SimpleIterator)
 	EXPECT_EQ(it, a.end());
 }
 
+// Counts how each instance was made, to check that the ArrayList makes no extra copies
+struct CopyCounter
+{
+	static int msCopies;
+	static int msMoves;
+	int mValue;
+
+	CopyCounter(int value = 0) : mValue(value) {}
+	CopyCounter(const CopyCounter& other) : mValue(other.mValue) { msCopies++; }
+	CopyCounter(CopyCounter&& other) noexcept : mValue(other.mValue) { msMoves++; }
+	CopyCounter& operator=(const CopyCounter& other) { mValue = other.mValue; msCopies++; return *this; }
+	CopyCounter& operator=(CopyCounter&& other) noexcept { mValue = other.mValue; msMoves++; return *this; }
+};
+int CopyCounter::msCopies = 0;
+int CopyCounter::msMoves = 0;
+
+// Same, but its move constructor might throw (so the ArrayList has to copy it when it grows)
+struct ThrowingMoveCounter : CopyCounter
+{
+	ThrowingMoveCounter(int value = 0) : CopyCounter(value) {}
+	ThrowingMoveCounter(const ThrowingMoveCounter& other) = default;
+	ThrowingMoveCounter(ThrowingMoveCounter&& other) noexcept(false) : CopyCounter(std::move(other)) {}
+};
+
+TEST(ArrayListTests, GrowthMovesItems)
+{
+	CopyCounter::msCopies = CopyCounter::msMoves = 0;
+	ssuds::ArrayList<CopyCounter> a;
+	for (int i = 0; i < 100; i++)
+		a.emplace_back(i);
+	EXPECT_EQ(CopyCounter::msCopies, 0);
+	CopyCounter c(100);
+	a.append(std::move(c));
+	a.push_back(CopyCounter(101));
+	EXPECT_EQ(CopyCounter::msCopies, 0);
+	a.append(c);
+	EXPECT_EQ(CopyCounter::msCopies, 1);
+	for (int i = 0; i < 102; i++)
+		EXPECT_EQ(a[i].mValue, i);
+
+	// Items whose move might throw are copied when the array grows
+	ThrowingMoveCounter::msCopies = 0;
+	ssuds::ArrayList<ThrowingMoveCounter> b;
+	for (int i = 0; i < 6; i++)
+		b.emplace_back(i);
+	EXPECT_EQ(CopyCounter::msCopies, 5);
+}
+
+TEST(ArrayListTests, MoveOnlyItems)
+{
+	ssuds::ArrayList<std::unique_ptr<int>> a;
+	for (int i = 0; i < 50; i++)
+		a.push_back(std::make_unique<int>(i));
+	a.insert(std::make_unique<int>(-1), 0);
+	a.insert(std::make_unique<int>(-2), 51);
+	EXPECT_EQ(*a.remove(0), -1);
+	EXPECT_EQ(*a[50], -2);
+	for (int i = 0; i < 50; i++)
+		EXPECT_EQ(*a[i], i);
+	while (a.size() > 1)
+		a.remove(0);
+	EXPECT_EQ(*a[0], -2);
+
+	ssuds::ArrayList<std::unique_ptr<int>> b;
+	b = std::move(a);
+	EXPECT_EQ(a.size(), 0);
+	EXPECT_EQ(*b[0], -2);
+}
+
+TEST(ArrayListTests, AppendOwnItem)
+{
+	// Appending one of the list's own items while it grows
+	ssuds::ArrayList<std::string> a;
+	a.append(std::string(100, 'x'));
+	for (int i = 0; i < 40; i++)
+		a.append(a[0]);
+	EXPECT_EQ(a.size(), 41);
+	EXPECT_EQ(a[40], std::string(100, 'x'));
+	a.emplace_back(a[0], 50);
+	EXPECT_EQ(a[41], std::string(50, 'x'));
+}
+
+TEST(ArrayListTests, ReserveAndShrinkToFit)
+{
+	ssuds::ArrayList<std::string> a;
+	a.reserve(100);
+	EXPECT_EQ(a.capacity(), 100);
+	for (int i = 0; i < 100; i++)
+		a.append(std::to_string(i));
+	EXPECT_EQ(a.capacity(), 100);
+
+	// Never shrunk below what was reserved
+	while (a.size() > 1)
+		a.remove(a.size() - 1);
+	EXPECT_EQ(a.capacity(), 100);
+
+	a.shrink_to_fit();
+	EXPECT_EQ(a.capacity(), 1);
+	EXPECT_EQ(a[0], "0");
+	a.remove(0);
+	a.shrink_to_fit();
+	EXPECT_EQ(a.capacity(), 0);
+	a.append("x");
+	EXPECT_EQ(a[0], "x");
+}
+
+TEST(ArrayListTests, ShrinkHysteresis)
+{
+	ssuds::ArrayList<int> a;
+	for (int i = 0; i < 41; i++)
+		a.append(i);
+	EXPECT_EQ(a.capacity(), 80);
+
+	// Going back and forth across the size we grew at doesn't reallocate
+	for (int i = 0; i < 10; i++)
+	{
+		a.remove(a.size() - 1);
+		EXPECT_EQ(a.capacity(), 80);
+		a.append(i);
+		EXPECT_EQ(a.capacity(), 80);
+	}
+
+	// Under a quarter full, it halves
+	while (a.size() >= 20)
+		a.remove(a.size() - 1);
+	EXPECT_EQ(a.capacity(), 40);
+	for (int i = 0; i < 19; i++)
+		EXPECT_EQ(a[i], i);
+}
+
+TEST(ArrayListTests, GrowthPolicies)
+{
+	ssuds::ArrayList<int, std::allocator<int>, ssuds::HalfAgainGrowth> half;
+	for (int i = 0; i < 6; i++)
+		half.append(i);
+	EXPECT_EQ(half.capacity(), 7);
+	for (int i = 6; i < 8; i++)
+		half.append(i);
+	EXPECT_EQ(half.capacity(), 10);
+
+	ssuds::ArrayList<double, std::allocator<double>, ssuds::PageGrowth<4096>> paged;
+	for (int i = 0; i < 6; i++)
+		paged.append(i);
+	EXPECT_EQ(paged.capacity(), 512);
+	for (int i = 6; i < 513; i++)
+		paged.append(i);
+	EXPECT_EQ(paged.capacity(), 1024);
+	EXPECT_EQ(paged[512], 512.0);
+}
+
+TEST(ArrayListTests, AppendAndInsertRange)
+{
+	ssuds::ArrayList<std::string> a;
+	a.reserve(10);
+	std::vector<std::string> v = { "a", "b", "c" };
+	a.append_range(v);
+	a.append_range(std::initializer_list<std::string>{ "d", "e" });
+	ASSERT_EQ(a.size(), 5);
+	EXPECT_EQ(a.capacity(), 10);
+	EXPECT_EQ(a[4], "e");
+
+	// In place (rotated) and with a reallocation
+	a.insert_range(1, std::initializer_list<std::string>{ "x", "y" });
+	EXPECT_EQ(a.capacity(), 10);
+	a.insert_range(7, ssuds::ArrayList<std::string>{ "z" });
+	a.insert_range(0, std::vector<std::string>(5, "w"));
+	ASSERT_EQ(a.size(), 13);
+	const char* expected[] = { "w", "w", "w", "w", "w", "a", "x", "y", "b", "c", "d", "e", "z" };
+	for (unsigned int i = 0; i < a.size(); i++)
+		EXPECT_EQ(a[i], expected[i]);
+	EXPECT_THROW(a.insert_range(14, v), std::out_of_range);
+	a.insert_range(13, std::vector<std::string>());
+	EXPECT_EQ(a.size(), 13);
+
+	// A list can be added to itself (with and without reallocating)
+	ssuds::ArrayList<std::string> b = { "1", "2", "3" };
+	b.append_range(b);
+	ASSERT_EQ(b.size(), 6);
+	EXPECT_EQ(b[5], "3");
+	b.reserve(20);
+	b.insert_range(1, b);
+	ASSERT_EQ(b.size(), 12);
+	EXPECT_EQ(b[0], "1");
+	EXPECT_EQ(b[1], "1");
+	EXPECT_EQ(b[6], "3");
+	EXPECT_EQ(b[7], "2");
+	EXPECT_EQ(b[11], "3");
+}
+
+TEST(ArrayListTests, EraseRangeAndEraseIf)
+{
+	ssuds::ArrayList<std::string> a;
+	for (int i = 0; i < 10; i++)
+		a.append(std::to_string(i));
+	a.erase_range(2, 5);
+	ASSERT_EQ(a.size(), 7);
+	EXPECT_EQ(a[1], "1");
+	EXPECT_EQ(a[2], "5");
+	EXPECT_EQ(a[6], "9");
+	a.erase_range(3, 3);
+	EXPECT_EQ(a.size(), 7);
+	EXPECT_THROW(a.erase_range(4, 3), std::out_of_range);
+	EXPECT_THROW(a.erase_range(0, 8), std::out_of_range);
+
+	EXPECT_EQ(a.erase_if([](const std::string& s) { return s[0] % 2 == 1; }), 4);
+	ASSERT_EQ(a.size(), 3);
+	EXPECT_EQ(a[0], "0");
+	EXPECT_EQ(a[1], "6");
+	EXPECT_EQ(a[2], "8");
+	EXPECT_EQ(a.erase_if([](const std::string&) { return false; }), 0);
+
+	// Removing nearly everything at once halves the array (like remove would)
+	ssuds::ArrayList<int> b;
+	for (int i = 0; i < 100; i++)
+		b.append(i % 10);
+	EXPECT_EQ(b.remove_all(3), 10);
+	EXPECT_EQ(b.erase_if([](int x) { return x != 5; }), 80);
+	EXPECT_EQ(b.size(), 10);
+	EXPECT_EQ(b.capacity(), 80);
+	b.erase_range(0, b.size());
+	EXPECT_EQ(b.size(), 0);
+}
+
+TEST(ArrayListTests, ContiguousAccess)
+{
+	ssuds::ArrayList<int> empty;
+	EXPECT_EQ(empty.data(), nullptr);
+	EXPECT_EQ(empty.contiguous_begin(), empty.contiguous_end());
+
+	ssuds::ArrayList<int> a = { 5, 3, 9, 1, 7 };
+	EXPECT_EQ(a.data(), &a[0]);
+	EXPECT_EQ(a.contiguous_end() - a.contiguous_begin(), 5);
+	std::sort(a.contiguous_begin(), a.contiguous_end());
+	for (unsigned int i = 0; i < a.size(); i++)
+		EXPECT_EQ(a.at_unchecked(i), 2 * (int)i + 1);
+	const ssuds::ArrayList<int>& ca = a;
+	EXPECT_EQ(std::accumulate(ca.contiguous_begin(), ca.contiguous_end(), 0), 25);
+	a.data()[4] = 10;
+	EXPECT_EQ(a[4], 10);
+#if SSUDS_CHECKED_ACCESS
+	EXPECT_THROW(a.at_unchecked(5), std::out_of_range);
+	EXPECT_THROW(*a.end(), std::out_of_range);
+#endif
+
+#if defined(__cpp_lib_span)
+	std::span<int> view = a;
+	EXPECT_EQ(view.size(), 5);
+	EXPECT_EQ(view[4], 10);
+	std::span<const int> const_view = ca;
+	EXPECT_EQ(const_view.data(), a.data());
+#endif
+}
+
+namespace
+{
+	/// Checks find, find_last and count against a plain loop, for lists of every length up to 100 with val at
+	/// a few different spots (the vectorized searches handle the items in blocks, with leftovers at the end)
+	template <class T>
+	void check_searches(T val, T other)
+	{
+		for (unsigned int n = 0; n <= 100; n++)
+		{
+			for (unsigned int stride : { 1, 7, 33, 1000 })
+			{
+				ssuds::ArrayList<T> a;
+				for (unsigned int i = 0; i < n; i++)
+					a.append(i % stride == stride / 2 ? val : other);
+				int first = -1, last = -1;
+				unsigned int num = 0;
+				for (unsigned int i = 0; i < n; i++)
+				{
+					if (a[i] == val)
+					{
+						if (first < 0)
+							first = i;
+						last = i;
+						num++;
+					}
+				}
+				if (n > 0)
+				{
+					EXPECT_EQ(a.find(val), first);
+					EXPECT_EQ(a.find(val, n - 1), a[n - 1] == val ? (int)n - 1 : -1);
+				}
+				EXPECT_EQ(a.find_last(val), last);
+				EXPECT_EQ(a.count(val), num);
+				EXPECT_EQ(a.count(other), n - num);
+			}
+		}
+	}
+}
+
+TEST(ArrayListTests, FindLastAndCount)
+{
+	check_searches<char>('x', 'y');
+	check_searches<unsigned short>(60000, 1);
+	check_searches<int>(-1, 0);
+	check_searches<unsigned int>(0x80000000u, 0x00000001u);
+	check_searches<long long>(1ll << 40, 1);
+	check_searches<unsigned long long>(0xFFFFFFFF00000000ull, 0xFFFFFFFFull);
+	check_searches<float>(2.5f, -2.5f);
+	check_searches<double>(-0.0, 1e300);
+	check_searches<std::string>("needle", "hay");
+
+	// The searches use ==, so 0.0 matches -0.0 and NaN matches nothing
+	ssuds::ArrayList<double> d = { 1.0, std::nan(""), -0.0, 2.0, 0.0 };
+	EXPECT_EQ(d.find(0.0), 2);
+	EXPECT_EQ(d.find_last(-0.0), 4);
+	EXPECT_EQ(d.count(0.0), 2);
+	EXPECT_EQ(d.count(std::nan("")), 0);
+	EXPECT_EQ(d.find(std::nan("")), -1);
+
+	// Long enough that count has to add up its per-byte tallies more than once
+	ssuds::ArrayList<char> c;
+	for (int i = 0; i < 20000; i++)
+		c.append(i % 3 == 0 ? 'a' : 'b');
+	EXPECT_EQ(c.count('a'), 6667);
+	EXPECT_EQ(c.count('b'), 13333);
+	EXPECT_EQ(c.find_last('a'), 19998);
+}
+
+#if defined(SSUDS_HAVE_AVX2_SEARCH)
+namespace
+{
+	/// Checks the AVX2 searches themselves (which the ArrayList ones only use on an AVX2 CPU) against a plain loop
+	template <class T>
+	void check_avx2_searches(T val, T other)
+	{
+		std::vector<T> items;
+		for (unsigned int n = 0; n <= 300; n++)
+		{
+			const T* p = items.data();
+			unsigned int first = (unsigned int)(std::find(items.begin(), items.end(), val) - items.begin());
+			typename std::vector<T>::reverse_iterator rit = std::find(items.rbegin(), items.rend(), val);
+			unsigned int last = rit == items.rend() ? n : (unsigned int)(items.rend() - rit) - 1;
+			EXPECT_EQ(ssuds::_search_first_avx2(p, n, val), first);
+			EXPECT_EQ(ssuds::_search_last_avx2(p, n, val), last);
+			EXPECT_EQ(ssuds::_search_count_avx2(p, n, val), (unsigned int)std::count(items.begin(), items.end(), val));
+			items.push_back(n % 37 == 5 || n % 11 == 0 ? val : other);
+		}
+	}
+}
+
+TEST(ArrayListTests, SearchDispatch)
+{
+	// A build with AVX2 on always uses the AVX2 searches (and can only run on an AVX2 CPU); otherwise they're picked
+	// when cpuid says the CPU has AVX2
+	EXPECT_EQ(ssuds::_use_avx2_search(), ssuds::cpu_has_avx2());
+#if defined(SSUDS_HAVE_AVX2)
+	EXPECT_TRUE(ssuds::cpu_has_avx2());
+#endif
+	if (!ssuds::cpu_has_avx2())
+		GTEST_SKIP() << "This CPU doesn't have AVX2";
+
+	check_avx2_searches<char>('x', 'y');
+	check_avx2_searches<unsigned short>(60000, 1);
+	check_avx2_searches<int>(-1, 0);
+	check_avx2_searches<unsigned long long>(0xFFFFFFFF00000000ull, 0xFFFFFFFFull);
+	check_avx2_searches<float>(2.5f, -2.5f);
+	check_avx2_searches<double>(-0.0, 1e300);
+}
+#endif
+
 #endif
\ No newline at end of file
@@ -0,0 +1,91 @@
+#include <gtest/gtest.h>
+#include <concurrent_unordered_map.h>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#define DO_CONCURRENT_UNORDERED_MAP_TESTS 1
+#if DO_CONCURRENT_UNORDERED_MAP_TESTS
+
+TEST(ConcurrentUnorderedMapTests, single_thread)
+{
+	ssuds::ConcurrentUnorderedMap<std::string, int> map(10);
+	EXPECT_EQ(map.num_shards(), 16);
+	EXPECT_THROW((ssuds::ConcurrentUnorderedMap<int, int>(0)), std::invalid_argument);
+
+	EXPECT_TRUE(map.insert_or_assign("Bob", 7));
+	EXPECT_FALSE(map.insert_or_assign("Bob", 9));
+	EXPECT_TRUE(map.try_emplace("Sue", 1));
+	EXPECT_FALSE(map.try_emplace("Sue", 2));
+	EXPECT_EQ(map.size(), 2);
+
+	int value = 0;
+	EXPECT_TRUE(map.find("Bob", value));
+	EXPECT_EQ(value, 9);
+	EXPECT_TRUE(map.find(std::string_view("Sue"), value));
+	EXPECT_EQ(value, 1);
+	EXPECT_FALSE(map.find("Jose", value));
+	EXPECT_TRUE(map.contains("Bob"));
+
+	EXPECT_FALSE(map.update("Bob", [](int& v) { v++; }));
+	EXPECT_FALSE(map.update("Bob", [](int& v) { v++; }));
+	map.find("Bob", value);
+	EXPECT_EQ(value, 11);
+	EXPECT_TRUE(map.update("Ann", [](int& v) { v += 5; }, 10));
+	map.find("Ann", value);
+	EXPECT_EQ(value, 15);
+	EXPECT_TRUE(map.remove("Ann"));
+
+	EXPECT_TRUE(map.remove("Bob"));
+	EXPECT_FALSE(map.remove("Bob"));
+	int count = 0;
+	map.for_each([&](const std::pair<std::string, int>& p) { count++; EXPECT_EQ(p.first, "Sue"); });
+	EXPECT_EQ(count, 1);
+}
+
+TEST(ConcurrentUnorderedMapTests, many_threads)
+{
+	ssuds::ConcurrentUnorderedMap<int, int> map;
+	const int num_threads = 8;
+	const int per_thread = 20000;
+
+	// Each thread adds its own keys (growing the shards as it goes) and bumps a shared set of counters
+	std::vector<std::thread> threads;
+	for (int t = 0; t < num_threads; t++)
+	{
+		threads.push_back(std::thread([&map, t, per_thread]() {
+			for (int i = 0; i < per_thread; i++)
+			{
+				map.insert_or_assign(t * per_thread + i + 1000, t);
+				map.update(i % 100, [](int& v) { v++; }, 0);
+			}
+			for (int i = 0; i < per_thread; i += 2)
+				map.remove(t * per_thread + i + 1000);
+			}));
+	}
+	for (std::thread& thread : threads)
+		thread.join();
+
+	EXPECT_EQ(map.size(), 100 + num_threads * per_thread / 2);
+	for (int i = 0; i < 100; i++)
+	{
+		int value = 0;
+		EXPECT_TRUE(map.find(i, value));
+		EXPECT_EQ(value, num_threads * per_thread / 100);
+	}
+	for (int t = 0; t < num_threads; t++)
+	{
+		for (int i = 0; i < per_thread; i++)
+		{
+			int value = -1;
+			EXPECT_EQ(map.find(t * per_thread + i + 1000, value), i % 2 == 1);
+			if (i % 2 == 1)
+			{
+				EXPECT_EQ(value, t);
+			}
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,202 @@
+#include <gtest/gtest.h>
+#include <flat_string_map.h>
+#include <random>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+
+#define DO_FLAT_STRING_MAP_TESTS 1
+#if DO_FLAT_STRING_MAP_TESTS
+
+TEST(FlatStringMapTests, basics)
+{
+	ssuds::FlatStringMap<int> map;
+	map["Bob"] = 7;
+	map[std::string("Sue")] = 3;
+	EXPECT_TRUE(map.try_emplace("Ann", 5).second);
+	EXPECT_FALSE(map.try_emplace("Ann", 6).second);
+	map[""] = 1;
+	EXPECT_EQ(map.size(), 4);
+	EXPECT_EQ(map.arena_size(), 9);
+
+	EXPECT_EQ((*map.find("Bob")).second, 7);
+	EXPECT_EQ((*map.find("Ann")).second, 5);
+	EXPECT_EQ((*map.find("")).second, 1);
+	EXPECT_TRUE(map.find("Bo") == map.end());
+	EXPECT_TRUE(map.find("Bobb") == map.end());
+
+	EXPECT_TRUE(map.remove("Bob"));
+	EXPECT_FALSE(map.remove("Bob"));
+	EXPECT_TRUE(map.find("Bob") == map.end());
+	EXPECT_EQ(map.size(), 3);
+
+	// Adding a key that is a view into the map's own arena (which may move as the key is added)
+	std::string_view sue = (*map.find("Sue")).first;
+	for (int i = 0; i < 100; i++)
+		map[std::to_string(i)] = i;
+	sue = (*map.find("Sue")).first;
+	map.remove("Sue");
+	map[sue] = 4;
+	EXPECT_EQ((*map.find("Sue")).second, 4);
+
+	std::stringstream ss;
+	ssuds::FlatStringMap<int> small;
+	small["x"] = 1;
+	ss << small;
+	EXPECT_EQ(ss.str(), "{x:1}");
+
+	// A const map only hands out const values
+	const ssuds::FlatStringMap<int>& const_map = map;
+	static_assert(std::is_same<decltype((*const_map.find("Ann")).second), const int&>::value, "const map's values must be const");
+	static_assert(std::is_same<decltype((*map.find("Ann")).second), int&>::value, "");
+	ssuds::FlatStringMap<int>::const_iterator it = map.find("Ann");
+	EXPECT_TRUE(it == const_map.find("Ann"));
+	EXPECT_EQ((*it).second, 5);
+	EXPECT_TRUE(const_map.find("Bob") == const_map.end());
+}
+
+TEST(FlatStringMapTests, random_against_std)
+{
+	// Random adds and removes (growing the table and compacting the arena as it goes), checked against
+	// std::unordered_map
+	ssuds::FlatStringMap<int> map;
+	std::unordered_map<std::string, int> expected;
+	std::mt19937 rng(2024);
+	for (int i = 0; i < 60000; i++)
+	{
+		std::string key = "key" + std::to_string(rng() % 8000) + std::string(rng() % 20, 'z');
+		if (rng() % 3 == 0)
+			EXPECT_EQ(map.remove(key), expected.erase(key) == 1);
+		else
+		{
+			map[key] = i;
+			expected[key] = i;
+		}
+	}
+	EXPECT_EQ(map.size(), expected.size());
+	EXPECT_LE(map.load_factor(), 0.75f);
+
+	unsigned int count = 0;
+	for (ssuds::FlatStringMap<int>::iterator it = map.begin(); it != map.end(); ++it)
+	{
+		count++;
+		std::string key((*it).first);
+		ASSERT_TRUE(expected.find(key) != expected.end());
+		EXPECT_EQ((*it).second, expected[key]);
+	}
+	EXPECT_EQ(count, expected.size());
+
+	// Copies (and moves) only keep the live keys
+	ssuds::FlatStringMap<int> copy(map);
+	unsigned int live_chars = 0;
+	for (const std::pair<const std::string, int>& p : expected)
+	{
+		live_chars += (unsigned int)p.first.size();
+		EXPECT_EQ((*copy.find(p.first)).second, p.second);
+	}
+	EXPECT_EQ(copy.arena_size(), live_chars);
+	ssuds::FlatStringMap<int> moved(std::move(copy));
+	EXPECT_EQ(moved.size(), expected.size());
+	EXPECT_EQ(copy.size(), 0);
+	copy = moved;
+	EXPECT_EQ(copy.size(), expected.size());
+}
+
+TEST(FlatStringMapTests, churn)
+{
+	// Adding and removing a big key over and over never rebuilds the table, so the arena has to be compacted as
+	// it fills up or it would keep growing (to 4GB and a length_error).  Half the adds use a view of the key's
+	// removed characters in the arena, which the compaction drops
+	ssuds::FlatStringMap<int> map;
+	map["small"] = 1;
+	std::string big(4096, 'b');
+	for (int i = 0; i < 20000; i++)
+	{
+		map[big] = i;
+		if (i % 2 == 1)
+		{
+			std::string_view removed = (*map.find(big)).first;
+			map.remove(big);
+			map[removed] = i;
+			ASSERT_EQ((*map.find(big)).second, i);
+		}
+		ASSERT_TRUE(map.remove(big));
+		ASSERT_LE(map.arena_size(), 4 * big.size());
+	}
+	EXPECT_EQ(map.size(), 1);
+	EXPECT_EQ((*map.find("small")).second, 1);
+	EXPECT_LE(map.memory_usage(), 64 * 1024);
+}
+
+TEST(FlatStringMapTests, own_key_grows_and_compacts)
+{
+	// Adding a view of part of a live key when that add is the one that grows the table -- and the rebuild compacts
+	// the arena (mostly removed keys' characters), freeing the characters the view points at
+	ssuds::FlatStringMap<int> map;
+	std::string big(200, 'a');
+	map[big] = 1;
+	for (int i = 0; i < 3; i++)
+	{
+		std::string dead(1000, (char)('p' + i));
+		map[dead] = i;
+		map.remove(dead);
+	}
+	for (int i = 0; i < 5; i++)
+		map[std::to_string(i)] = i;
+	unsigned int capacity = map.capacity();
+	ASSERT_GT(map.size() + 1, capacity * 0.75f);
+
+	map[(*map.find(big)).first.substr(0, 150)] = 42;
+	EXPECT_GT(map.capacity(), capacity);
+	EXPECT_EQ(map.arena_size(), 200 + 5 + 150);
+	EXPECT_EQ((*map.find(std::string(150, 'a'))).second, 42);
+	EXPECT_EQ((*map.find(big)).second, 1);
+	EXPECT_EQ(map.size(), 7);
+}
+
+TEST(FlatStringMapTests, moves)
+{
+	static_assert(std::is_nothrow_move_constructible<ssuds::FlatStringMap<std::string>>::value, "moving shouldn't allocate");
+	static_assert(std::is_nothrow_move_assignable<ssuds::FlatStringMap<std::string>>::value, "moving shouldn't allocate");
+
+	ssuds::FlatStringMap<std::string> map;
+	for (int i = 0; i < 100; i++)
+		map[std::to_string(i)] = std::string(30, 'v');
+	ssuds::FlatStringMap<std::string> moved(std::move(map));
+	EXPECT_EQ(moved.size(), 100);
+	EXPECT_EQ((*moved.find("42")).second, std::string(30, 'v'));
+
+	// The moved-from map has no table or arena, but can still be used
+	EXPECT_EQ(map.size(), 0);
+	EXPECT_EQ(map.memory_usage(), 0);
+	EXPECT_TRUE(map.begin() == map.end());
+	EXPECT_TRUE(map.find("42") == map.end());
+	EXPECT_FALSE(map.remove("42"));
+	map["new"] = "value";
+	EXPECT_EQ((*map.find("new")).second, "value");
+
+	// Move assignment takes the table instead of copying it
+	const std::string* value = &(*moved.find("7")).second;
+	map = std::move(moved);
+	EXPECT_EQ(map.size(), 100);
+	EXPECT_EQ(&(*map.find("7")).second, value);
+	EXPECT_TRUE(map.find("new") == map.end());
+	EXPECT_EQ(moved.size(), 0);
+	moved = std::move(map);
+	EXPECT_EQ(moved.size(), 100);
+}
+
+TEST(FlatStringMapTests, owning_values)
+{
+	ssuds::FlatStringMap<std::string> map;
+	for (int i = 0; i < 1000; i++)
+		map.try_emplace(std::to_string(i), 50, (char)('a' + i % 26));
+	for (int i = 0; i < 1000; i += 2)
+		map.remove(std::to_string(i));
+	map.rehash(4096);
+	EXPECT_EQ(map.size(), 500);
+	EXPECT_EQ((*map.find("999")).second, std::string(50, 'a' + 999 % 26));
+	EXPECT_GT(map.memory_usage(), 4096 * sizeof(std::string));
+}
+
+#endif
@@ -0,0 +1,83 @@
+#include <gtest/gtest.h>
+#include <frozen_unordered_map.h>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+#define DO_FROZEN_UNORDERED_MAP_TESTS 1
+#if DO_FROZEN_UNORDERED_MAP_TESTS
+
+namespace
+{
+	// Every key gets the same hash code, so no perfect hash exists
+	struct ConstantHash
+	{
+		std::size_t operator()(int /*value*/) const
+		{
+			return 7;
+		}
+	};
+
+	constexpr std::pair<std::string_view, int> color_items[] = { {"red", 0xFF0000}, {"green", 0x00FF00}, {"blue", 0x0000FF},
+		{"black", 0}, {"white", 0xFFFFFF}, {"yellow", 0xFFFF00}, {"cyan", 0x00FFFF}, {"magenta", 0xFF00FF}, {"gray", 0x808080},
+		{"orange", 0xFFA500}, {"purple", 0x800080}, {"brown", 0xA52A2A} };
+	constexpr ssuds::FixedFrozenUnorderedMap<std::string_view, int, 12> colors = ssuds::make_frozen_map(color_items);
+
+	// These are checked by the compiler
+	static_assert(colors.at("green") == 0x00FF00, "compile-time lookup");
+	static_assert(colors.contains("brown") && !colors.contains("pink") && !colors.contains(""), "compile-time lookup");
+	static_assert(ssuds::make_frozen_map<int, int>({ {1, 10}, {2, 20}, {300, 30} }).at(300) == 30, "compile-time lookup");
+}
+
+TEST(FrozenUnorderedMapTests, from_unordered_map)
+{
+	ssuds::UnorderedMap<std::string, int> source;
+	for (int i = 0; i < 10000; i++)
+		source["key" + std::to_string(i)] = i;
+	ssuds::FrozenUnorderedMap<std::string, int> frozen(source);
+	EXPECT_EQ(frozen.size(), 10000);
+
+	for (int i = 0; i < 10000; i++)
+	{
+		std::string key = "key" + std::to_string(i);
+		ASSERT_TRUE(frozen.contains(key));
+		EXPECT_EQ(frozen.at(key), i);
+		EXPECT_EQ(frozen.find(std::string_view(key))->second, i);
+	}
+	for (int i = 10000; i < 20000; i++)
+		EXPECT_FALSE(frozen.contains("key" + std::to_string(i)));
+	EXPECT_THROW(frozen.at("nope"), std::out_of_range);
+
+	// Every item is in exactly one slot
+	int total = 0;
+	for (ssuds::FrozenUnorderedMap<std::string, int>::const_iterator it = frozen.begin(); it != frozen.end(); ++it)
+		total += it->second;
+	EXPECT_EQ(total, 9999 * 10000 / 2);
+}
+
+TEST(FrozenUnorderedMapTests, edge_cases)
+{
+	ssuds::UnorderedMap<int, int> source;
+	ssuds::FrozenUnorderedMap<int, int> empty(source);
+	EXPECT_EQ(empty.size(), 0);
+	EXPECT_FALSE(empty.contains(1));
+
+	source[5] = 50;
+	ssuds::FrozenUnorderedMap<int, int> one(source);
+	EXPECT_EQ(one.at(5), 50);
+	EXPECT_FALSE(one.contains(6));
+	std::stringstream ss;
+	ss << one;
+	EXPECT_EQ(ss.str(), "{5:50}");
+
+	source[6] = 60;
+	EXPECT_THROW((ssuds::FrozenUnorderedMap<int, int, ConstantHash>(source)), std::invalid_argument);
+
+	EXPECT_EQ(colors.size(), 12);
+	EXPECT_EQ(*colors.find("orange"), 0xFFA500);
+	EXPECT_EQ(colors.find("pink"), nullptr);
+	for (unsigned int i = 0; i < colors.size(); i++)
+		EXPECT_EQ(colors.at(colors.keys()[i]), colors.values()[i]);
+}
+
+#endif
@@ -0,0 +1,107 @@
+#include <gtest/gtest.h>
+#include <incremental_unordered_map.h>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include "map_test_utility.h"
+
+#define DO_INCREMENTAL_UNORDERED_MAP_TESTS 1
+#if DO_INCREMENTAL_UNORDERED_MAP_TESTS
+
+namespace
+{
+	/// Random adds, overwrites and removes, with a random lookup and a size check after every step so they are
+	/// checked in the middle of rehashes
+	template <class M>
+	void check_random_ops(M& map, unsigned int seed)
+	{
+		std::unordered_map<int, std::string> expected;
+		std::mt19937 rng(seed);
+		bool saw_rehash = false;
+		map_tests::random_ops(map, expected, rng, 40000, 6000,
+			[&](int key, int i) {
+				switch (rng() % 3)
+				{
+				case 0:
+					EXPECT_EQ(map.try_emplace(key, std::to_string(i)), expected.find(key) == expected.end());
+					expected.emplace(key, std::to_string(i));
+					break;
+				case 1:
+					EXPECT_EQ(map.insert_or_assign(key, std::to_string(i)), expected.find(key) == expected.end());
+					expected[key] = std::to_string(i);
+					break;
+				default:
+					map[key] += "x";
+					expected[key] += "x";
+				}
+			},
+			[&]() {
+				saw_rehash = saw_rehash || map.is_rehashing();
+				int probe = (int)(rng() % 6000);
+				std::string* value = map.find(probe);
+				ASSERT_EQ(value != nullptr, expected.find(probe) != expected.end());
+				if (value)
+				{
+					EXPECT_EQ(*value, expected[probe]);
+				}
+				ASSERT_EQ(map.size(), expected.size());
+			});
+		EXPECT_TRUE(saw_rehash);
+
+		unsigned int count = 0;
+		map.for_each([&](const std::pair<int, std::string>& p) {
+			count++;
+			EXPECT_EQ(p.second, expected[p.first]);
+			});
+		EXPECT_EQ(count, expected.size());
+	}
+}
+
+TEST(IncrementalUnorderedMapTests, random_ops)
+{
+	ssuds::IncrementalUnorderedMap<int, std::string> map;
+	check_random_ops(map, 1);
+
+	ssuds::IncrementalUnorderedMap<int, std::string, ssuds::FastHash<int>, ssuds::RobinHoodProbing, ssuds::StoredHash32> policy_map;
+	check_random_ops(policy_map, 2);
+}
+
+TEST(IncrementalUnorderedMapTests, rehash_steps)
+{
+	// Filling an 8192-slot table starts a rehash into 16384 slots, which takes 8192 / 64 changes to finish
+	ssuds::IncrementalUnorderedMap<int, int> map(8192);
+	for (int i = 0; i < 6144; i++)
+		map[i] = i;
+	EXPECT_FALSE(map.is_rehashing());
+	EXPECT_EQ(map.capacity(), 8192);
+	map[6144] = 6144;
+	EXPECT_TRUE(map.is_rehashing());
+	EXPECT_EQ(map.capacity(), 16384);
+
+	ssuds::IncrementalUnorderedMap<int, int> copy(map);
+	for (int i = 0; i < 126; i++)
+		map.remove(-1);
+	EXPECT_TRUE(map.is_rehashing());
+	map.remove(-1);
+	EXPECT_FALSE(map.is_rehashing());
+	EXPECT_EQ(map.size(), 6145);
+	EXPECT_EQ(map.capacity(), 16384);
+
+	// The copy is still part way through its rehash
+	EXPECT_TRUE(copy.is_rehashing());
+	EXPECT_EQ(*copy.find(100), 100);
+	copy.finish_rehash();
+	EXPECT_FALSE(copy.is_rehashing());
+	EXPECT_EQ(copy.size(), 6145);
+	for (int i = 0; i <= 6144; i++)
+		EXPECT_EQ(*copy.find(i), i);
+
+	ssuds::IncrementalUnorderedMap<int, int> moved(std::move(copy));
+	EXPECT_EQ(moved.size(), 6145);
+	EXPECT_EQ(copy.size(), 0);
+	copy[1] = 2;
+	EXPECT_EQ(*copy.find(1), 2);
+	EXPECT_FALSE(copy.is_rehashing());
+}
+
+#endif
@@ -0,0 +1,51 @@
+#pragma once
+#include <gtest/gtest.h>
+#include <random>
+
+// Shared pieces of the "random operations, checked against std::unordered_map" tests of the map containers.  Each
+// test supplies what is specific to its container (the non-remove operations, what to check between steps, how
+// to look a key up).
+namespace map_tests
+{
+	/// <summary>
+	/// Runs num_ops random operations on keys in [0, key_range), keeping map and expected (a std::unordered_map
+	/// holding what map should) in step.  A third are removes; the rest are passed to change(key, i), which must
+	/// make the same change to both.  after_step() is called after each operation
+	/// </summary>
+	template <class M, class E, class Change, class Step>
+	void random_ops(M& map, E& expected, std::mt19937& rng, int num_ops, int key_range, Change change, Step after_step)
+	{
+		for (int i = 0; i < num_ops; i++)
+		{
+			int key = (int)(rng() % key_range);
+			if (rng() % 3 == 0)
+			{
+				EXPECT_EQ(map.remove(key), expected.erase(key) == 1);
+			}
+			else
+				change(key, i);
+			after_step();
+		}
+	}
+
+
+	/// <summary>
+	/// Checks every key in [0, key_range): lookup(key, value) must return true (setting value) exactly when
+	/// expected has the key, and value must then match
+	/// </summary>
+	template <class E, class Lookup>
+	void check_contents(const E& expected, int key_range, Lookup lookup)
+	{
+		for (int key = 0; key < key_range; key++)
+		{
+			typename E::mapped_type value{};
+			typename E::const_iterator it = expected.find(key);
+			bool found = lookup(key, value);
+			EXPECT_EQ(found, it != expected.end());
+			if (found && it != expected.end())
+			{
+				EXPECT_EQ(value, it->second);
+			}
+		}
+	}
+}
@@ -0,0 +1,310 @@
+#include <gtest/gtest.h>
+#include <memory_resource.h>
+#include <array_list.h>
+#include <concurrent_unordered_map.h>
+#include <flat_string_map.h>
+#include <frozen_unordered_map.h>
+#include <incremental_unordered_map.h>
+#include <linked_list.h>
+#include <optimistic_unordered_map.h>
+#include <ordered_set.h>
+#include <queue.h>
+#include <small_unordered_map.h>
+#include <stack.h>
+#include <unordered_map.h>
+#include <cstring>
+#include <sstream>
+#include <string>
+
+#define DO_MEMORY_RESOURCE_TESTS 1
+#if DO_MEMORY_RESOURCE_TESTS
+
+namespace
+{
+	/// A memory_resource that counts what is outstanding (to check that everything is given back)
+	class CountingResource : public std::pmr::memory_resource
+	{
+	public:
+		long long mOutstanding = 0;
+		long long mAllocations = 0;
+
+	protected:
+		void* do_allocate(std::size_t bytes, std::size_t alignment) override
+		{
+			mOutstanding += bytes;
+			mAllocations++;
+			return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+		}
+
+		void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override
+		{
+			mOutstanding -= bytes;
+			std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+		}
+
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override
+		{
+			return this == &other;
+		}
+	};
+
+	/// Makes a resource the default one until it goes out of scope
+	class DefaultResourceGuard
+	{
+	public:
+		std::pmr::memory_resource* mOld;
+
+		explicit DefaultResourceGuard(std::pmr::memory_resource* resource) : mOld(std::pmr::set_default_resource(resource))
+		{
+		}
+
+		~DefaultResourceGuard()
+		{
+			std::pmr::set_default_resource(mOld);
+		}
+	};
+}
+
+TEST(MemoryResourceTests, monotonic_arena)
+{
+	CountingResource upstream;
+	{
+		ssuds::MonotonicArena arena(1024, &upstream);
+		EXPECT_EQ(upstream.mAllocations, 0);
+		void* a = arena.allocate(10, 1);
+		void* b = arena.allocate(64, 64);
+		EXPECT_EQ((std::size_t)b % 64, 0);
+		EXPECT_NE(a, b);
+		EXPECT_EQ(upstream.mAllocations, 1);
+
+		// Bigger than a chunk: a new (bigger) chunk is made for it
+		void* c = arena.allocate(5000, 8);
+		std::memset(c, 1, 5000);
+		EXPECT_EQ(upstream.mAllocations, 2);
+		EXPECT_EQ(arena.bytes_allocated(), 5074);
+
+		arena.deallocate(c, 5000, 8);
+		EXPECT_EQ(arena.bytes_allocated(), 5074);
+		arena.release();
+		EXPECT_EQ(upstream.mOutstanding, 0);
+		EXPECT_EQ(arena.bytes_allocated(), 0);
+		EXPECT_NE(arena.allocate(10, 1), nullptr);
+	}
+	EXPECT_EQ(upstream.mOutstanding, 0);
+}
+
+TEST(MemoryResourceTests, fixed_pool)
+{
+	CountingResource upstream;
+	{
+		ssuds::FixedPool pool(24, 4, &upstream);
+		EXPECT_EQ(pool.block_size() % alignof(std::max_align_t), 0);
+		void* blocks[10];
+		for (int i = 0; i < 10; i++)
+			blocks[i] = pool.allocate(20, 8);
+		EXPECT_EQ(pool.blocks_in_use(), 10);
+		EXPECT_EQ(upstream.mAllocations, 3);
+
+		// A freed block is the next one handed out
+		pool.deallocate(blocks[3], 20, 8);
+		EXPECT_EQ(pool.allocate(24, 8), blocks[3]);
+
+		// Too big for a block: straight to upstream
+		void* big = pool.allocate(1000, 8);
+		EXPECT_EQ(upstream.mAllocations, 4);
+		pool.deallocate(big, 1000, 8);
+
+		pool.release();
+		EXPECT_EQ(upstream.mOutstanding, 0);
+		EXPECT_EQ(pool.blocks_in_use(), 0);
+	}
+	EXPECT_EQ(upstream.mOutstanding, 0);
+}
+
+TEST(MemoryResourceTests, pmr_containers)
+{
+	CountingResource upstream;
+	{
+		ssuds::pmr::ArrayList<std::string> alist(&upstream);
+		for (int i = 0; i < 100; i++)
+			alist.append(std::to_string(i));
+		alist.insert("x", 50);
+		EXPECT_EQ(alist.remove(50), "x");
+		EXPECT_EQ(alist[99], "99");
+		EXPECT_GT(upstream.mOutstanding, 0);
+		EXPECT_EQ(alist.get_allocator().resource(), &upstream);
+
+		ssuds::pmr::LinkedList<int> llist(&upstream);
+		for (int i = 0; i < 10; i++)
+			llist.append(i);
+		llist.prepend(-1);
+		llist.remove(llist.begin());
+		EXPECT_EQ(llist.size(), 10);
+		EXPECT_EQ(llist[9], 9);
+
+		ssuds::pmr::OrderedSet<int> set(&upstream);
+		for (int i : { 5, 2, 8, 1, 3, 7, 9 })
+			set.insert(i);
+		EXPECT_TRUE(set.erase(5));
+		EXPECT_TRUE(set.erase(1));
+		set.rebalance();
+		EXPECT_EQ(set.size(), 5);
+		ssuds::pmr::OrderedSet<int> other({ 3, 4 }, &upstream);
+		ssuds::pmr::OrderedSet<int> both = set & other;
+		EXPECT_EQ(both.get_allocator().resource(), &upstream);
+		EXPECT_TRUE(both.contains(3));
+		EXPECT_EQ(both.size(), 1);
+		{
+			// Iterating, rebalancing and printing use the set's resource too (the default one would throw)
+			DefaultResourceGuard guard(std::pmr::null_memory_resource());
+			int total = 0;
+			for (int i : set)
+				total += i;
+			EXPECT_EQ(total, 2 + 3 + 7 + 8 + 9);
+			set.rebalance();
+			EXPECT_EQ(set.traversal(ssuds::TraversalType::PRE_ORDER).get_allocator().resource(), &upstream);
+			std::stringstream ss;
+			ss << set;
+			EXPECT_EQ(ss.str(), "[2, 3, 7, 8, 9]");
+		}
+
+		ssuds::pmr::Stack<int> stack(&upstream);
+		stack.push(1);
+		stack.push(2);
+		EXPECT_EQ(stack.pop(), 2);
+		ssuds::pmr::Queue<int> queue(&upstream);
+		queue.enqueue(1);
+		queue.enqueue(2);
+		EXPECT_EQ(queue.dequeue(), 1);
+
+		ssuds::pmr::UnorderedMap<std::string, int> map(&upstream);
+		for (int i = 0; i < 1000; i++)
+			map[std::to_string(i)] = i;
+		EXPECT_TRUE(map.remove("500"));
+		EXPECT_EQ(map["999"], 999);
+
+		// Assigning keeps the map's own allocator; copying uses the default resource
+		ssuds::pmr::UnorderedMap<std::string, int> copy = map;
+		EXPECT_EQ(copy.get_allocator().resource(), std::pmr::get_default_resource());
+		ssuds::pmr::UnorderedMap<std::string, int> assigned(&upstream);
+		assigned = copy;
+		EXPECT_EQ(assigned.get_allocator().resource(), &upstream);
+		EXPECT_EQ(assigned.size(), 999);
+
+		// Moving and swapping take the table's allocator along
+		ssuds::pmr::UnorderedMap<std::string, int> moved(std::move(map));
+		EXPECT_EQ(moved.get_allocator().resource(), &upstream);
+		copy.swap(moved);
+		EXPECT_EQ(copy.get_allocator().resource(), &upstream);
+		EXPECT_EQ(moved.get_allocator().resource(), std::pmr::get_default_resource());
+		EXPECT_EQ(copy["999"], 999);
+	}
+	EXPECT_EQ(upstream.mOutstanding, 0);
+}
+
+TEST(MemoryResourceTests, pmr_hash_maps)
+{
+	// Everything the maps built on UnorderedMap allocate comes from the resource they're given (anything that
+	// used the default resource would throw)
+	CountingResource upstream;
+	{
+		DefaultResourceGuard guard(std::pmr::null_memory_resource());
+
+		ssuds::pmr::ConcurrentUnorderedMap<int, int> concurrent(&upstream);
+		ssuds::pmr::OptimisticUnorderedMap<int, int> optimistic(4, ssuds::FastHash<int>(), &upstream);
+		ssuds::pmr::IncrementalUnorderedMap<int, int> incremental(&upstream);
+		ssuds::pmr::SmallUnorderedMap<int, int, 4> small(&upstream);
+		ssuds::pmr::FlatStringMap<int> flat(&upstream);
+		ssuds::pmr::UnorderedMap<int, int> source(&upstream);
+		for (int i = 0; i < 2000; i++)
+		{
+			concurrent.insert_or_assign(i, i);
+			optimistic.insert_or_assign(i, i);
+			incremental[i] = i;
+			small[i] = i;
+			flat[std::to_string(i)] = i;
+			source[i] = i;
+		}
+		for (int i = 0; i < 2000; i += 2)
+		{
+			EXPECT_TRUE(concurrent.remove(i));
+			EXPECT_TRUE(optimistic.remove(i));
+			EXPECT_TRUE(incremental.remove(i));
+			EXPECT_TRUE(small.remove(i));
+			EXPECT_TRUE(flat.remove(std::to_string(i)));
+		}
+		ssuds::pmr::FrozenUnorderedMap<int, int> frozen(source, ssuds::FastHash<int>(), &upstream);
+
+		int value = 0;
+		EXPECT_TRUE(concurrent.find(1999, value) && value == 1999);
+		EXPECT_TRUE(optimistic.find(1999, value) && value == 1999);
+		EXPECT_EQ(*incremental.find(1999), 1999);
+		EXPECT_EQ(*small.find(1999), 1999);
+		EXPECT_EQ((*flat.find("1999")).second, 1999);
+		EXPECT_EQ(frozen.at(1999), 1999);
+		EXPECT_EQ(concurrent.get_allocator().resource(), &upstream);
+		EXPECT_EQ(optimistic.get_allocator().resource(), &upstream);
+		EXPECT_EQ(incremental.get_allocator().resource(), &upstream);
+		EXPECT_EQ(small.get_allocator().resource(), &upstream);
+		EXPECT_EQ(flat.get_allocator().resource(), &upstream);
+		EXPECT_EQ(frozen.get_allocator().resource(), &upstream);
+
+		// Assigning keeps the map's own allocator, and moving takes the table's along (as with UnorderedMap)
+		ssuds::pmr::IncrementalUnorderedMap<int, int> incremental_copy(&upstream);
+		incremental_copy = incremental;
+		EXPECT_EQ(*incremental_copy.find(1999), 1999);
+		ssuds::pmr::SmallUnorderedMap<int, int, 4> small_copy(&upstream);
+		small_copy = small;
+		ssuds::pmr::SmallUnorderedMap<int, int, 4> small_moved(std::move(small_copy));
+		EXPECT_EQ(small_moved.get_allocator().resource(), &upstream);
+		EXPECT_EQ(*small_moved.find(1999), 1999);
+		ssuds::pmr::FlatStringMap<int> flat_copy(&upstream);
+		flat_copy = flat;
+		ssuds::pmr::FlatStringMap<int> flat_moved(std::move(flat_copy));
+		EXPECT_EQ(flat_moved.get_allocator().resource(), &upstream);
+		EXPECT_EQ((*flat_moved.find("1999")).second, 1999);
+		EXPECT_GT(upstream.mOutstanding, 0);
+	}
+	EXPECT_EQ(upstream.mOutstanding, 0);
+}
+
+TEST(MemoryResourceTests, release_in_one_shot)
+{
+	// Trivially destructible items in an arena can be dropped without running any destructor
+	CountingResource upstream;
+	ssuds::MonotonicArena arena(4096, &upstream);
+	alignas(ssuds::pmr::UnorderedMap<int, int>) unsigned char storage[sizeof(ssuds::pmr::UnorderedMap<int, int>)];
+	ssuds::pmr::UnorderedMap<int, int>* map = ::new ((void*)storage) ssuds::pmr::UnorderedMap<int, int>(&arena);
+	for (int i = 0; i < 10000; i++)
+		(*map)[i] = i;
+	EXPECT_EQ((*map)[1234], 1234);
+	EXPECT_GT(upstream.mOutstanding, 0);
+	arena.release();
+	EXPECT_EQ(upstream.mOutstanding, 0);
+
+	// Nodes of one size share a pool
+	ssuds::FixedPool pool(64, 256, &upstream);
+	{
+		ssuds::pmr::OrderedSet<int> set(&pool);
+		for (int i = 0; i < 1000; i++)
+			set.insert((i * 7919) % 1000);
+		EXPECT_EQ(pool.blocks_in_use(), 1000);
+		set.clear();
+		EXPECT_EQ(pool.blocks_in_use(), 0);
+	}
+}
+
+TEST(MemoryResourceTests, std_allocator_default)
+{
+	// The default allocator adds nothing to how the containers behave
+	ssuds::ArrayList<int> alist = { 1, 2, 3 };
+	ssuds::ArrayList<int> acopy(alist);
+	EXPECT_EQ(acopy[2], 3);
+	ssuds::OrderedSet<int> set = { 3, 1, 2 };
+	EXPECT_EQ((set | ssuds::OrderedSet<int>{ 4 }).size(), 4);
+	ssuds::UnorderedMap<int, int> map;
+	map[1] = 2;
+	EXPECT_TRUE((map.get_allocator() == std::allocator<std::pair<int, int>>()));
+}
+
+#endif
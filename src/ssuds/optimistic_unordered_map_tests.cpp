@@ -0,0 +1,106 @@
+#include <gtest/gtest.h>
+#include <optimistic_unordered_map.h>
+#include <atomic>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "map_test_utility.h"
+
+#define DO_OPTIMISTIC_UNORDERED_MAP_TESTS 1
+#if DO_OPTIMISTIC_UNORDERED_MAP_TESTS
+
+namespace
+{
+	// A value that is easy to spot if it is read half-way through being written: mA always equals mB
+	struct Versioned
+	{
+		unsigned long long mA;
+		unsigned long long mB;
+	};
+}
+
+TEST(OptimisticUnorderedMapTests, single_thread)
+{
+	// Random inserts, overwrites and removes (with few shards, so the shards grow and have long probe chains).
+	// insert_or_assign must report whether the key was new, and every slot copy made by a backward shift must
+	// keep its value
+	ssuds::OptimisticUnorderedMap<int, int> map(4);
+	EXPECT_EQ(map.num_shards(), 4);
+	std::unordered_map<int, int> expected;
+	std::mt19937 rng(12345);
+	map_tests::random_ops(map, expected, rng, 50000, 5000,
+		[&](int key, int i) {
+			EXPECT_EQ(map.insert_or_assign(key, i), expected.find(key) == expected.end());
+			expected[key] = i;
+		},
+		[]() {});
+
+	EXPECT_EQ(map.size(), expected.size());
+	map_tests::check_contents(expected, 5000, [&](int key, int& value) { return map.find(key, value); });
+	for (int key = 0; key < 5000; key++)
+		EXPECT_EQ(map.contains(key), expected.find(key) != expected.end());
+	EXPECT_FALSE(map.contains(-1));
+}
+
+TEST(OptimisticUnorderedMapTests, linearizable_reads)
+{
+	// Keys [0, 100) are never removed, and each has one writer that keeps raising its version.  Keys [1000, ...)
+	// keep being added and removed, which moves items around (backward shifts) and grows the tables
+	ssuds::OptimisticUnorderedMap<int, Versioned> map(8);
+	for (int key = 0; key < 100; key++)
+		map.insert_or_assign(key, Versioned{ 0, 0 });
+
+	std::atomic<bool> done(false);
+	std::atomic<int> failures(0);
+	std::vector<std::thread> threads;
+	for (int w = 0; w < 2; w++)
+	{
+		threads.push_back(std::thread([&, w]() {
+			for (unsigned long long version = 1; version <= 2000; version++)
+			{
+				for (int key = w; key < 100; key += 2)
+					map.insert_or_assign(key, Versioned{ version, version });
+				for (int key = 0; key < 20; key++)
+					map.insert_or_assign(1000 + w * 100000 + (int)version * 20 + key, Versioned{ version, version });
+				for (int key = 0; key < 10; key++)
+					map.remove(1000 + w * 100000 + (int)version * 20 + key);
+			}
+			}));
+	}
+
+	// Every read of a stable key must find it, see a value that wasn't torn, and never see its version go backwards
+	for (int r = 0; r < 3; r++)
+	{
+		threads.push_back(std::thread([&]() {
+			std::vector<unsigned long long> last_seen(100, 0);
+			while (!done)
+			{
+				for (int key = 0; key < 100; key++)
+				{
+					Versioned value{ 1, 2 };
+					if (!map.find(key, value) || value.mA != value.mB || value.mA < last_seen[key])
+						failures++;
+					last_seen[key] = value.mA;
+				}
+			}
+			}));
+	}
+
+	threads[0].join();
+	threads[1].join();
+	done = true;
+	for (unsigned int i = 2; i < threads.size(); i++)
+		threads[i].join();
+
+	EXPECT_EQ(failures, 0);
+	EXPECT_EQ(map.size(), 100 + 2 * 2000 * 10);
+	for (int key = 0; key < 100; key++)
+	{
+		Versioned value{ 0, 0 };
+		EXPECT_TRUE(map.find(key, value));
+		EXPECT_EQ(value.mA, 2000);
+	}
+}
+
+#endif
@@ -0,0 +1,97 @@
+#include <gtest/gtest.h>
+#include <small_unordered_map.h>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include "map_test_utility.h"
+
+#define DO_SMALL_UNORDERED_MAP_TESTS 1
+#if DO_SMALL_UNORDERED_MAP_TESTS
+
+TEST(SmallUnorderedMapTests, small_and_spilled)
+{
+	ssuds::SmallUnorderedMap<std::string, int, 4> map;
+	EXPECT_TRUE(map.try_emplace("a", 1));
+	EXPECT_FALSE(map.try_emplace("a", 5));
+	map["b"] = 2;
+	EXPECT_TRUE(map.insert_or_assign("c", 3));
+	EXPECT_FALSE(map.insert_or_assign("c", 30));
+	map["d"] = 4;
+	EXPECT_TRUE(map.is_small());
+	EXPECT_EQ(map.size(), 4);
+	EXPECT_EQ(*map.find(std::string_view("c")), 30);
+	EXPECT_EQ(map.find("e"), nullptr);
+
+	// Removing moves the last item into the hole
+	EXPECT_TRUE(map.remove("a"));
+	EXPECT_FALSE(map.remove("a"));
+	EXPECT_EQ(*map.find("d"), 4);
+	map["a"] = 1;
+
+	// A copy and a move of a small map
+	ssuds::SmallUnorderedMap<std::string, int, 4> small_copy(map);
+	ssuds::SmallUnorderedMap<std::string, int, 4> small_moved(std::move(small_copy));
+	EXPECT_EQ(small_copy.size(), 0);
+	EXPECT_EQ(*small_moved.find("a"), 1);
+
+	// The fifth item spills everything into an UnorderedMap
+	map["e"] = 5;
+	EXPECT_FALSE(map.is_small());
+	EXPECT_EQ(map.size(), 5);
+	int total = 0;
+	map.for_each([&](const std::pair<std::string, int>& p) { total += p.second; });
+	EXPECT_EQ(total, 1 + 2 + 30 + 4 + 5);
+
+	ssuds::SmallUnorderedMap<std::string, int, 4> large_copy;
+	large_copy = map;
+	EXPECT_FALSE(large_copy.is_small());
+	EXPECT_TRUE(large_copy.remove("e"));
+	EXPECT_EQ(map.size(), 5);
+	small_moved = std::move(large_copy);
+	EXPECT_FALSE(small_moved.is_small());
+	EXPECT_EQ(small_moved.size(), 4);
+	EXPECT_TRUE(large_copy.is_small());
+	EXPECT_EQ(large_copy.size(), 0);
+}
+
+TEST(SmallUnorderedMapTests, random_against_std)
+{
+	// Lots of little maps, each checked against std::unordered_map.  Most never hold more than N items and stay
+	// small; every third one uses more keys, and those that spill have to carry on correctly as UnorderedMaps
+	std::mt19937 rng(99);
+	int stayed_small = 0;
+	int spilled = 0;
+	for (int round = 0; round < 300; round++)
+	{
+		ssuds::SmallUnorderedMap<int, std::string> map;
+		std::unordered_map<int, std::string> expected;
+		int key_range = round % 3 == 0 ? 40 : 10;
+		map_tests::random_ops(map, expected, rng, 60, key_range,
+			[&](int key, int) {
+				map[key] += "x";
+				expected[key] += "x";
+			},
+			[&]() {
+				ASSERT_EQ(map.size(), expected.size());
+				if (map.is_small())
+				{
+					EXPECT_LE(map.size(), 8);
+				}
+			});
+		map_tests::check_contents(expected, key_range, [&](int key, std::string& value) {
+			std::string* found = map.find(key);
+			if (found)
+				value = *found;
+			return found != nullptr;
+			});
+		if (map.is_small())
+			stayed_small++;
+		else
+			spilled++;
+	}
+	EXPECT_GT(stayed_small, 0);
+	EXPECT_GT(spilled, 0);
+}
+
+#endif
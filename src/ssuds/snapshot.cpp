@@ -0,0 +1,68 @@
+#include <snapshot.h>
+
+#if defined(_WIN32)
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+ssuds::MappedFile::MappedFile(const std::string& path) : mData(nullptr), mSize(0)
+{
+#if defined(_WIN32)
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		throw std::runtime_error("Unable to open snapshot file: " + path);
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+	{
+		CloseHandle(file);
+		throw std::runtime_error("Unable to map snapshot file: " + path);
+	}
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+	CloseHandle(file);
+	if (mapping == NULL)
+		throw std::runtime_error("Unable to map snapshot file: " + path);
+	mData = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+	// The view keeps the mapping alive
+	CloseHandle(mapping);
+	mSize = (unsigned long long)size.QuadPart;
+#else
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		throw std::runtime_error("Unable to open snapshot file: " + path);
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size == 0)
+	{
+		close(fd);
+		throw std::runtime_error("Unable to map snapshot file: " + path);
+	}
+	mSize = (unsigned long long)info.st_size;
+	mData = mmap(nullptr, (size_t)mSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	// The mapping keeps the file alive
+	close(fd);
+	if (mData == MAP_FAILED)
+		mData = nullptr;
+#endif
+	if (mData == nullptr)
+		throw std::runtime_error("Unable to map snapshot file: " + path);
+}
+
+
+ssuds::MappedFile::~MappedFile()
+{
+#if defined(_WIN32)
+	UnmapViewOfFile(mData);
+#else
+	munmap(mData, (size_t)mSize);
+#endif
+}
@@ -0,0 +1,530 @@
+#include <gtest/gtest.h>
+#include <unordered_map.h>
+#include <concurrent_unordered_map.h>
+#include <optimistic_unordered_map.h>
+#include <flat_string_map.h>
+#include <frozen_unordered_map.h>
+#include <incremental_unordered_map.h>
+#include <small_unordered_map.h>
+#include <unordered_map>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// These aren't really tests -- they time ssuds::UnorderedMap against std::unordered_map and print the
+// results.  They take a while (and should be run in Release), so they are off by default.  Build once
+// normally and once with SSUDS_DISABLE_SIMD defined to compare group probing with one-byte-at-a-time probing.
+#define DO_UNORDERED_MAP_BENCHMARKS 0
+#if DO_UNORDERED_MAP_BENCHMARKS
+
+namespace
+{
+	/// Runs func once and returns the elapsed time in nanoseconds per operation
+	template <class F>
+	double time_per_op(unsigned int num_ops, F func)
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		func();
+		std::chrono::steady_clock::time_point stop = std::chrono::steady_clock::now();
+		return std::chrono::duration<double, std::nano>(stop - start).count() / num_ops;
+	}
+
+	/// Makes num distinct keys.  Keys [0, num) are inserted and [num, 2 * num) are used for failed lookups
+	std::vector<std::string> make_string_keys(unsigned int num)
+	{
+		std::vector<std::string> keys;
+		for (unsigned int i = 0; i < 2 * num; i++)
+			keys.push_back("benchmark-key-number-" + std::to_string(i * 2654435761u));
+		return keys;
+	}
+
+	/// Times inserts, successful finds and failed finds for one map type and prints a line of results
+	template <class M, class K>
+	void run_lookup_benchmark(const char* label, M& map, const std::vector<K>& keys)
+	{
+		unsigned int num = (unsigned int)keys.size() / 2;
+		unsigned int hits = 0;
+
+		double insert_ns = time_per_op(num, [&]() {
+			for (unsigned int i = 0; i < num; i++)
+				map[keys[i]] = i;
+			});
+		double hit_ns = time_per_op(num, [&]() {
+			for (unsigned int i = 0; i < num; i++)
+				hits += map.find(keys[i]) != map.end();
+			});
+		double miss_ns = time_per_op(num, [&]() {
+			for (unsigned int i = num; i < 2 * num; i++)
+				hits += map.find(keys[i]) != map.end();
+			});
+
+		std::cout << label << "\tinsert " << insert_ns << " ns\thit " << hit_ns << " ns\tmiss " << miss_ns << " ns\t(" << hits << " hits)" << std::endl;
+	}
+
+	/// Like run_lookup_benchmark, but for one ssuds::UnorderedMap policy: also times growing the table and
+	/// reports the bytes used per slot
+	template <class M, class K>
+	void run_policy_benchmark(const char* label, const std::vector<K>& keys, unsigned int bytes_per_slot)
+	{
+		M map;
+		run_lookup_benchmark(label, map, keys);
+		unsigned int cap = map.capacity();
+		double rehash_ns = time_per_op(map.size(), [&]() {
+			map.rehash(cap * 2);
+			});
+		std::cout << "\t\t\trehash " << rehash_ns << " ns/item\t" << bytes_per_slot << " bytes/slot" << std::endl;
+	}
+
+	/// Compares the hash-storage policies for one key type
+	template <class K>
+	void run_stored_hash_benchmarks(const std::vector<K>& keys)
+	{
+		unsigned int pair_size = sizeof(std::pair<K, int>) + 1;
+		run_policy_benchmark<ssuds::UnorderedMap<K, int>>("NoStoredHash", keys, pair_size);
+		run_policy_benchmark<ssuds::UnorderedMap<K, int, ssuds::FastHash<K>, ssuds::LinearProbing, ssuds::StoredHash32>>("StoredHash32", keys, pair_size + 4);
+		run_policy_benchmark<ssuds::UnorderedMap<K, int, ssuds::FastHash<K>, ssuds::LinearProbing, ssuds::StoredHash64>>("StoredHash64", keys, pair_size + 8);
+	}
+}
+
+
+TEST(UnorderedMapBenchmarks, int_keys)
+{
+	for (unsigned int num : {1000u, 100000u, 1000000u})
+	{
+		std::vector<int> keys;
+		for (unsigned int i = 0; i < 2 * num; i++)
+			keys.push_back((int)(i * 2654435761u));
+
+		std::cout << "--- " << num << " int keys ---" << std::endl;
+		ssuds::UnorderedMap<int, int> ssuds_map;
+		run_lookup_benchmark("ssuds::UnorderedMap", ssuds_map, keys);
+		std::unordered_map<int, int> std_map;
+		run_lookup_benchmark("std::unordered_map", std_map, keys);
+	}
+}
+
+
+TEST(UnorderedMapBenchmarks, string_keys)
+{
+	for (unsigned int num : {1000u, 100000u, 1000000u})
+	{
+		std::vector<std::string> keys = make_string_keys(num);
+
+		std::cout << "--- " << num << " string keys ---" << std::endl;
+		ssuds::UnorderedMap<std::string, int> ssuds_map;
+		run_lookup_benchmark("ssuds::UnorderedMap", ssuds_map, keys);
+		std::unordered_map<std::string, int> std_map;
+		run_lookup_benchmark("std::unordered_map", std_map, keys);
+	}
+}
+
+
+TEST(UnorderedMapBenchmarks, stored_hash)
+{
+	unsigned int num = 1000000;
+	std::vector<int> int_keys;
+	for (unsigned int i = 0; i < 2 * num; i++)
+		int_keys.push_back((int)(i * 2654435761u));
+	std::cout << "--- " << num << " int keys ---" << std::endl;
+	run_stored_hash_benchmarks(int_keys);
+
+	// Keys well past the small-string limit that share a long prefix (slow to hash and to compare)
+	std::vector<std::string> string_keys;
+	for (unsigned int i = 0; i < 2 * num; i++)
+		string_keys.push_back("/a/long/shared/path/prefix/that/makes/every/comparison/expensive/" + std::to_string(i * 2654435761u));
+	std::cout << "--- " << num << " long string keys ---" << std::endl;
+	run_stored_hash_benchmarks(string_keys);
+}
+
+
+TEST(UnorderedMapBenchmarks, hash_functions)
+{
+	// Sequential ids are the case where std::hash (the identity for ints) is at its best, strided ids the worst
+	unsigned int num = 1000000;
+	for (unsigned int stride : {1u, 1024u})
+	{
+		std::vector<unsigned int> keys;
+		for (unsigned int i = 0; i < 2 * num; i++)
+			keys.push_back(i * stride);
+		std::cout << "--- " << num << " int keys, stride " << stride << " ---" << std::endl;
+		ssuds::UnorderedMap<unsigned int, int> fast_map;
+		run_lookup_benchmark("FastHash", fast_map, keys);
+		ssuds::UnorderedMap<unsigned int, int, std::hash<unsigned int>> std_map;
+		run_lookup_benchmark("std::hash", std_map, keys);
+	}
+
+	std::vector<std::string> string_keys = make_string_keys(num);
+	std::cout << "--- " << num << " string keys ---" << std::endl;
+	ssuds::UnorderedMap<std::string, int> fast_map;
+	run_lookup_benchmark("FastHash", fast_map, string_keys);
+	ssuds::UnorderedMap<std::string, int, std::hash<std::string>> std_map;
+	run_lookup_benchmark("std::hash", std_map, string_keys);
+}
+
+
+TEST(UnorderedMapBenchmarks, iteration)
+{
+	// Tables that are 75%, 10% and 1% full (a sparse table is what's left after many removes)
+	unsigned int num = 1000000;
+	for (unsigned int percent_full : {75u, 10u, 1u})
+	{
+		ssuds::UnorderedMap<int, int> ssuds_map;
+		std::unordered_map<int, int> std_map;
+		ssuds_map.reserve(num);
+		unsigned int cap = ssuds_map.capacity();
+		unsigned int items = (unsigned int)((unsigned long long)cap * percent_full / 100);
+		for (unsigned int i = 0; i < items; i++)
+		{
+			ssuds_map[(int)(i * 2654435761u)] = i;
+			std_map[(int)(i * 2654435761u)] = i;
+		}
+
+		long long total = 0;
+		double ssuds_ns = time_per_op(items, [&]() {
+			for (ssuds::UnorderedMap<int, int>::unorderMapIterator it = ssuds_map.begin(); it != ssuds_map.end(); ++it)
+				total += it->second;
+			});
+		double std_ns = time_per_op(items, [&]() {
+			for (std::pair<const int, int>& p : std_map)
+				total += p.second;
+			});
+		std::cout << "--- " << items << " items in " << cap << " slots ---" << std::endl;
+		std::cout << "ssuds::UnorderedMap\titerate " << ssuds_ns << " ns/item" << std::endl;
+		std::cout << "std::unordered_map\titerate " << std_ns << " ns/item\t(" << total << ")" << std::endl;
+	}
+}
+
+
+TEST(UnorderedMapBenchmarks, concurrent_throughput)
+{
+	// Each thread does 90% finds and 10% inserts on its own slice of the keys, all in one shared map
+	unsigned int ops_per_thread = 1000000;
+	unsigned int num_keys = 1 << 20;
+	for (unsigned int num_threads : {1u, 2u, 4u, 8u, 16u, 32u})
+	{
+		ssuds::ConcurrentUnorderedMap<int, int> sharded;
+		ssuds::UnorderedMap<int, int> locked;
+		std::mutex global_lock;
+
+		auto run = [&](auto op) {
+			return time_per_op(ops_per_thread * num_threads, [&]() {
+				std::vector<std::thread> threads;
+				for (unsigned int t = 0; t < num_threads; t++)
+				{
+					threads.push_back(std::thread([&, t]() {
+						for (unsigned int i = 0; i < ops_per_thread; i++)
+							op((int)(((t * ops_per_thread + i) % num_keys) * 2654435761u), i % 10 == 0);
+						}));
+				}
+				for (std::thread& thread : threads)
+					thread.join();
+				});
+			};
+
+		double sharded_ns = run([&](int key, bool insert) {
+			if (insert)
+				sharded.insert_or_assign(key, 1);
+			else
+				sharded.contains(key);
+			});
+		double locked_ns = run([&](int key, bool insert) {
+			std::lock_guard<std::mutex> lock(global_lock);
+			if (insert)
+				locked[key] = 1;
+			else
+				locked.find(key);
+			});
+
+		std::cout << "--- " << num_threads << " threads ---" << std::endl;
+		std::cout << "ConcurrentUnorderedMap\t" << 1000.0 / sharded_ns << " Mops/s" << std::endl;
+		std::cout << "global std::mutex\t" << 1000.0 / locked_ns << " Mops/s" << std::endl;
+	}
+}
+
+
+TEST(UnorderedMapBenchmarks, read_mostly_scaling)
+{
+	// 98% finds and 2% inserts over a preloaded set of keys -- the case OptimisticUnorderedMap is for
+	unsigned int ops_per_thread = 1000000;
+	unsigned int num_keys = 1 << 20;
+	for (unsigned int num_threads : {1u, 2u, 4u, 8u, 16u, 32u, 64u})
+	{
+		ssuds::OptimisticUnorderedMap<int, int> optimistic;
+		ssuds::ConcurrentUnorderedMap<int, int> sharded;
+		for (unsigned int i = 0; i < num_keys; i++)
+		{
+			optimistic.insert_or_assign((int)(i * 2654435761u), 1);
+			sharded.insert_or_assign((int)(i * 2654435761u), 1);
+		}
+
+		auto run = [&](auto op) {
+			return time_per_op(ops_per_thread * num_threads, [&]() {
+				std::vector<std::thread> threads;
+				for (unsigned int t = 0; t < num_threads; t++)
+				{
+					threads.push_back(std::thread([&, t]() {
+						for (unsigned int i = 0; i < ops_per_thread; i++)
+							op((int)(((t * 7919 + i) % num_keys) * 2654435761u), i % 50 == 0);
+						}));
+				}
+				for (std::thread& thread : threads)
+					thread.join();
+				});
+			};
+
+		double optimistic_ns = run([&](int key, bool insert) {
+			if (insert)
+				optimistic.insert_or_assign(key, 2);
+			else
+				optimistic.contains(key);
+			});
+		double sharded_ns = run([&](int key, bool insert) {
+			if (insert)
+				sharded.insert_or_assign(key, 2);
+			else
+				sharded.contains(key);
+			});
+
+		std::cout << "--- " << num_threads << " threads ---" << std::endl;
+		std::cout << "OptimisticUnorderedMap\t" << 1000.0 / optimistic_ns << " Mops/s" << std::endl;
+		std::cout << "ConcurrentUnorderedMap\t" << 1000.0 / sharded_ns << " Mops/s" << std::endl;
+	}
+}
+
+
+TEST(UnorderedMapBenchmarks, find_batch)
+{
+	// The big tables are well past the size of the last-level cache, so nearly every lookup is a cache miss
+	for (unsigned int num : {10000u, 4000000u})
+	{
+		ssuds::UnorderedMap<int, int> map;
+		map.reserve(num);
+		for (unsigned int i = 0; i < num; i++)
+			map[(int)(i * 2654435761u)] = i;
+
+		// Lookups in a random order (half hits, half misses), in requests of 64 keys
+		std::vector<int> keys;
+		for (unsigned int i = 0; i < num; i++)
+			keys.push_back((int)(((i * 40503u) % num) * 2654435761u) + (int)(i % 2));
+		const unsigned int request = 64;
+		std::vector<int*> values(request);
+		bool results[request];
+		unsigned int found = 0;
+
+		double loop_ns = time_per_op(num, [&]() {
+			for (unsigned int i = 0; i + request <= num; i += request)
+			{
+				for (unsigned int j = 0; j < request; j++)
+					found += map.find(keys[i + j]) != map.end();
+			}
+			});
+		double find_batch_ns = time_per_op(num, [&]() {
+			for (unsigned int i = 0; i + request <= num; i += request)
+			{
+				map.find_batch(&keys[i], request, &values[0]);
+				found += values[0] != nullptr;
+			}
+			});
+		double contains_batch_ns = time_per_op(num, [&]() {
+			for (unsigned int i = 0; i + request <= num; i += request)
+				found += map.contains_batch(&keys[i], request, results);
+			});
+
+		std::cout << "--- " << num << " int keys (" << map.capacity() * (sizeof(std::pair<int, int>) + 1) / 1024 << " KB table) ---" << std::endl;
+		std::cout << "find loop\t" << loop_ns << " ns/key" << std::endl;
+		std::cout << "find_batch\t" << find_batch_ns << " ns/key" << std::endl;
+		std::cout << "contains_batch\t" << contains_batch_ns << " ns/key\t(" << found << ")" << std::endl;
+	}
+}
+
+
+TEST(UnorderedMapBenchmarks, snapshot)
+{
+	// Startup cost: rebuilding a big map from scratch versus mapping a saved snapshot of it
+	unsigned int num = 10000000;
+	std::string path = (std::filesystem::temp_directory_path() / "ssuds_unordered_map_snapshot_benchmark.bin").string();
+	ssuds::UnorderedMap<unsigned long long, unsigned long long> built;
+	double build_ms = time_per_op(1000000, [&]() {
+		for (unsigned int i = 0; i < num; i++)
+			built[i * 2654435761ull] = i;
+		});
+	double save_ms = time_per_op(1000000, [&]() {
+		built.save(path);
+		});
+
+	unsigned long long total = 0;
+	for (bool verify : {false, true})
+	{
+		double open_ms = time_per_op(1000000, [&]() {
+			ssuds::UnorderedMap<unsigned long long, unsigned long long> mapped =
+				ssuds::UnorderedMap<unsigned long long, unsigned long long>::open_mapped(path, verify);
+			total += mapped.size();
+			});
+		std::cout << "open_mapped (verify_checksum = " << verify << ")\t" << open_ms << " ms" << std::endl;
+	}
+	std::cout << "rebuild\t" << build_ms << " ms\tsave " << save_ms << " ms\t(" << total << ")" << std::endl;
+	std::remove(path.c_str());
+}
+
+TEST(UnorderedMapBenchmarks, flat_string_map)
+{
+	// Memory per entry (and speed) of FlatStringMap versus UnorderedMap<std::string, int> for a 10M word
+	// dictionary.  The words are the SCOWL list WordDrawer reads, repeated with a numbered suffix until there are
+	// enough of them (or made-up words if the list can't be found -- this path is relative to build/vs2022)
+	unsigned int num = 10000000;
+	std::vector<std::string> base_words;
+	std::ifstream word_file("../../media/SCOWL/final/american-words.80");
+	std::string word;
+	while (word_file >> word)
+		base_words.push_back(word);
+	if (base_words.empty())
+	{
+		for (unsigned int i = 0; i < 5000; i++)
+			base_words.push_back(std::string(3 + i % 12, (char)('a' + i % 26)) + std::to_string(i));
+	}
+	std::vector<std::string> keys;
+	unsigned long long key_chars = 0;
+	for (unsigned int i = 0; i < 2 * num; i++)
+	{
+		keys.push_back(base_words[i % base_words.size()] + std::to_string(i / base_words.size()));
+		if (i < num)
+			key_chars += keys.back().size();
+	}
+
+	ssuds::FlatStringMap<int> flat_map;
+	run_lookup_benchmark("FlatStringMap", flat_map, keys);
+	ssuds::UnorderedMap<std::string, int> string_map;
+	run_lookup_benchmark("UnorderedMap<std::string>", string_map, keys);
+
+	// The std::string map's heap use is its slots plus one allocation for every key too long for the string's
+	// own (small string) buffer -- not counting the allocator's per-allocation overhead
+	unsigned long long string_bytes = (unsigned long long)string_map.capacity() * (sizeof(std::pair<std::string, int>) + 1);
+	std::size_t small_capacity = std::string().capacity();
+	for (unsigned int i = 0; i < num; i++)
+	{
+		if (keys[i].size() > small_capacity)
+			string_bytes += keys[i].size() + 1;
+	}
+	std::cout << "mean key length " << (double)key_chars / num << std::endl;
+	std::cout << "FlatStringMap	" << (double)flat_map.memory_usage() / num << " bytes/entry" << std::endl;
+	std::cout << "UnorderedMap<std::string>	" << (double)string_bytes / num << " bytes/entry (+ allocator overhead)" << std::endl;
+}
+
+namespace
+{
+	/// Times successful and failed lookups in map and in a FrozenUnorderedMap built from it
+	template <class K>
+	void run_frozen_benchmark(const char* label, const std::vector<K>& keys)
+	{
+		unsigned int num = (unsigned int)keys.size() / 2;
+		ssuds::UnorderedMap<K, int> map;
+		for (unsigned int i = 0; i < num; i++)
+			map[keys[i]] = i;
+		unsigned int hits = 0;
+		double build_ns = 0;
+		for (int frozen = 0; frozen < 2; frozen++)
+		{
+			std::unique_ptr<ssuds::FrozenUnorderedMap<K, int>> frozen_map;
+			if (frozen)
+			{
+				build_ns = time_per_op(num, [&]() {
+					frozen_map.reset(new ssuds::FrozenUnorderedMap<K, int>(map));
+					});
+			}
+			double hit_ns = time_per_op(num, [&]() {
+				for (unsigned int i = 0; i < num; i++)
+					hits += frozen ? frozen_map->contains(keys[i]) : map.find(keys[i]) != map.end();
+				});
+			double miss_ns = time_per_op(num, [&]() {
+				for (unsigned int i = num; i < 2 * num; i++)
+					hits += frozen ? frozen_map->contains(keys[i]) : map.find(keys[i]) != map.end();
+				});
+			std::cout << label << (frozen ? "\tFrozenUnorderedMap" : "\tUnorderedMap") << "\thit " << hit_ns << " ns\tmiss " << miss_ns << " ns" << std::endl;
+		}
+		std::cout << label << "\tbuild " << build_ns << " ns/key\t(" << hits << " hits)" << std::endl;
+	}
+}
+
+
+TEST(UnorderedMapBenchmarks, frozen)
+{
+	for (unsigned int num : { 1000, 1000000 })
+	{
+		std::vector<unsigned long long> int_keys;
+		for (unsigned int i = 0; i < 2 * num; i++)
+			int_keys.push_back(i * 2654435761ull);
+		run_frozen_benchmark(("int keys x " + std::to_string(num)).c_str(), int_keys);
+		run_frozen_benchmark(("string keys x " + std::to_string(num)).c_str(), make_string_keys(num));
+	}
+}
+
+namespace
+{
+	/// Inserts num keys one at a time, timing each insert, and prints the total and the slowest inserts
+	template <class M>
+	void run_insert_latency_benchmark(const char* label, unsigned int num)
+	{
+		M map;
+		std::vector<double> latencies(num);
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		for (unsigned int i = 0; i < num; i++)
+		{
+			std::chrono::steady_clock::time_point before = std::chrono::steady_clock::now();
+			map[i * 2654435761ull] = i;
+			latencies[i] = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - before).count();
+		}
+		double total_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		std::sort(latencies.begin(), latencies.end());
+		std::cout << label << "\ttotal " << total_ms << " ms\tp99.9 " << latencies[num - num / 1000] << " us\tmax " << latencies[num - 1] << " us" << std::endl;
+	}
+}
+
+
+TEST(UnorderedMapBenchmarks, incremental_rehash)
+{
+	// The worst single insert while growing to 10M items: a whole rehash versus moving a few slots at a time
+	unsigned int num = 10000000;
+	run_insert_latency_benchmark<ssuds::UnorderedMap<unsigned long long, unsigned long long>>("UnorderedMap", num);
+	run_insert_latency_benchmark<ssuds::IncrementalUnorderedMap<unsigned long long, unsigned long long>>("IncrementalUnorderedMap", num);
+}
+
+TEST(UnorderedMapBenchmarks, small_maps)
+{
+	// Making, filling, searching and destroying lots of tiny maps (which never allocate when small)
+	unsigned int num_maps = 1000000;
+	for (unsigned int items : { 1, 4, 7 })
+	{
+		unsigned long long total = 0;
+		double ssuds_ns = time_per_op(num_maps, [&]() {
+			for (unsigned int m = 0; m < num_maps; m++)
+			{
+				ssuds::UnorderedMap<int, int> map;
+				for (unsigned int i = 0; i < items; i++)
+					map[(int)(m + i)] = i;
+				for (unsigned int i = 0; i < items + 2; i++)
+					total += map.find((int)(m + i)) != map.end();
+			}
+			});
+		double small_ns = time_per_op(num_maps, [&]() {
+			for (unsigned int m = 0; m < num_maps; m++)
+			{
+				ssuds::SmallUnorderedMap<int, int> map;
+				for (unsigned int i = 0; i < items; i++)
+					map[(int)(m + i)] = i;
+				for (unsigned int i = 0; i < items + 2; i++)
+					total += map.contains((int)(m + i));
+			}
+			});
+		std::cout << items << " items\tUnorderedMap " << ssuds_ns << " ns/map\tSmallUnorderedMap " << small_ns << " ns/map\t(" << total << ")" << std::endl;
+	}
+}
+
+#endif
\ No newline at end of file